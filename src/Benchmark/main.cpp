@@ -0,0 +1,576 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <functional>
+#include <cstdio>
+#include "RainbowTable.hpp"
+#include "OSSLHasher.hpp"
+#include "Reduction.hpp"
+#include "Common.hpp"
+#include "Utils.hpp"
+#include "ArgParser.hpp"
+#include "Topology.hpp"
+
+
+const char* desc = "Description:\n\
+Benchmark runs microbenchmarks of R41N30W building blocks - hashing (every type\n\
+and backend), reduction, chain walking, hex conversion, table I/O - and measures\n\
+end to end lookup latency on a fixture table generated at startup.\n\
+\n\
+Every result is written as a single JSON object per line, so runs can be diffed\n\
+or collected by scripts. Library log output is suppressed while measuring.\n\
+\n\
+Run only the hashing and reduction benchmarks, half a second each:\n\
+    $> Benchmark.exe --filter hash,reduction --min-time 500 -o results.jsonl\n\
+";
+
+namespace {
+
+const uint32_t PLAIN_LENGTH = 8;
+const uint32_t BATCH_OPS = 1024; // ops between clock reads in microbenchmarks
+
+struct Result
+{
+    std::string name;
+    std::string unit; // what a single op is
+    uint64_t ops;
+    double seconds;
+    std::vector<std::pair<std::string, std::string>> fields; // extra fields, values already in JSON form
+
+    Result(const std::string& name, const std::string& unit)
+        : name(name)
+        , unit(unit)
+        , ops(0)
+        , seconds(0.0)
+        , fields()
+    {
+    }
+
+    Result& Add(const std::string& key, const std::string& value)
+    {
+        fields.emplace_back(key, "\"" + value + "\"");
+        return *this;
+    }
+
+    Result& Add(const std::string& key, double value)
+    {
+        std::ostringstream stream;
+        stream << std::setprecision(6) << value;
+        fields.emplace_back(key, stream.str());
+        return *this;
+    }
+};
+
+// library code logs to stdout - silence it while benchmarks run
+class QuietScope
+{
+public:
+    QuietScope()
+        : mBuffer(std::cout.rdbuf(nullptr))
+    {
+    }
+
+    ~QuietScope()
+    {
+        std::cout.rdbuf(mBuffer);
+    }
+
+private:
+    std::streambuf* mBuffer;
+};
+
+class Suite
+{
+public:
+    Suite(std::ostream& output, const std::string& filter, double minSeconds)
+        : mOutput(output)
+        , mFilters()
+        , mMinSeconds(minSeconds)
+    {
+        std::istringstream stream(filter);
+        std::string item;
+        while (std::getline(stream, item, ','))
+            if (!item.empty())
+                mFilters.push_back(item);
+    }
+
+    // benchmark runs when its name contains any of the filters
+    bool Enabled(const std::string& name) const
+    {
+        if (mFilters.empty())
+            return true;
+        for (const auto& i : mFilters)
+            if (name.find(i) != std::string::npos)
+                return true;
+        return false;
+    }
+
+    // calls body (returning number of ops it did) until the minimum time passes
+    Result Measure(const std::string& name, const std::string& unit, const std::function<uint64_t()>& body) const
+    {
+        Result result(name, unit);
+        body(); // warm up caches and lazy initialization
+
+        const uint64_t freq = GetClockFreq();
+        const uint64_t start = GetTime();
+        uint64_t now = start;
+        do
+        {
+            result.ops += body();
+            now = GetTime();
+        } while (static_cast<double>(now - start) < mMinSeconds * static_cast<double>(freq));
+
+        result.seconds = static_cast<double>(now - start) / static_cast<double>(freq);
+        return result;
+    }
+
+    void Report(const Result& result)
+    {
+        mOutput << "{\"name\":\"" << result.name << "\",\"unit\":\"" << result.unit << "\",\"ops\":" << result.ops
+                << ",\"seconds\":" << std::setprecision(6) << result.seconds << ",\"ops_per_sec\":"
+                << std::fixed << std::setprecision(1) << (result.seconds > 0.0 ? static_cast<double>(result.ops) / result.seconds : 0.0)
+                << std::defaultfloat;
+        for (const auto& i : result.fields)
+            mOutput << ",\"" << i.first << "\":" << i.second;
+        mOutput << "}" << std::endl;
+
+        std::cerr << "  " << std::left << std::setw(36) << result.name << std::right << std::setw(16) << std::fixed << std::setprecision(0)
+                  << (result.seconds > 0.0 ? static_cast<double>(result.ops) / result.seconds : 0.0)
+                  << std::defaultfloat << " " << result.unit << "/s" << std::endl;
+    }
+
+    double GetMinSeconds() const { return mMinSeconds; }
+
+private:
+    std::ostream& mOutput;
+    std::vector<std::string> mFilters;
+    double mMinSeconds;
+};
+
+const OSSLHasher::HashType HASH_TYPES[] = {
+    OSSLHasher::HashType::SHA1,
+    OSSLHasher::HashType::SHA256,
+    OSSLHasher::HashType::BLAKE512,
+    OSSLHasher::HashType::MD5,
+    OSSLHasher::HashType::NTLM,
+};
+
+void RandomPlain(std::mt19937& rng, size_t length, ucharVector& plainValue)
+{
+    std::uniform_int_distribution<unsigned int> uni(0, Common::CharsetLength - 1);
+    plainValue.resize(length);
+    for (auto& c : plainValue)
+        c = Common::Charset[uni(rng)];
+}
+
+void BenchHash(Suite& suite, const std::string& defaultBackend)
+{
+    std::mt19937 rng(1);
+    ucharVector plainValue;
+    RandomPlain(rng, PLAIN_LENGTH, plainValue);
+
+    for (auto type : HASH_TYPES)
+    {
+        const std::string typeName = OSSLHasher::GetHashFuncName(type);
+        ucharVector hashValue(OSSLHasher::GetHashSize(type));
+
+        // default entry point, backend picked by auto-tuning
+        std::string name = "hash/" + typeName;
+        if (suite.Enabled(name))
+        {
+            Result result = suite.Measure(name, "hash", [&]()
+            {
+                for (uint32_t i = 0; i < BATCH_OPS; ++i)
+                {
+                    OSSLHasher::Hash(type, plainValue, hashValue);
+                    plainValue[0] = hashValue[0];
+                }
+                return BATCH_OPS;
+            });
+            suite.Report(result.Add("backend", OSSLHasher::GetBackendName(type)).Add("length", PLAIN_LENGTH));
+        }
+
+        for (const auto& backend : OSSLHasher::GetBackendNames(type))
+        {
+            name = "hash/" + typeName + "/" + backend;
+            if (!suite.Enabled(name) || !OSSLHasher::SetBackend(backend))
+                continue;
+
+            // fixed length kernel, as used by chain walks
+            OSSLHasher::HashFunc hashFunc = OSSLHasher::GetHashFunc(type, PLAIN_LENGTH);
+            Result result = suite.Measure(name, "hash", [&]()
+            {
+                for (uint32_t i = 0; i < BATCH_OPS; ++i)
+                {
+                    hashFunc(plainValue, hashValue);
+                    plainValue[0] = hashValue[0];
+                }
+                return BATCH_OPS;
+            });
+            suite.Report(result.Add("length", PLAIN_LENGTH));
+        }
+        OSSLHasher::SetBackend(defaultBackend);
+    }
+}
+
+void BenchReduction(Suite& suite)
+{
+    std::mt19937 rng(2);
+    ucharVector hashValue(OSSLHasher::GetHashSize(OSSLHasher::HashType::SHA1));
+    for (auto& c : hashValue)
+        c = static_cast<unsigned char>(rng());
+    ucharVector plainValue(PLAIN_LENGTH);
+
+    const std::pair<const char*, Reduction::ReductionFunc> funcs[] = {
+        { "reduction/salted", Reduction::Salted },
+        { "reduction/adrian", Reduction::Adrian },
+    };
+
+    for (const auto& func : funcs)
+    {
+        if (!suite.Enabled(func.first))
+            continue;
+
+        unsigned int salt = 0;
+        Result result = suite.Measure(func.first, "reduction", [&]()
+        {
+            for (uint32_t i = 0; i < BATCH_OPS; ++i)
+            {
+                func.second(salt++, PLAIN_LENGTH, hashValue, plainValue);
+                hashValue[0] = plainValue[0];
+            }
+            return BATCH_OPS;
+        });
+        suite.Report(result.Add("length", PLAIN_LENGTH));
+    }
+
+    const std::string name = "reduction/salted_batch";
+    if (suite.Enabled(name))
+    {
+        const size_t count = 32;
+        std::vector<uint32_t> salts(count);
+        std::vector<unsigned char> hashes(count * hashValue.size());
+        std::vector<unsigned char> plains(count * PLAIN_LENGTH);
+        for (auto& c : hashes)
+            c = static_cast<unsigned char>(rng());
+
+        Result result = suite.Measure(name, "reduction", [&]()
+        {
+            for (uint32_t i = 0; i < BATCH_OPS / count; ++i)
+            {
+                for (auto& s : salts)
+                    s++;
+                Reduction::SaltedBatch(salts.data(), PLAIN_LENGTH, hashes.data(), hashValue.size(), plains.data(), count);
+                hashes[0] = plains[0];
+            }
+            return BATCH_OPS / count * count;
+        });
+        suite.Report(result.Add("length", PLAIN_LENGTH).Add("batch", static_cast<double>(count)));
+    }
+}
+
+void BenchChain(Suite& suite)
+{
+    for (auto type : HASH_TYPES)
+    {
+        const std::string name = "chain/" + OSSLHasher::GetHashFuncName(type);
+        if (!suite.Enabled(name))
+            continue;
+
+        // single thread, so results compare across machines with different core counts
+        RainbowTable table(1, PLAIN_LENGTH, 1000, type);
+        table.SetThreadCount(1);
+        double rate = table.MeasureChainRate(suite.GetMinSeconds());
+
+        Result result(name, "step");
+        result.seconds = suite.GetMinSeconds();
+        result.ops = static_cast<uint64_t>(rate * result.seconds);
+        suite.Report(result.Add("backend", OSSLHasher::GetBackendName(type)).Add("length", PLAIN_LENGTH).Add("threads", 1.0));
+    }
+}
+
+// chain rate by thread count under each placement policy - 1, 2, 4... threads and all logical cores
+void BenchScaling(Suite& suite, const std::string& policies)
+{
+    const OSSLHasher::HashType type = OSSLHasher::HashType::SHA1;
+    std::istringstream list(policies);
+    std::string name;
+    while (std::getline(list, name, ','))
+    {
+        Topology::Policy policy = Topology::Policy::NONE;
+        const std::string benchName = "scaling/chain/" + name;
+        if (name.empty() || !suite.Enabled(benchName))
+            continue;
+        if (!Topology::ParsePolicy(name, policy))
+        {
+            std::cerr << "Unrecognized affinity \"" << name << "\"" << std::endl;
+            continue;
+        }
+
+        Topology::SetPolicy(policy);
+        std::vector<uint32_t> threadCounts;
+        for (uint32_t threads = 1; threads < hardwareConcurrency(); threads *= 2)
+            threadCounts.push_back(threads);
+        threadCounts.push_back(hardwareConcurrency());
+
+        double singleRate = 0.0;
+        for (uint32_t threads : threadCounts)
+        {
+            RainbowTable table(1, PLAIN_LENGTH, 1000, type);
+            table.SetThreadCount(threads);
+            double rate = table.MeasureChainRate(suite.GetMinSeconds());
+            singleRate = (threads == 1) ? rate : singleRate;
+
+            Result result(benchName, "step");
+            result.seconds = suite.GetMinSeconds();
+            result.ops = static_cast<uint64_t>(rate * result.seconds);
+            const double speedup = singleRate > 0.0 ? rate / singleRate : 0.0;
+            suite.Report(result.Add("policy", name).Add("threads", static_cast<double>(threads))
+                               .Add("speedup", speedup).Add("efficiency", speedup / threads));
+        }
+    }
+    Topology::SetPolicy(Topology::Policy::NONE);
+}
+
+void BenchHex(Suite& suite)
+{
+    std::mt19937 rng(3);
+    ucharVector hashValue(OSSLHasher::GetHashSize(OSSLHasher::HashType::SHA1));
+    for (auto& c : hashValue)
+        c = static_cast<unsigned char>(rng());
+    const std::string hashString = HashToStr(hashValue);
+
+    if (suite.Enabled("hex/hash_to_str"))
+    {
+        size_t total = 0; // keeps the conversion from being optimized out
+        Result result = suite.Measure("hex/hash_to_str", "hash", [&]()
+        {
+            for (uint32_t i = 0; i < BATCH_OPS; ++i)
+            {
+                hashValue[0] = static_cast<unsigned char>(i);
+                total += HashToStr(hashValue).size();
+            }
+            return BATCH_OPS;
+        });
+        suite.Report(result.Add("bytes", static_cast<double>(hashValue.size())).Add("checksum", static_cast<double>(total % 1000)));
+    }
+
+    if (suite.Enabled("hex/hash_to_hex"))
+    {
+        std::vector<char> buffer(hashValue.size() * 2);
+        Result result = suite.Measure("hex/hash_to_hex", "hash", [&]()
+        {
+            for (uint32_t i = 0; i < BATCH_OPS; ++i)
+            {
+                hashValue[0] = static_cast<unsigned char>(i);
+                HashToHex(hashValue.data(), hashValue.size(), buffer.data());
+                hashValue[1] = static_cast<unsigned char>(buffer[0]);
+            }
+            return BATCH_OPS;
+        });
+        suite.Report(result.Add("bytes", static_cast<double>(hashValue.size())));
+    }
+
+    if (suite.Enabled("hex/str_to_hash"))
+    {
+        ucharVector decoded;
+        size_t total = 0;
+        Result result = suite.Measure("hex/str_to_hash", "hash", [&]()
+        {
+            for (uint32_t i = 0; i < BATCH_OPS; ++i)
+            {
+                decoded.clear();
+                StrToHash(hashString, decoded);
+                total += decoded[0];
+            }
+            return BATCH_OPS;
+        });
+        suite.Report(result.Add("bytes", static_cast<double>(hashValue.size())).Add("checksum", static_cast<double>(total % 1000)));
+    }
+}
+
+uint64_t GetFileSize(const std::string& filename)
+{
+    std::ifstream file(filename, std::ifstream::binary | std::ifstream::ate);
+    return file ? static_cast<uint64_t>(file.tellg()) : 0;
+}
+
+// table I/O and lookups share a fixture table generated once
+void BenchTable(Suite& suite, uint32_t rows, uint32_t length, uint32_t steps, uint32_t queries, const std::string& tempFile)
+{
+    const OSSLHasher::HashType type = OSSLHasher::HashType::SHA1;
+    const bool io = suite.Enabled("table/save_binary") || suite.Enabled("table/load_binary")
+                 || suite.Enabled("table/save_text") || suite.Enabled("table/load_text");
+    const bool lookup = suite.Enabled("lookup/find_password");
+    if (!suite.Enabled("table/generate") && !io && !lookup)
+        return;
+
+    RainbowTable table(rows, length, steps, type);
+    uint64_t start = GetTime();
+    bool created = table.CreateTable();
+    double elapsed = static_cast<double>(GetTime() - start) / static_cast<double>(GetClockFreq());
+    if (!created)
+    {
+        std::cerr << "Unable to generate fixture table" << std::endl;
+        return;
+    }
+
+    if (suite.Enabled("table/generate"))
+    {
+        Result result("table/generate", "row");
+        result.ops = rows;
+        result.seconds = elapsed;
+        suite.Report(result.Add("rows", static_cast<double>(table.GetSize())).Add("length", length).Add("steps", steps)
+                           .Add("threads", static_cast<double>(hardwareConcurrency())));
+    }
+
+    // each I/O benchmark is a single run - files are large compared to the minimum time anyway
+    auto runIO = [&](const std::string& name, bool textMode, bool save)
+    {
+        if (!suite.Enabled(name))
+            return;
+
+        table.SetTextMode(textMode);
+        if (!save)
+            table.Save(tempFile);
+
+        RainbowTable loaded(0, length, steps, type);
+        bool ok = true;
+        uint64_t ioStart = GetTime();
+        if (save)
+            table.Save(tempFile);
+        else
+            ok = loaded.Load(tempFile);
+        Result result(name, "row");
+        result.seconds = static_cast<double>(GetTime() - ioStart) / static_cast<double>(GetClockFreq());
+        result.ops = static_cast<uint64_t>(table.GetSize());
+
+        const double bytes = static_cast<double>(GetFileSize(tempFile));
+        result.Add("bytes", bytes).Add("mib_per_sec", result.seconds > 0.0 ? bytes / (1 << 20) / result.seconds : 0.0);
+        if (!ok || (!save && loaded.GetSize() != table.GetSize()))
+            result.Add("error", "row count mismatch");
+        suite.Report(result);
+    };
+    runIO("table/save_binary", false, true);
+    runIO("table/load_binary", false, false);
+    runIO("table/save_text", true, true);
+    runIO("table/load_text", true, false);
+    std::remove(tempFile.c_str());
+
+    if (!lookup)
+        return;
+
+    // random passwords of the table length, so both hits and misses are measured
+    std::mt19937 rng(4);
+    ucharVector plainValue;
+    ucharVector hashValue(table.GetHashLength());
+    std::vector<double> latencies;
+    latencies.reserve(queries);
+    uint32_t found = 0;
+    LookupStats stats;
+    const uint64_t freq = GetClockFreq();
+    for (uint32_t i = 0; i < queries; ++i)
+    {
+        RandomPlain(rng, length, plainValue);
+        OSSLHasher::Hash(type, plainValue, hashValue);
+
+        uint64_t queryStart = GetTime();
+        std::string password = table.FindPassword(hashValue, 1, stats);
+        latencies.push_back(static_cast<double>(GetTime() - queryStart) / static_cast<double>(freq));
+        if (!password.empty())
+            found++;
+    }
+
+    std::vector<double> sorted = latencies;
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&](double p)
+    {
+        return sorted.empty() ? 0.0 : sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * static_cast<double>(sorted.size())))];
+    };
+
+    Result result("lookup/find_password", "query");
+    result.ops = queries;
+    for (double i : latencies)
+        result.seconds += i;
+    suite.Report(result.Add("found", static_cast<double>(found))
+                       .Add("p50_us", percentile(0.50) * 1e6)
+                       .Add("p95_us", percentile(0.95) * 1e6)
+                       .Add("p99_us", percentile(0.99) * 1e6)
+                       .Add("hash_ops_per_query", queries ? static_cast<double>(stats.hashOps) / queries : 0.0)
+                       .Add("false_alarms", static_cast<double>(stats.falseAlarms)));
+}
+
+} // anonymous namespace
+
+
+int main(int argc, char* argv[])
+{
+    ArgParser parser;
+
+    parser.Add("f,filter", "Comma separated name fragments of benchmarks to run (default is all)", ArgType::STRING)
+          .Add("o,output", "File to write JSON results to, \"-\" for stdout", ArgType::STRING, "-")
+          .Add("m,min-time", "Minimum time of each microbenchmark in milliseconds", ArgType::VALUE, 200)
+          .Add("b,backend", "Hash implementation used outside of per-backend benchmarks", ArgType::STRING, "auto")
+          .Add("vertical", "Fixture table start rows", ArgType::VALUE, 20000)
+          .Add("horizontal", "Fixture table chain length", ArgType::VALUE, 200)
+          .Add("l,length", "Fixture table password length", ArgType::VALUE, 4)
+          .Add("q,queries", "Number of lookups on the fixture table", ArgType::VALUE, 200)
+          .Add("affinity", "Comma separated thread placement policies to measure chain rate scaling under", ArgType::STRING, "none,compact,scatter,physical")
+          .Add("h,help", "Display this message", ArgType::FLAG);
+
+    if (!parser.Parse(argc, argv))
+    {
+        parser.PrintUsage();
+        return 1;
+    }
+
+    if (parser.GetFlag('h'))
+    {
+        std::cout << "Benchmark - R41N30W performance suite" << std::endl << std::endl;
+        parser.PrintUsage();
+        std::cout << desc << std::endl;
+        return 0;
+    }
+
+    if (parser.GetValue("length") == 0 || parser.GetValue("vertical") == 0 || parser.GetValue("horizontal") == 0)
+    {
+        std::cout << "Fixture table sizes must not be zero." << std::endl;
+        return 1;
+    }
+
+    if (!OSSLHasher::SetBackend(parser.GetString('b')))
+        return 2;
+
+    std::ofstream outFile;
+    std::streambuf* outBuffer = std::cout.rdbuf();
+    const std::string output = parser.GetString('o');
+    if (output != "-")
+    {
+        outFile.open(output);
+        if (!outFile)
+        {
+            std::cout << "Unable to open file \"" << output << "\"!" << std::endl;
+            return 1;
+        }
+        outBuffer = outFile.rdbuf();
+    }
+    std::ostream out(outBuffer);
+
+    Suite suite(out, parser.GetString('f'), static_cast<double>(parser.GetValue('m')) / 1000.0);
+    QuietScope quiet; // results go to their own stream, bound before this point
+
+    BenchHash(suite, parser.GetString('b'));
+    BenchReduction(suite);
+    BenchChain(suite);
+    BenchScaling(suite, parser.GetString("affinity"));
+    BenchHex(suite);
+    BenchTable(suite, parser.GetValue("vertical"), parser.GetValue("length"), parser.GetValue("horizontal"),
+               parser.GetValue('q'), output == "-" ? "benchmark_table.tmp" : output + ".table.tmp");
+
+    return 0;
+}
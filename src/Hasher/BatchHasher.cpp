@@ -0,0 +1,306 @@
+#include "BatchHasher.hpp"
+#include "MappedFile.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <thread>
+#include <cstring>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+
+namespace {
+
+// input is cut into blocks of about this size, each hashed by a single thread
+const size_t BLOCK_SIZE = 4 << 20;
+const size_t OUTPUT_BUFFER_SIZE = 1 << 20;
+
+} // anonymous namespace
+
+
+BatchHasher::BatchHasher(OSSLHasher::HashType hashType, uint32_t threadCount)
+    : mHashFunc(OSSLHasher::GetHashFunc(hashType))
+    , mHashType(hashType)
+    , mHashLen(static_cast<uint32_t>(OSSLHasher::GetHashSize(hashType)))
+    , mThreadCount(threadCount ? threadCount : hardwareConcurrency())
+    , mInputDone(false)
+    , mLines(0)
+    , mBytes(0)
+    , mWriteFailed(false)
+{
+}
+
+bool BatchHasher::Run(const std::string& input, const std::string& output)
+{
+    if (!mHashFunc)
+        return false;
+
+    const bool toStdout = (output == "-");
+    std::ostream& log = toStdout ? std::cerr : std::cout;
+
+    std::FILE* outFile = stdout;
+    if (!toStdout)
+    {
+        outFile = std::fopen(output.c_str(), "wb");
+        if (outFile == nullptr)
+        {
+            log << "Unable to open file \"" << output << "\"!" << std::endl;
+            return false;
+        }
+    }
+#ifdef _WIN32
+    else
+    {
+        _setmode(_fileno(stdout), _O_BINARY);
+    }
+#endif
+    std::vector<char> outBuffer(OUTPUT_BUFFER_SIZE);
+    std::setvbuf(outFile, outBuffer.data(), _IOFBF, outBuffer.size());
+
+    // the map (if any) has to outlive the workers, as blocks point into it
+    MappedFile mapped;
+    std::FILE* inFile = nullptr;
+    if (input == "-")
+    {
+#ifdef _WIN32
+        _setmode(_fileno(stdin), _O_BINARY);
+#endif
+        inFile = stdin;
+    }
+    else if (!mapped.Open(input))
+    {
+        // not mappable (e.g. a pipe) - fall back to buffered reads
+        inFile = std::fopen(input.c_str(), "rb");
+        if (inFile == nullptr)
+        {
+            log << "Unable to open file \"" << input << "\"!" << std::endl;
+            if (!toStdout)
+                std::fclose(outFile);
+            return false;
+        }
+    }
+
+    log << "Hashing lines of " << (input == "-" ? "stdin" : input) << " with " << OSSLHasher::GetHashFuncName(mHashType)
+        << " (" << mThreadCount << " threads)" << std::endl;
+
+    mInputDone = false;
+    mLines = 0;
+    mBytes = 0;
+    mWriteFailed = false;
+
+    uint64_t start = GetTime();
+    std::thread writer(&BatchHasher::WriteWorker, this, outFile);
+    std::vector<std::thread> workers;
+    for (uint32_t i = 0; i < mThreadCount; ++i)
+        workers.emplace_back(&BatchHasher::HashWorker, this);
+
+    bool readOk = inFile ? ReadStream(inFile) : ReadMapped(mapped);
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mInputDone = true;
+    }
+    mWorkReady.notify_all();
+    mBlockDone.notify_all();
+
+    for (auto& i : workers)
+        i.join();
+    writer.join();
+
+    std::fflush(outFile);
+    if (inFile != nullptr && inFile != stdin)
+        std::fclose(inFile);
+    if (!toStdout)
+        std::fclose(outFile);
+
+    double elapsed = static_cast<double>(GetTime() - start) / static_cast<double>(GetClockFreq());
+    if (!readOk)
+        log << "Error reading input" << std::endl;
+    if (mWriteFailed)
+        log << "Error writing output" << std::endl;
+
+    log << "Hashed " << mLines << " lines (" << std::setprecision(2) << std::fixed
+        << static_cast<double>(mBytes) / (1 << 20) << " MiB) in " << std::setprecision(3) << elapsed << " s";
+    if (elapsed > 0.0)
+        log << " - " << static_cast<uint64_t>(static_cast<double>(mLines) / elapsed) << " lines/s, "
+            << std::setprecision(2) << static_cast<double>(mBytes) / (1 << 20) / elapsed << " MiB/s";
+    log << std::endl;
+
+    return readOk && !mWriteFailed;
+}
+
+bool BatchHasher::ReadMapped(const MappedFile& file)
+{
+    const char* data = reinterpret_cast<const char*>(file.Data());
+    const size_t size = static_cast<size_t>(file.Size());
+
+    size_t index = 0;
+    for (size_t begin = 0; begin < size; ++index)
+    {
+        // extend the block to the end of its last line
+        size_t end = std::min(begin + BLOCK_SIZE, size);
+        const void* newline = end < size ? std::memchr(data + end, '\n', size - end) : nullptr;
+        end = newline ? static_cast<size_t>(static_cast<const char*>(newline) - data) + 1 : size;
+
+        auto block = std::make_shared<Block>();
+        block->index = index;
+        block->data = data + begin;
+        block->size = end - begin;
+        block->done = false;
+        Submit(block);
+
+        begin = end;
+    }
+
+    return true;
+}
+
+bool BatchHasher::ReadStream(std::FILE* input)
+{
+    std::vector<char> carry; // incomplete last line of previous read
+    size_t index = 0;
+
+    while (true)
+    {
+        auto block = std::make_shared<Block>();
+        block->storage.swap(carry);
+
+        const size_t have = block->storage.size();
+        block->storage.resize(have + BLOCK_SIZE);
+        const size_t read = std::fread(block->storage.data() + have, 1, BLOCK_SIZE, input);
+        block->storage.resize(have + read);
+
+        if (read == 0)
+        {
+            if (!block->storage.empty())
+            {
+                block->index = index++;
+                block->data = block->storage.data();
+                block->size = block->storage.size();
+                block->done = false;
+                Submit(block);
+            }
+            return std::ferror(input) == 0;
+        }
+
+        auto lastNewline = std::find(block->storage.rbegin(), block->storage.rend(), '\n');
+        if (lastNewline == block->storage.rend())
+        {
+            // no complete line yet - keep reading into the same buffer
+            carry.swap(block->storage);
+            continue;
+        }
+
+        const size_t end = static_cast<size_t>(block->storage.rend() - lastNewline);
+        carry.assign(block->storage.begin() + end, block->storage.end());
+        block->storage.resize(end);
+
+        block->index = index++;
+        block->data = block->storage.data();
+        block->size = block->storage.size();
+        block->done = false;
+        Submit(block);
+    }
+}
+
+void BatchHasher::Submit(const BlockPtr& block)
+{
+    // a few blocks per thread keep workers busy while the writer catches up
+    const size_t maxInFlight = 2 * static_cast<size_t>(mThreadCount) + 2;
+
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mSlotFree.wait(lock, [&]() { return mInFlight.size() < maxInFlight; });
+        mInFlight.push_back(block);
+        mPending.push_back(block);
+    }
+    mWorkReady.notify_one();
+}
+
+void BatchHasher::HashWorker()
+{
+    ucharVector plainValue;
+    ucharVector hashValue(mHashLen);
+
+    while (true)
+    {
+        BlockPtr block;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWorkReady.wait(lock, [&]() { return !mPending.empty() || mInputDone; });
+            if (mPending.empty())
+                return;
+
+            block = mPending.front();
+            mPending.pop_front();
+        }
+
+        HashBlock(*block, plainValue, hashValue);
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            block->done = true;
+        }
+        mBlockDone.notify_all();
+    }
+}
+
+void BatchHasher::HashBlock(Block& block, ucharVector& plainValue, ucharVector& hashValue)
+{
+    const char* data = block.data;
+    const char* end = data + block.size;
+
+    // exact output size is known upfront: one digest and newline per line, last one may lack '\n'
+    size_t lines = static_cast<size_t>(std::count(data, end, '\n'));
+    if (block.size > 0 && end[-1] != '\n')
+        lines++;
+    const size_t lineOutput = 2 * static_cast<size_t>(mHashLen) + 1;
+    block.output.resize(lines * lineOutput);
+
+    char* out = block.output.data();
+    while (data < end)
+    {
+        const char* newline = static_cast<const char*>(std::memchr(data, '\n', static_cast<size_t>(end - data)));
+        const char* lineEnd = newline ? newline : end;
+        const char* textEnd = (lineEnd > data && lineEnd[-1] == '\r') ? lineEnd - 1 : lineEnd;
+
+        plainValue.assign(data, textEnd);
+        mHashFunc(plainValue, hashValue);
+        out = HashToHex(hashValue.data(), mHashLen, out);
+        *out++ = '\n';
+
+        data = lineEnd + 1;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mLines += lines;
+    mBytes += block.size;
+}
+
+void BatchHasher::WriteWorker(std::FILE* output)
+{
+    while (true)
+    {
+        BlockPtr block;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mBlockDone.wait(lock, [&]()
+            {
+                return (!mInFlight.empty() && mInFlight.front()->done) || (mInFlight.empty() && mInputDone);
+            });
+            if (mInFlight.empty())
+                return;
+
+            block = mInFlight.front();
+            mInFlight.pop_front();
+        }
+        mSlotFree.notify_one();
+
+        if (!block->output.empty() && std::fwrite(block->output.data(), 1, block->output.size(), output) != block->output.size())
+            mWriteFailed = true;
+    }
+}
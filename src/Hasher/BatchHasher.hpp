@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include "OSSLHasher.hpp"
+
+class MappedFile;
+
+
+// Hashes every line of a list (file or stdin) and writes hex digests, one per line, in input order.
+// Input is cut into blocks ending on line boundaries. Blocks are hashed in parallel into their
+// own output buffers, and a writer thread emits finished buffers in order - only a bounded
+// number of blocks is in flight, so memory use does not depend on input size.
+class BatchHasher
+{
+public:
+    BatchHasher(OSSLHasher::HashType hashType, uint32_t threadCount);
+
+    // input and output are file paths, "-" stands for stdin/stdout
+    bool Run(const std::string& input, const std::string& output);
+
+private:
+    struct Block
+    {
+        size_t index;
+        const char* data;
+        size_t size;
+        std::vector<char> storage; // owns data when input is not memory mapped
+        std::vector<char> output;
+        bool done;
+    };
+
+    using BlockPtr = std::shared_ptr<Block>;
+
+    bool ReadMapped(const MappedFile& file);
+    bool ReadStream(std::FILE* input);
+    void Submit(const BlockPtr& block);
+    void HashWorker();
+    void WriteWorker(std::FILE* output);
+    void HashBlock(Block& block, ucharVector& plainValue, ucharVector& hashValue);
+
+    OSSLHasher::HashFunc mHashFunc;
+    OSSLHasher::HashType mHashType;
+    uint32_t mHashLen;
+    uint32_t mThreadCount;
+
+    std::mutex mMutex;
+    std::condition_variable mWorkReady;  // block to hash, or end of input
+    std::condition_variable mBlockDone;  // block hashed, or end of input
+    std::condition_variable mSlotFree;   // block written
+    std::deque<BlockPtr> mPending;       // waiting for a hash worker
+    std::deque<BlockPtr> mInFlight;      // submitted and not written yet, in input order
+    bool mInputDone;
+
+    uint64_t mLines;
+    uint64_t mBytes;
+    bool mWriteFailed;
+};
@@ -4,6 +4,7 @@
 #include "OSSLHasher.hpp"
 #include "Utils.hpp"
 #include "ArgParser.hpp"
+#include "BatchHasher.hpp"
 
 
 const char* desc = "Description:\n\
@@ -12,14 +13,24 @@ digest simple messages. The tool was made to help debugging issues with R41N30W.
 \n\
 To hash something, specify the hash type (default is BLAKE512) and an input\n\
 message to be digested. Result will be printed to stdout in hex form.\n\
+NTLM hashes the input as UTF-16LE text (input is read as UTF-8).\n\
+\n\
+Batch mode hashes every line of a file (or stdin, given as \"-\") on all cores\n\
+and writes one hex digest per line, in input order. Progress and throughput are\n\
+reported on stderr when digests go to stdout:\n\
+    $> Hasher.exe -t SHA1 -f candidates.txt -o hashes.txt\n\
 ";
 
 int main(int argc, char * argv[])
 {
     ArgParser parser;
 
-    parser.Add("t,type", "Type of hash to be used (SHA1, SHA256, BLAKE512)", ArgType::STRING, "BLAKE512")
+    parser.Add("t,type", "Type of hash to be used (SHA1, SHA256, BLAKE512, MD5, NTLM)", ArgType::STRING, "BLAKE512")
           .Add("i,input", "Input string to be hashed", ArgType::STRING)
+          .Add("b,backend", "Hash implementation: auto, evp, lowlevel, scalar or simd", ArgType::STRING, "auto")
+          .Add("f,file", "Batch mode: file with lines to be hashed, \"-\" for stdin", ArgType::STRING)
+          .Add("o,output", "Batch mode: file to write digests to, \"-\" for stdout", ArgType::STRING, "-")
+          .Add("j,threads", "Batch mode: thread count (default is all logical cores)", ArgType::VALUE, hardwareConcurrency())
           .Add("h,help", "Display this message", ArgType::FLAG);
 
     if (!parser.Parse(argc, argv))
@@ -38,24 +49,34 @@ int main(int argc, char * argv[])
     }
 
     std::string input = parser.GetString('i');
-    if (input.empty())
+    std::string file = parser.GetString('f');
+    if (input.empty() && file.empty())
     {
-        std::cout << "Please specify an input string to be hashed." << std::endl;
+        std::cout << "Please specify an input string or a file to be hashed." << std::endl;
         return 1;
     }
 
-    ucharVector plainValue;
-    plainValue.assign(input.begin(), input.end());
-
-    ucharVector hashValue;
     OSSLHasher::HashType type = OSSLHasher::GetHashTypeFromString(parser.GetString('t'));
     if (type == OSSLHasher::HashType::UNKNOWN)
     {
         std::cout << "Incorrect hash type provided. Supported are:" << std::endl;
-        std::cout << "\tSHA1, SHA256, BLAKE512" << std::endl;
+        std::cout << "\tSHA1, SHA256, BLAKE512, MD5, NTLM" << std::endl;
+        return 2;
+    }
+
+    if (!OSSLHasher::SetBackend(parser.GetString('b')))
         return 2;
+
+    if (!file.empty())
+    {
+        BatchHasher batch(type, parser.GetValue('j'));
+        return batch.Run(file, parser.GetString('o')) ? 0 : 3;
     }
 
+    ucharVector plainValue;
+    plainValue.assign(input.begin(), input.end());
+
+    ucharVector hashValue;
     hashValue.resize(OSSLHasher::GetHashSize(type));
 
     OSSLHasher::Hash(type, plainValue, hashValue);
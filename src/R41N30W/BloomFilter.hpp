@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+// Split block Bloom filter of table endpoints. Every key sets one bit in each of the 8 words of a
+// single 32 byte block, so a probe reads one cache line. Keys are endpoint hashes - already
+// uniformly distributed, so their first bytes are used directly instead of being hashed again.
+class BloomFilter
+{
+public:
+    static const size_t BLOCK_SIZE = 32; // bytes
+
+    BloomFilter();
+
+    // sizes the filter for given number of keys and clears it
+    void Init(uint64_t keys);
+    void Clear();
+    bool Empty() const { return mBlocks.empty(); }
+
+    // hash has to be at least 8 bytes long
+    void Add(const unsigned char* hash);
+    // false means the hash is definitely not in the set, an empty filter contains everything
+    bool MayContain(const unsigned char* hash) const;
+
+    const unsigned char* Data() const { return reinterpret_cast<const unsigned char*>(mBlocks.data()); }
+    size_t ByteSize() const { return mBlocks.size() * sizeof(Block); }
+    // takes the filter over from Data() of another one, false when size is not a multiple of blocks
+    bool Assign(const unsigned char* data, size_t size);
+
+private:
+    struct Block
+    {
+        uint32_t words[8];
+    };
+
+    size_t BlockIndex(uint64_t key) const;
+
+    std::vector<Block> mBlocks;
+};
@@ -0,0 +1,229 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+#include <future>
+#include <chrono>
+#include <cstring>
+#include "Common.hpp"
+#include "BruteForce.hpp"
+#include "Topology.hpp"
+
+
+namespace {
+
+// candidates are claimed by threads in chunks, and hashed in small batches within a chunk
+const uint64_t CHUNK_SIZE = 1 << 16;
+const size_t BATCH_SIZE = 64;
+
+// digests are uniformly distributed, so the prefix is used as a key directly
+uint64_t HashPrefix(const unsigned char* hashValue, size_t length)
+{
+    uint64_t prefix = 0;
+    std::memcpy(&prefix, hashValue, std::min(sizeof(prefix), length));
+    return prefix | 1;
+}
+
+} // anonymous namespace
+
+
+BruteForce::BruteForce(uint32_t passwordLength, OSSLHasher::HashType hashType)
+    : mBatchHashFunc(OSSLHasher::GetBatchHashFunc(hashType, passwordLength))
+    , mHashType(hashType)
+    , mHashLen(static_cast<uint32_t>(OSSLHasher::GetHashSize(hashType)))
+    , mPasswordLength(passwordLength)
+    , mThreadCount(1)
+    , mPrefixTable()
+    , mPrefixMask(0)
+    , mFound(nullptr)
+    , mNextChunk(0)
+    , mDone(0)
+    , mRemaining(0)
+    , mStartTime(0)
+{
+}
+
+BruteForce::~BruteForce()
+{
+}
+
+void BruteForce::SetThreadCount(uint32_t threadCount)
+{
+    if (threadCount > hardwareConcurrency())
+    {
+        threadCount = hardwareConcurrency();
+        std::cout << "Requested more threads than system can handle - reducing to " << threadCount << std::endl;
+    }
+
+    mThreadCount = threadCount ? threadCount : 1;
+}
+
+size_t BruteForce::Run(const std::vector<ucharVector>& targets, std::map<ucharVector, std::string>& found)
+{
+    uint64_t keyspace = Common::KeyspaceSize(mPasswordLength);
+    if (keyspace == 0)
+    {
+        std::cout << "Keyspace for password length " << mPasswordLength << " is too big to brute force." << std::endl;
+        return 0;
+    }
+
+    mTargets.clear();
+    for (const auto& i : targets)
+    {
+        if (i.size() != mHashLen)
+        {
+            std::cout << "Skipping hash of invalid length (" << i.size() << " bytes, expected " << mHashLen << ")" << std::endl;
+            continue;
+        }
+        // already cracked ones would never count as found again, and the search would not stop early
+        if (found.count(i) == 0)
+            mTargets.push_back(i);
+    }
+    // every target is counted in mRemaining once - duplicates would keep it from reaching zero
+    std::sort(mTargets.begin(), mTargets.end());
+    mTargets.erase(std::unique(mTargets.begin(), mTargets.end()), mTargets.end());
+    if (mTargets.empty())
+        return 0;
+
+    // at most half full, so probes stay short
+    size_t slots = 16;
+    while (slots < 2 * mTargets.size())
+        slots *= 2;
+    mPrefixTable.assign(slots, 0);
+    mPrefixMask = slots - 1;
+    for (const auto& i : mTargets)
+    {
+        const uint64_t prefix = HashPrefix(i.data(), i.size());
+        uint64_t slot = (prefix >> 1) & mPrefixMask;
+        while (mPrefixTable[slot] != 0 && mPrefixTable[slot] != prefix)
+            slot = (slot + 1) & mPrefixMask;
+        mPrefixTable[slot] = prefix;
+    }
+
+    mFound = &found;
+    mNextChunk = 0;
+    mDone = 0;
+    mRemaining = mTargets.size();
+    size_t foundBefore = found.size();
+
+    std::cout << "Brute forcing " << mTargets.size() << " " << OSSLHasher::GetHashFuncName(mHashType)
+              << " hash(es) over " << keyspace << " passwords of length " << mPasswordLength
+              << " (" << mThreadCount << " threads)" << std::endl;
+
+    mStartTime = GetTime();
+    std::vector<std::future<void>> results;
+    results.reserve(mThreadCount);
+    for (uint32_t i = 0; i < mThreadCount; ++i)
+        results.push_back(std::async(std::launch::async, [this, keyspace, i]() { Topology::ScopedPin pin(i); SearchRange(keyspace); }));
+
+    for (auto& i : results)
+    {
+        while (i.wait_for(std::chrono::milliseconds(500)) != std::future_status::ready)
+            LogProgress(keyspace);
+    }
+    LogProgress(keyspace);
+    std::cout << std::endl;
+
+    mFound = nullptr;
+    return found.size() - foundBefore;
+}
+
+void BruteForce::SearchRange(uint64_t keyspace)
+{
+    // candidates and digests of a batch are contiguous, as the batch hash function takes them
+    std::vector<unsigned char> plains(BATCH_SIZE * mPasswordLength);
+    std::vector<unsigned char> hashes(BATCH_SIZE * mHashLen);
+    std::vector<unsigned int> digits(mPasswordLength);
+    ucharVector plainValue;
+
+    while (mRemaining > 0)
+    {
+        const uint64_t begin = mNextChunk.fetch_add(CHUNK_SIZE);
+        if (begin >= keyspace)
+            break;
+        const uint64_t end = std::min(begin + CHUNK_SIZE, keyspace);
+
+        // password digits, least significant first - advanced like an odometer
+        Common::IndexToPassword(begin, mPasswordLength, plainValue);
+        uint64_t index = begin;
+        for (auto& d : digits)
+        {
+            d = static_cast<unsigned int>(index % Common::CharsetLength);
+            index /= Common::CharsetLength;
+        }
+
+        for (uint64_t i = begin; i < end; i += BATCH_SIZE)
+        {
+            const size_t count = static_cast<size_t>(std::min<uint64_t>(BATCH_SIZE, end - i));
+            for (size_t b = 0; b < count; ++b)
+            {
+                std::memcpy(&plains[b * mPasswordLength], plainValue.data(), mPasswordLength);
+                for (uint32_t d = 0; d < mPasswordLength; ++d)
+                {
+                    if (++digits[d] < Common::CharsetLength)
+                    {
+                        plainValue[d] = Common::Charset[digits[d]];
+                        break;
+                    }
+                    digits[d] = 0;
+                    plainValue[d] = Common::Charset[0];
+                }
+            }
+
+            mBatchHashFunc(plains.data(), hashes.data(), count);
+            CheckBatch(plains.data(), hashes.data(), count);
+        }
+
+        mDone += end - begin;
+    }
+}
+
+bool BruteForce::MayBeTarget(uint64_t prefix) const
+{
+    for (uint64_t slot = (prefix >> 1) & mPrefixMask; mPrefixTable[slot] != 0; slot = (slot + 1) & mPrefixMask)
+    {
+        if (mPrefixTable[slot] == prefix)
+            return true;
+    }
+    return false;
+}
+
+void BruteForce::CheckBatch(const unsigned char* plains, const unsigned char* hashes, size_t count)
+{
+    for (size_t b = 0; b < count; ++b)
+    {
+        const unsigned char* hash = hashes + b * mHashLen;
+        if (!MayBeTarget(HashPrefix(hash, mHashLen)))
+            continue;
+
+        ucharVector hashValue(hash, hash + mHashLen);
+        if (!std::binary_search(mTargets.begin(), mTargets.end(), hashValue))
+            continue;
+
+        const char* plain = reinterpret_cast<const char*>(plains + b * mPasswordLength);
+        std::lock_guard<std::mutex> lock(mFoundMutex);
+        if (mFound->insert(std::make_pair(hashValue, std::string(plain, mPasswordLength))).second)
+            mRemaining--;
+    }
+}
+
+void BruteForce::LogProgress(uint64_t keyspace)
+{
+    uint64_t done = std::min<uint64_t>(mDone, keyspace);
+    double elapsed = static_cast<double>(GetTime() - mStartTime) / static_cast<double>(GetClockFreq());
+    double progress = static_cast<double>(done) / static_cast<double>(keyspace) * 100.0;
+    double rate = elapsed > 0.0 ? static_cast<double>(done) / elapsed : 0.0;
+    uint64_t etaSeconds = rate > 0.0 ? static_cast<uint64_t>(static_cast<double>(keyspace - done) / rate) : 0;
+
+    // formatted locally and written at once, so the state of std::cout is left alone
+    std::ostringstream line;
+    line << "Progress: " << std::setfill(' ') << std::setw(6) << std::setprecision(2) << std::fixed << progress << "% ["
+         << static_cast<uint64_t>(rate) << " H/s, " << mTargets.size() - mRemaining << "/" << mTargets.size()
+         << " found] Elapsed ";
+    PrettyLogTime(line, static_cast<uint64_t>(elapsed));
+    line << " Remaining ";
+    PrettyLogTime(line, etaSeconds);
+    line << "        \r";
+    std::cout << line.str();
+    std::cout.flush();
+}
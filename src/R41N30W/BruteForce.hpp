@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include "Utils.hpp"
+#include "OSSLHasher.hpp"
+
+
+// Exhaustive search over all passwords of given length from Common::Charset.
+// Every candidate is checked against all pending targets at once, so cracking many hashes
+// costs the same as cracking a single one.
+class BruteForce
+{
+public:
+    BruteForce(uint32_t passwordLength, OSSLHasher::HashType hashType);
+    ~BruteForce();
+
+    void SetThreadCount(uint32_t threadCount);
+
+    // returns number of cracked targets, found passwords are stored under their hashes
+    size_t Run(const std::vector<ucharVector>& targets, std::map<ucharVector, std::string>& found);
+
+private:
+    void SearchRange(uint64_t keyspace);
+    // plains and hashes are count contiguous passwords and digests
+    void CheckBatch(const unsigned char* plains, const unsigned char* hashes, size_t count);
+    // whether a target may start with prefix - false positives are ruled out against mTargets
+    bool MayBeTarget(uint64_t prefix) const;
+    void LogProgress(uint64_t keyspace);
+
+    OSSLHasher::BatchHashFunc mBatchHashFunc;
+    OSSLHasher::HashType mHashType;
+    uint32_t mHashLen;
+    uint32_t mPasswordLength;
+    uint32_t mThreadCount;
+
+    // Open addressed set of the first 8 bytes of every target (lowest bit set, 0 marks an empty
+    // slot) - filters out almost all candidates before a full compare
+    std::vector<uint64_t> mPrefixTable;
+    uint64_t mPrefixMask;
+    std::vector<ucharVector> mTargets; // sorted
+    std::map<ucharVector, std::string>* mFound;
+    std::mutex mFoundMutex;
+
+    std::atomic<uint64_t> mNextChunk;
+    std::atomic<uint64_t> mDone;
+    std::atomic<size_t> mRemaining;
+    uint64_t mStartTime;
+};
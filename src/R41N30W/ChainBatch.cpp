@@ -0,0 +1,76 @@
+#include "ChainBatch.hpp"
+#include "Profiler.hpp"
+
+#include <cstring>
+
+
+ChainBatch::ChainBatch(size_t capacity, uint32_t passwordLength, uint32_t hashLength,
+                       const OSSLHasher::BatchHashFunc& hashFunc, const Reduction::BatchReductionFunc& reductionFunc)
+    : mCapacity(capacity ? capacity : 1)
+    , mSize(0)
+    , mPasswordLength(passwordLength)
+    , mHashLen(hashLength)
+    , mHashFunc(hashFunc)
+    , mReductionFunc(reductionFunc)
+    , mHashes(mCapacity * hashLength)
+    , mPlains(mCapacity * passwordLength)
+    , mSteps(mCapacity)
+    , mEnds(mCapacity)
+    , mTags(mCapacity)
+{
+}
+
+void ChainBatch::Add(const unsigned char* hashValue, uint32_t fromStep, uint32_t toStep, uint64_t tag)
+{
+    if (Full())
+        return;
+
+    std::memcpy(&mHashes[mSize * mHashLen], hashValue, mHashLen);
+    mSteps[mSize] = fromStep;
+    mEnds[mSize] = toStep;
+    mTags[mSize] = tag;
+    mSize++;
+}
+
+void ChainBatch::Step()
+{
+    if (mSize == 0)
+        return;
+
+    mReductionFunc(mSteps.data(), mPasswordLength, mHashes.data(), mHashLen, mPlains.data(), mSize);
+    mHashFunc(mPlains.data(), mHashes.data(), mSize);
+    Profiler::Add(Profiler::Counter::Reductions, mSize);
+    Profiler::Add(Profiler::Counter::HashCalls, mSize);
+
+    for (size_t i = 0; i < mSize; ++i)
+        mSteps[i]++;
+}
+
+bool ChainBatch::Collect(const CollectFunc& callback)
+{
+    // walking backwards, so the lane moved into a freed slot has already been checked
+    for (size_t i = mSize; i-- > 0;)
+    {
+        if (mSteps[i] < mEnds[i])
+            continue;
+
+        if (callback(mTags[i], &mHashes[i * mHashLen]))
+            return true;
+        RemoveLane(i);
+    }
+
+    return false;
+}
+
+void ChainBatch::RemoveLane(size_t lane)
+{
+    const size_t last = mSize - 1;
+    if (lane != last)
+    {
+        std::memcpy(&mHashes[lane * mHashLen], &mHashes[last * mHashLen], mHashLen);
+        mSteps[lane] = mSteps[last];
+        mEnds[lane] = mEnds[last];
+        mTags[lane] = mTags[last];
+    }
+    mSize--;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "OSSLHasher.hpp"
+#include "Reduction.hpp"
+
+
+// Walks a batch of chains in lockstep. Lanes are kept as structure of arrays (all hashes in one
+// buffer, all plains in another), so every step is one batch reduction and one batch hash over
+// the whole batch instead of a hash-reduce round trip per chain. Each lane has its own position
+// and final step, so chains of different length (e.g. lookup tails) can share a batch.
+class ChainBatch
+{
+public:
+    // called with lane tag and its final hash, returning true stops the collection
+    using CollectFunc = std::function<bool(uint64_t tag, const unsigned char* hashValue)>;
+
+    ChainBatch(size_t capacity, uint32_t passwordLength, uint32_t hashLength,
+               const OSSLHasher::BatchHashFunc& hashFunc, const Reduction::BatchReductionFunc& reductionFunc);
+
+    size_t Size() const { return mSize; }
+    bool Full() const { return mSize == mCapacity; }
+    void Clear() { mSize = 0; }
+
+    // adds a lane with hash at chain position fromStep, to be walked up to position toStep
+    void Add(const unsigned char* hashValue, uint32_t fromStep, uint32_t toStep, uint64_t tag);
+
+    // one reduce+hash step on every lane - lanes at their final step have to be collected first
+    void Step();
+
+    // removes lanes which reached their final step, passing each to callback;
+    // returns true if callback stopped the collection
+    bool Collect(const CollectFunc& callback);
+
+private:
+    void RemoveLane(size_t lane);
+
+    size_t mCapacity;
+    size_t mSize;
+    uint32_t mPasswordLength;
+    uint32_t mHashLen;
+    OSSLHasher::BatchHashFunc mHashFunc;
+    Reduction::BatchReductionFunc mReductionFunc;
+
+    std::vector<unsigned char> mHashes;
+    std::vector<unsigned char> mPlains;
+    std::vector<uint32_t> mSteps; // current position of each lane, also its reduction salt
+    std::vector<uint32_t> mEnds;
+    std::vector<uint64_t> mTags;
+};
@@ -6,4 +6,26 @@ namespace Common {
 const char Charset[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789._";
 const unsigned int CharsetLength = static_cast<unsigned int>(strlen(Charset));
 
+uint64_t KeyspaceSize(uint32_t passwordLength)
+{
+    uint64_t keyspace = 1;
+    for (uint32_t i = 0; i < passwordLength; ++i)
+    {
+        if (keyspace > UINT64_MAX / CharsetLength)
+            return 0;
+        keyspace *= CharsetLength;
+    }
+    return keyspace;
+}
+
+void IndexToPassword(uint64_t index, uint32_t passwordLength, ucharVector& plainValue)
+{
+    plainValue.resize(passwordLength);
+    for (uint32_t i = 0; i < passwordLength; ++i)
+    {
+        plainValue[i] = Charset[index % CharsetLength];
+        index /= CharsetLength;
+    }
+}
+
 } // namespace Common
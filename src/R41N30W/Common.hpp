@@ -1,9 +1,17 @@
 #pragma once
 
+#include <cstdint>
+#include "Utils.hpp"
 
 namespace Common {
 
 extern const char Charset[];
 extern const unsigned int CharsetLength;
 
+// number of passwords of given length, 0 if it does not fit in 64 bits
+uint64_t KeyspaceSize(uint32_t passwordLength);
+
+// maps index in keyspace to a password - first char is the least significant digit
+void IndexToPassword(uint64_t index, uint32_t passwordLength, ucharVector& plainValue);
+
 } // namespace Common
@@ -0,0 +1,55 @@
+#include "Executor.hpp"
+
+#include <algorithm>
+#include "Topology.hpp"
+
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+    : mWorkers()
+    , mMutex()
+    , mNotEmpty()
+    , mTasks()
+    , mStopping(false)
+{
+    for (uint32_t i = 0; i < std::max<uint32_t>(threadCount, 1); ++i)
+        mWorkers.emplace_back(&ThreadPool::Work, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mNotEmpty.notify_all();
+    for (auto& i : mWorkers)
+        i.join();
+}
+
+void ThreadPool::Post(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTasks.push_back(std::move(task));
+    }
+    mNotEmpty.notify_one();
+}
+
+void ThreadPool::Work(unsigned int slot)
+{
+    Topology::PinThread(slot);
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (;;)
+    {
+        mNotEmpty.wait(lock, [this]() { return mStopping || !mTasks.empty(); });
+        if (mTasks.empty())
+            return;
+
+        std::function<void()> task = std::move(mTasks.front());
+        mTasks.pop_front();
+        lock.unlock();
+        task();
+        lock.lock();
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// Runs tasks posted to it - lets an embedding service run lookups on threads it already has,
+// instead of the engine spawning its own.
+class Executor
+{
+public:
+    virtual ~Executor() {}
+
+    // may be called from any thread, including from within a running task
+    virtual void Post(std::function<void()> task) = 0;
+};
+
+// Fixed set of worker threads pinned by Topology, taking tasks in order of posting.
+// Tasks still queued when it is destroyed are run before the threads exit.
+class ThreadPool : public Executor
+{
+public:
+    explicit ThreadPool(uint32_t threadCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void Post(std::function<void()> task) override;
+
+private:
+    void Work(unsigned int slot);
+
+    std::vector<std::thread> mWorkers;
+    std::mutex mMutex;
+    std::condition_variable mNotEmpty;
+    std::deque<std::function<void()>> mTasks;
+    bool mStopping;
+};
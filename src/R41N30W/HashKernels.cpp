@@ -0,0 +1,578 @@
+#include "HashKernels.hpp"
+
+#include <cstring>
+#include <utility>
+#include <type_traits>
+
+
+namespace HashKernels {
+
+namespace {
+
+inline uint32_t Rotl32(uint32_t x, int n)
+{
+    return (x << n) | (x >> (32 - n));
+}
+
+inline uint32_t Rotr32(uint32_t x, int n)
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+inline uint64_t Rotr64(uint64_t x, int n)
+{
+    return (x >> n) | (x << (64 - n));
+}
+
+inline uint32_t LoadBE32(const unsigned char* p)
+{
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+inline void StoreBE32(unsigned char* p, uint32_t x)
+{
+    p[0] = static_cast<unsigned char>(x >> 24);
+    p[1] = static_cast<unsigned char>(x >> 16);
+    p[2] = static_cast<unsigned char>(x >> 8);
+    p[3] = static_cast<unsigned char>(x);
+}
+
+inline uint64_t LoadLE64(const unsigned char* p)
+{
+    uint64_t x = 0;
+    for (int i = 7; i >= 0; --i)
+        x = (x << 8) | p[i];
+    return x;
+}
+
+inline void StoreLE64(unsigned char* p, uint64_t x)
+{
+    for (int i = 0; i < 8; ++i)
+        p[i] = static_cast<unsigned char>(x >> (8 * i));
+}
+
+
+void SHA1Compress(uint32_t* state, const unsigned char* blocks, size_t blockCount)
+{
+    uint32_t w[80];
+    for (size_t block = 0; block < blockCount; ++block, blocks += 64)
+    {
+        for (int i = 0; i < 16; ++i)
+            w[i] = LoadBE32(blocks + 4 * i);
+        for (int i = 16; i < 80; ++i)
+            w[i] = Rotl32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+        for (int i = 0; i < 80; ++i)
+        {
+            uint32_t f, k;
+            if (i < 20)      { f = (b & c) | (~b & d);          k = 0x5A827999; }
+            else if (i < 40) { f = b ^ c ^ d;                   k = 0x6ED9EBA1; }
+            else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+            else             { f = b ^ c ^ d;                   k = 0xCA62C1D6; }
+
+            uint32_t t = Rotl32(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = Rotl32(b, 30);
+            b = a;
+            a = t;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+    }
+}
+
+const uint32_t SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+void SHA256Compress(uint32_t* state, const unsigned char* blocks, size_t blockCount)
+{
+    uint32_t w[64];
+    for (size_t block = 0; block < blockCount; ++block, blocks += 64)
+    {
+        for (int i = 0; i < 16; ++i)
+            w[i] = LoadBE32(blocks + 4 * i);
+        for (int i = 16; i < 64; ++i)
+        {
+            uint32_t s0 = Rotr32(w[i - 15], 7) ^ Rotr32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = Rotr32(w[i - 2], 17) ^ Rotr32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; ++i)
+        {
+            uint32_t s1 = Rotr32(e, 6) ^ Rotr32(e, 11) ^ Rotr32(e, 25);
+            uint32_t ch = (e & f) ^ (~e & g);
+            uint32_t t1 = h + s1 + ch + SHA256_K[i] + w[i];
+            uint32_t s0 = Rotr32(a, 2) ^ Rotr32(a, 13) ^ Rotr32(a, 22);
+            uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+            uint32_t t2 = s0 + maj;
+
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}
+
+
+// Short message kernels. For a fixed length L the block is the password followed by constant
+// padding, so every schedule word is either constant, or a constant part plus terms depending
+// on the password. Both parts are computed at compile time per length, the remaining terms are
+// selected by the masks below and folded by the compiler.
+struct ShortSchedule
+{
+    bool var[80];       // word depends on the password
+    uint32_t value[80]; // whole constant word, or constant part of a variable one
+    unsigned mask[80];  // which of the (up to four) source terms are variable
+};
+
+constexpr uint32_t ConstRotl32(uint32_t x, int n)
+{
+    return (x << n) | (x >> (32 - n));
+}
+
+constexpr uint32_t ConstRotr32(uint32_t x, int n)
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+constexpr uint32_t SHA256Sigma0(uint32_t x)
+{
+    return ConstRotr32(x, 7) ^ ConstRotr32(x, 18) ^ (x >> 3);
+}
+
+constexpr uint32_t SHA256Sigma1(uint32_t x)
+{
+    return ConstRotr32(x, 17) ^ ConstRotr32(x, 19) ^ (x >> 10);
+}
+
+// first 16 words: 0x80 terminator and big endian bit length, zero where the password goes
+constexpr ShortSchedule MakePadding(size_t length)
+{
+    ShortSchedule s{};
+    for (size_t i = 0; i < 16; ++i)
+        s.var[i] = 4 * i < length;
+
+    s.value[length / 4] |= 0x80u << (24 - 8 * (length % 4));
+    s.value[15] = static_cast<uint32_t>(length * 8);
+    return s;
+}
+
+// SHA-1 schedule sources are t-3, t-8, t-14 and t-16 (mask bits 0..3), all XORed then rotated,
+// so the constant part is the rotated XOR of the constant sources
+constexpr ShortSchedule MakeSHA1Schedule(size_t length)
+{
+    ShortSchedule s = MakePadding(length);
+    for (size_t t = 16; t < 80; ++t)
+    {
+        const size_t sources[4] = { t - 3, t - 8, t - 14, t - 16 };
+        uint32_t constant = 0;
+        for (unsigned i = 0; i < 4; ++i)
+        {
+            if (s.var[sources[i]])
+                s.mask[t] |= 1u << i;
+            else
+                constant ^= s.value[sources[i]];
+        }
+        s.var[t] = s.mask[t] != 0;
+        s.value[t] = ConstRotl32(constant, 1);
+    }
+    return s;
+}
+
+// SHA-256 schedule sources are sigma1(t-2), t-7, sigma0(t-15) and t-16 (mask bits 0..3), all added
+constexpr ShortSchedule MakeSHA256Schedule(size_t length)
+{
+    ShortSchedule s = MakePadding(length);
+    for (size_t t = 16; t < 64; ++t)
+    {
+        const size_t sources[4] = { t - 2, t - 7, t - 15, t - 16 };
+        uint32_t constant = 0;
+        for (unsigned i = 0; i < 4; ++i)
+        {
+            if (s.var[sources[i]])
+            {
+                s.mask[t] |= 1u << i;
+                continue;
+            }
+
+            uint32_t term = s.value[sources[i]];
+            if (i == 0)
+                term = SHA256Sigma1(term);
+            else if (i == 2)
+                term = SHA256Sigma0(term);
+            constant += term;
+        }
+        s.var[t] = s.mask[t] != 0;
+        s.value[t] = constant;
+    }
+    return s;
+}
+
+template<size_t L>
+struct ShortSchedules
+{
+    static constexpr ShortSchedule sha1 = MakeSHA1Schedule(L);
+    static constexpr ShortSchedule sha256 = MakeSHA256Schedule(L);
+};
+
+template<size_t L>
+constexpr ShortSchedule ShortSchedules<L>::sha1;
+template<size_t L>
+constexpr ShortSchedule ShortSchedules<L>::sha256;
+
+// one of the first 16 words: constant, whole password word or the last, partial one
+template<size_t L, size_t T>
+inline void LoadShortWord(uint32_t* w, const unsigned char* data, const ShortSchedule& s)
+{
+    if (!s.var[T])
+    {
+        w[T] = s.value[T];
+    }
+    else if (4 * T + 4 <= L)
+    {
+        w[T] = LoadBE32(data + 4 * T);
+    }
+    else
+    {
+        uint32_t x = s.value[T];
+        for (size_t i = 4 * T; i < L; ++i)
+            x |= static_cast<uint32_t>(data[i]) << (24 - 8 * (i - 4 * T));
+        w[T] = x;
+    }
+}
+
+template<size_t L, size_t T>
+inline void ShortSHA1Word(uint32_t* w, const unsigned char* data, std::true_type)
+{
+    LoadShortWord<L, T>(w, data, ShortSchedules<L>::sha1);
+}
+
+template<size_t L, size_t T>
+inline void ShortSHA1Word(uint32_t* w, const unsigned char*, std::false_type)
+{
+    constexpr const ShortSchedule& s = ShortSchedules<L>::sha1;
+    if (!s.var[T])
+    {
+        w[T] = s.value[T];
+        return;
+    }
+
+    uint32_t x = 0;
+    if (s.mask[T] & 1) x ^= w[T - 3];
+    if (s.mask[T] & 2) x ^= w[T - 8];
+    if (s.mask[T] & 4) x ^= w[T - 14];
+    if (s.mask[T] & 8) x ^= w[T - 16];
+    w[T] = Rotl32(x, 1) ^ s.value[T];
+}
+
+template<size_t L, size_t T>
+inline void ShortSHA256Word(uint32_t* w, const unsigned char* data, std::true_type)
+{
+    LoadShortWord<L, T>(w, data, ShortSchedules<L>::sha256);
+}
+
+template<size_t L, size_t T>
+inline void ShortSHA256Word(uint32_t* w, const unsigned char*, std::false_type)
+{
+    constexpr const ShortSchedule& s = ShortSchedules<L>::sha256;
+    if (!s.var[T])
+    {
+        w[T] = s.value[T];
+        return;
+    }
+
+    uint32_t x = s.value[T];
+    if (s.mask[T] & 1) x += Rotr32(w[T - 2], 17) ^ Rotr32(w[T - 2], 19) ^ (w[T - 2] >> 10);
+    if (s.mask[T] & 2) x += w[T - 7];
+    if (s.mask[T] & 4) x += Rotr32(w[T - 15], 7) ^ Rotr32(w[T - 15], 18) ^ (w[T - 15] >> 3);
+    if (s.mask[T] & 8) x += w[T - 16];
+    w[T] = x;
+}
+
+// expanded in order through the initializer list, so every word is computed by its own specialization
+template<size_t L, size_t... T>
+inline void ShortSHA1Schedule(uint32_t* w, const unsigned char* data, std::index_sequence<T...>)
+{
+    const int order[] = { (ShortSHA1Word<L, T>(w, data, std::integral_constant<bool, (T < 16)>()), 0)... };
+    (void)order;
+}
+
+template<size_t L, size_t... T>
+inline void ShortSHA256Schedule(uint32_t* w, const unsigned char* data, std::index_sequence<T...>)
+{
+    const int order[] = { (ShortSHA256Word<L, T>(w, data, std::integral_constant<bool, (T < 16)>()), 0)... };
+    (void)order;
+}
+
+template<size_t L>
+void ShortSHA1(const unsigned char* data, size_t, unsigned char* out)
+{
+    uint32_t w[80];
+    ShortSHA1Schedule<L>(w, data, std::make_index_sequence<80>());
+
+    uint32_t state[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+    for (int i = 0; i < 80; ++i)
+    {
+        uint32_t f, k;
+        if (i < 20)      { f = (b & c) | (~b & d);          k = 0x5A827999; }
+        else if (i < 40) { f = b ^ c ^ d;                   k = 0x6ED9EBA1; }
+        else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+        else             { f = b ^ c ^ d;                   k = 0xCA62C1D6; }
+
+        uint32_t t = Rotl32(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = Rotl32(b, 30);
+        b = a;
+        a = t;
+    }
+
+    StoreBE32(out, state[0] + a);
+    StoreBE32(out + 4, state[1] + b);
+    StoreBE32(out + 8, state[2] + c);
+    StoreBE32(out + 12, state[3] + d);
+    StoreBE32(out + 16, state[4] + e);
+}
+
+template<size_t L>
+void ShortSHA256(const unsigned char* data, size_t, unsigned char* out)
+{
+    uint32_t w[64];
+    ShortSHA256Schedule<L>(w, data, std::make_index_sequence<64>());
+
+    uint32_t state[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; ++i)
+    {
+        uint32_t s1 = Rotr32(e, 6) ^ Rotr32(e, 11) ^ Rotr32(e, 25);
+        uint32_t ch = (e & f) ^ (~e & g);
+        uint32_t t1 = h + s1 + ch + SHA256_K[i] + w[i];
+        uint32_t s0 = Rotr32(a, 2) ^ Rotr32(a, 13) ^ Rotr32(a, 22);
+        uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t t2 = s0 + maj;
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    StoreBE32(out, state[0] + a);
+    StoreBE32(out + 4, state[1] + b);
+    StoreBE32(out + 8, state[2] + c);
+    StoreBE32(out + 12, state[3] + d);
+    StoreBE32(out + 16, state[4] + e);
+    StoreBE32(out + 20, state[5] + f);
+    StoreBE32(out + 24, state[6] + g);
+    StoreBE32(out + 28, state[7] + h);
+}
+
+// index 0 is unused - empty messages go through the generic kernels
+template<size_t... L>
+HashFunc SelectShortSHA1(size_t length, std::index_sequence<L...>)
+{
+    static const HashFunc kernels[] = { nullptr, ShortSHA1<L + 1>... };
+    return length < sizeof(kernels) / sizeof(kernels[0]) ? kernels[length] : nullptr;
+}
+
+template<size_t... L>
+HashFunc SelectShortSHA256(size_t length, std::index_sequence<L...>)
+{
+    static const HashFunc kernels[] = { nullptr, ShortSHA256<L + 1>... };
+    return length < sizeof(kernels) / sizeof(kernels[0]) ? kernels[length] : nullptr;
+}
+
+
+const uint64_t BLAKE2B_IV[8] = {
+    0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+    0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL,
+};
+
+const unsigned char BLAKE2B_SIGMA[12][16] = {
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+    { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+    {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+    {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+    {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+    { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+    { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+    {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+    { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 },
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+};
+
+inline void BLAKE2bMix(uint64_t* v, int a, int b, int c, int d, uint64_t x, uint64_t y)
+{
+    v[a] = v[a] + v[b] + x;
+    v[d] = Rotr64(v[d] ^ v[a], 32);
+    v[c] = v[c] + v[d];
+    v[b] = Rotr64(v[b] ^ v[c], 24);
+    v[a] = v[a] + v[b] + y;
+    v[d] = Rotr64(v[d] ^ v[a], 16);
+    v[c] = v[c] + v[d];
+    v[b] = Rotr64(v[b] ^ v[c], 63);
+}
+
+void BLAKE2bCompress(uint64_t* h, const unsigned char* block, uint64_t counter, bool last)
+{
+    uint64_t m[16];
+    for (int i = 0; i < 16; ++i)
+        m[i] = LoadLE64(block + 8 * i);
+
+    uint64_t v[16];
+    for (int i = 0; i < 8; ++i)
+    {
+        v[i] = h[i];
+        v[i + 8] = BLAKE2B_IV[i];
+    }
+    v[12] ^= counter;
+    if (last)
+        v[14] = ~v[14];
+
+    for (int r = 0; r < 12; ++r)
+    {
+        const unsigned char* s = BLAKE2B_SIGMA[r];
+        BLAKE2bMix(v, 0, 4,  8, 12, m[s[ 0]], m[s[ 1]]);
+        BLAKE2bMix(v, 1, 5,  9, 13, m[s[ 2]], m[s[ 3]]);
+        BLAKE2bMix(v, 2, 6, 10, 14, m[s[ 4]], m[s[ 5]]);
+        BLAKE2bMix(v, 3, 7, 11, 15, m[s[ 6]], m[s[ 7]]);
+        BLAKE2bMix(v, 0, 5, 10, 15, m[s[ 8]], m[s[ 9]]);
+        BLAKE2bMix(v, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+        BLAKE2bMix(v, 2, 7,  8, 13, m[s[12]], m[s[13]]);
+        BLAKE2bMix(v, 3, 4,  9, 14, m[s[14]], m[s[15]]);
+    }
+
+    for (int i = 0; i < 8; ++i)
+        h[i] ^= v[i] ^ v[i + 8];
+}
+
+} // anonymous namespace
+
+
+namespace Detail {
+
+void ProcessMessage(uint32_t* state, const unsigned char* data, size_t length, bool bigEndianLength, CompressFunc compress)
+{
+    const size_t fullBlocks = length / 64;
+    if (fullBlocks > 0)
+        compress(state, data, fullBlocks);
+
+    // remaining bytes, 0x80 terminator and bit length take one or two more blocks
+    unsigned char tail[128] = { 0 };
+    const size_t rest = length % 64;
+    if (rest > 0)
+        std::memcpy(tail, data + fullBlocks * 64, rest);
+    tail[rest] = 0x80;
+
+    const size_t tailLength = rest < 56 ? 64 : 128;
+    const uint64_t bits = static_cast<uint64_t>(length) * 8;
+    for (int i = 0; i < 8; ++i)
+    {
+        unsigned char byte = static_cast<unsigned char>(bits >> (8 * i));
+        if (bigEndianLength)
+            tail[tailLength - 1 - i] = byte;
+        else
+            tail[tailLength - 8 + i] = byte;
+    }
+
+    compress(state, tail, tailLength / 64);
+}
+
+} // namespace Detail
+
+
+void SHA1(const unsigned char* data, size_t length, unsigned char* out)
+{
+    uint32_t state[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    Detail::ProcessMessage(state, data, length, true, SHA1Compress);
+
+    for (int i = 0; i < 5; ++i)
+        StoreBE32(out + 4 * i, state[i]);
+}
+
+void SHA256(const unsigned char* data, size_t length, unsigned char* out)
+{
+    uint32_t state[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+    Detail::ProcessMessage(state, data, length, true, SHA256Compress);
+
+    for (int i = 0; i < 8; ++i)
+        StoreBE32(out + 4 * i, state[i]);
+}
+
+void BLAKE512(const unsigned char* data, size_t length, unsigned char* out)
+{
+    uint64_t h[8];
+    for (int i = 0; i < 8; ++i)
+        h[i] = BLAKE2B_IV[i];
+    h[0] ^= 0x01010000ULL ^ 64; // no key, 64-byte digest
+
+    // the last block (even if it is full, or the message is empty) is compressed with the final flag
+    uint64_t counter = 0;
+    while (length > 128)
+    {
+        counter += 128;
+        BLAKE2bCompress(h, data, counter, false);
+        data += 128;
+        length -= 128;
+    }
+
+    unsigned char block[128] = { 0 };
+    std::memcpy(block, data, length);
+    counter += length;
+    BLAKE2bCompress(h, block, counter, true);
+
+    for (int i = 0; i < 8; ++i)
+        StoreLE64(out + 8 * i, h[i]);
+}
+
+HashFunc GetShortSHA1(size_t length)
+{
+    return SelectShortSHA1(length, std::make_index_sequence<SHORT_MAX_LENGTH>());
+}
+
+HashFunc GetShortSHA256(size_t length)
+{
+    return SelectShortSHA256(length, std::make_index_sequence<SHORT_MAX_LENGTH>());
+}
+
+} // namespace HashKernels
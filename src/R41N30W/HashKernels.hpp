@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+
+// In-tree hash implementations, used as alternative backends to OpenSSL.
+// All of them take the whole message at once and write the full digest to out.
+namespace HashKernels {
+
+using HashFunc = void(*)(const unsigned char* data, size_t length, unsigned char* out);
+
+// portable scalar code
+void SHA1(const unsigned char* data, size_t length, unsigned char* out);
+void SHA256(const unsigned char* data, size_t length, unsigned char* out);
+void BLAKE512(const unsigned char* data, size_t length, unsigned char* out);
+void MD5(const unsigned char* data, size_t length, unsigned char* out);
+// MD4 of the message as UTF-16LE - message is decoded as UTF-8, invalid bytes are taken as Latin-1
+void NTLM(const unsigned char* data, size_t length, unsigned char* out);
+
+// x86 SHA extensions - only call when HasSHAExtensions() returns true
+bool HasSHAExtensions();
+void SHA1_SHANI(const unsigned char* data, size_t length, unsigned char* out);
+void SHA256_SHANI(const unsigned char* data, size_t length, unsigned char* out);
+
+// Single-block kernels for short messages of one fixed length (up to SHORT_MAX_LENGTH bytes).
+// Padding words and the parts of the message schedule depending only on them are precomputed
+// per length, so only the password words are loaded and expanded. The returned kernel must
+// only be called with messages of the requested length. nullptr when length is not supported.
+const size_t SHORT_MAX_LENGTH = 32;
+const size_t SHORT_NTLM_MAX_LENGTH = 27; // two bytes per char
+HashFunc GetShortSHA1(size_t length);
+HashFunc GetShortSHA256(size_t length);
+HashFunc GetShortMD5(size_t length);
+HashFunc GetShortNTLM(size_t length);
+HashFunc GetShortSHA1_SHANI(size_t length);
+HashFunc GetShortSHA256_SHANI(size_t length);
+
+namespace Detail {
+
+using CompressFunc = void(*)(uint32_t* state, const unsigned char* blocks, size_t blockCount);
+
+// runs compress over the message and Merkle-Damgard padding (64-byte blocks, 64-bit bit length)
+void ProcessMessage(uint32_t* state, const unsigned char* data, size_t length, bool bigEndianLength, CompressFunc compress);
+
+} // namespace Detail
+
+} // namespace HashKernels
@@ -0,0 +1,347 @@
+#include "HashKernels.hpp"
+
+#include <cstring>
+#include <utility>
+#include <vector>
+
+
+namespace HashKernels {
+
+namespace {
+
+inline uint32_t Rotl32(uint32_t x, int n)
+{
+    return (x << n) | (x >> (32 - n));
+}
+
+inline uint32_t LoadLE32(const unsigned char* p)
+{
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+inline void StoreLE32(unsigned char* p, uint32_t x)
+{
+    p[0] = static_cast<unsigned char>(x);
+    p[1] = static_cast<unsigned char>(x >> 8);
+    p[2] = static_cast<unsigned char>(x >> 16);
+    p[3] = static_cast<unsigned char>(x >> 24);
+}
+
+const uint32_t MD_INIT[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+
+const uint32_t MD5_K[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+};
+
+// rotations per round, for step % 4
+constexpr int MD5_S[16] = { 7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21 };
+constexpr int MD4_S[12] = { 3, 7, 11, 19, 3, 5, 9, 13, 3, 9, 11, 15 };
+
+constexpr size_t MD4_WORD[48] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+    0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15,
+    0, 8, 4, 12, 2, 10, 6, 14, 1, 9, 5, 13, 3, 11, 7, 15,
+};
+
+// Steps are unrolled through templates, so all indices and rotations are constants. Instead of
+// moving a, b, c, d around after each step, their roles rotate over v: v[(4 - I % 4) % 4] is a.
+template<size_t I>
+inline void MD5Step(uint32_t* v, const uint32_t* m)
+{
+    uint32_t& a = v[(4 - I % 4) % 4];
+    const uint32_t b = v[(5 - I % 4) % 4];
+    const uint32_t c = v[(6 - I % 4) % 4];
+    const uint32_t d = v[(7 - I % 4) % 4];
+
+    uint32_t f;
+    size_t g;
+    if (I < 16)      { f = (b & c) | (~b & d); g = I; }
+    else if (I < 32) { f = (d & b) | (~d & c); g = (5 * I + 1) % 16; }
+    else if (I < 48) { f = b ^ c ^ d;          g = (3 * I + 5) % 16; }
+    else             { f = c ^ (b | ~d);       g = (7 * I) % 16; }
+
+    a = b + Rotl32(a + f + MD5_K[I] + m[g], MD5_S[4 * (I / 16) + I % 4]);
+}
+
+template<size_t I>
+inline void MD4Step(uint32_t* v, const uint32_t* m)
+{
+    uint32_t& a = v[(4 - I % 4) % 4];
+    const uint32_t b = v[(5 - I % 4) % 4];
+    const uint32_t c = v[(6 - I % 4) % 4];
+    const uint32_t d = v[(7 - I % 4) % 4];
+
+    uint32_t f;
+    if (I < 16)      f = (b & c) | (~b & d);
+    else if (I < 32) f = ((b & c) | (b & d) | (c & d)) + 0x5A827999;
+    else             f = (b ^ c ^ d) + 0x6ED9EBA1;
+
+    a = Rotl32(a + f + m[MD4_WORD[I]], MD4_S[4 * (I / 16) + I % 4]);
+}
+
+// expanded in order through the initializer list - the step count is a multiple of 4, so
+// the roles are back in place at the end
+template<size_t... I>
+inline void MD5Steps(uint32_t* v, const uint32_t* m, std::index_sequence<I...>)
+{
+    const int order[] = { (MD5Step<I>(v, m), 0)... };
+    (void)order;
+}
+
+template<size_t... I>
+inline void MD4Steps(uint32_t* v, const uint32_t* m, std::index_sequence<I...>)
+{
+    const int order[] = { (MD4Step<I>(v, m), 0)... };
+    (void)order;
+}
+
+void MD5Compress(uint32_t* state, const unsigned char* blocks, size_t blockCount)
+{
+    uint32_t m[16];
+    for (size_t block = 0; block < blockCount; ++block, blocks += 64)
+    {
+        for (int i = 0; i < 16; ++i)
+            m[i] = LoadLE32(blocks + 4 * i);
+
+        uint32_t v[4] = { state[0], state[1], state[2], state[3] };
+        MD5Steps(v, m, std::make_index_sequence<64>());
+        for (int i = 0; i < 4; ++i)
+            state[i] += v[i];
+    }
+}
+
+void MD4Compress(uint32_t* state, const unsigned char* blocks, size_t blockCount)
+{
+    uint32_t m[16];
+    for (size_t block = 0; block < blockCount; ++block, blocks += 64)
+    {
+        for (int i = 0; i < 16; ++i)
+            m[i] = LoadLE32(blocks + 4 * i);
+
+        uint32_t v[4] = { state[0], state[1], state[2], state[3] };
+        MD4Steps(v, m, std::make_index_sequence<48>());
+        for (int i = 0; i < 4; ++i)
+            state[i] += v[i];
+    }
+}
+
+// UTF-8 to UTF-16LE, bytes not forming a valid sequence are taken as Latin-1 characters
+void ToUTF16LE(const unsigned char* data, size_t length, std::vector<unsigned char>& out)
+{
+    out.clear();
+    for (size_t i = 0; i < length;)
+    {
+        uint32_t codePoint = data[i];
+        size_t size = 1;
+        if (codePoint >= 0xC2 && codePoint <= 0xF4)
+        {
+            const size_t extra = codePoint >= 0xF0 ? 3 : (codePoint >= 0xE0 ? 2 : 1);
+            uint32_t decoded = codePoint & (0x3F >> extra);
+            bool valid = i + extra < length;
+            for (size_t j = 1; valid && j <= extra; ++j)
+            {
+                valid = (data[i + j] & 0xC0) == 0x80;
+                decoded = (decoded << 6) | (data[i + j] & 0x3F);
+            }
+
+            const bool overlong = (extra == 2 && decoded < 0x800) || (extra == 3 && decoded < 0x10000);
+            const bool outOfRange = decoded > 0x10FFFF || (decoded >= 0xD800 && decoded <= 0xDFFF);
+            if (valid && !overlong && !outOfRange)
+            {
+                codePoint = decoded;
+                size = extra + 1;
+            }
+        }
+
+        if (codePoint >= 0x10000)
+        {
+            codePoint -= 0x10000;
+            const uint32_t high = 0xD800 + (codePoint >> 10);
+            const uint32_t low = 0xDC00 + (codePoint & 0x3FF);
+            out.push_back(static_cast<unsigned char>(high));
+            out.push_back(static_cast<unsigned char>(high >> 8));
+            out.push_back(static_cast<unsigned char>(low));
+            out.push_back(static_cast<unsigned char>(low >> 8));
+        }
+        else
+        {
+            out.push_back(static_cast<unsigned char>(codePoint));
+            out.push_back(static_cast<unsigned char>(codePoint >> 8));
+        }
+        i += size;
+    }
+}
+
+
+// Short message kernels. Padding words for a fixed length are compile-time constants, and since
+// the steps are unrolled, the constant words fold into the step constants.
+struct ShortWords
+{
+    bool var[16];       // word depends on the message
+    uint32_t value[16]; // constant word, or the padding bits of a partial one
+};
+
+// 0x80 terminator and little endian bit length for a message of given size in bytes
+constexpr ShortWords MakePadding(size_t length)
+{
+    ShortWords s{};
+    for (size_t i = 0; i < 16; ++i)
+        s.var[i] = 4 * i < length;
+
+    s.value[length / 4] |= 0x80u << (8 * (length % 4));
+    s.value[14] = static_cast<uint32_t>(length * 8);
+    return s;
+}
+
+template<size_t L>
+struct ShortPadding
+{
+    static constexpr ShortWords md5 = MakePadding(L);
+    static constexpr ShortWords ntlm = MakePadding(2 * L); // every char takes two bytes
+};
+
+template<size_t L>
+constexpr ShortWords ShortPadding<L>::md5;
+template<size_t L>
+constexpr ShortWords ShortPadding<L>::ntlm;
+
+template<size_t L, size_t T>
+inline void LoadMD5Word(uint32_t* m, const unsigned char* data)
+{
+    constexpr const ShortWords& s = ShortPadding<L>::md5;
+    if (!s.var[T])
+    {
+        m[T] = s.value[T];
+    }
+    else if (4 * T + 4 <= L)
+    {
+        m[T] = LoadLE32(data + 4 * T);
+    }
+    else
+    {
+        uint32_t x = s.value[T];
+        for (size_t i = 4 * T; i < L; ++i)
+            x |= static_cast<uint32_t>(data[i]) << (8 * (i - 4 * T));
+        m[T] = x;
+    }
+}
+
+// word T holds chars 2T and 2T + 1, zero extended to 16 bits
+template<size_t L, size_t T>
+inline void LoadNTLMWord(uint32_t* m, const unsigned char* data)
+{
+    constexpr const ShortWords& s = ShortPadding<L>::ntlm;
+    if (!s.var[T])
+        m[T] = s.value[T];
+    else if (2 * T + 2 <= L)
+        m[T] = static_cast<uint32_t>(data[2 * T]) | (static_cast<uint32_t>(data[2 * T + 1]) << 16);
+    else
+        m[T] = s.value[T] | static_cast<uint32_t>(data[2 * T]);
+}
+
+template<size_t L, size_t... T>
+inline void LoadMD5Words(uint32_t* m, const unsigned char* data, std::index_sequence<T...>)
+{
+    const int order[] = { (LoadMD5Word<L, T>(m, data), 0)... };
+    (void)order;
+}
+
+template<size_t L, size_t... T>
+inline void LoadNTLMWords(uint32_t* m, const unsigned char* data, std::index_sequence<T...>)
+{
+    const int order[] = { (LoadNTLMWord<L, T>(m, data), 0)... };
+    (void)order;
+}
+
+template<size_t L>
+void ShortMD5(const unsigned char* data, size_t, unsigned char* out)
+{
+    uint32_t m[16];
+    LoadMD5Words<L>(m, data, std::make_index_sequence<16>());
+
+    uint32_t v[4] = { MD_INIT[0], MD_INIT[1], MD_INIT[2], MD_INIT[3] };
+    MD5Steps(v, m, std::make_index_sequence<64>());
+    for (int i = 0; i < 4; ++i)
+        StoreLE32(out + 4 * i, MD_INIT[i] + v[i]);
+}
+
+template<size_t L>
+void ShortNTLM(const unsigned char* data, size_t length, unsigned char* out)
+{
+    // only ASCII maps to UTF-16 by zero extension
+    unsigned char high = 0;
+    for (size_t i = 0; i < L; ++i)
+        high |= data[i];
+    if (high & 0x80)
+    {
+        NTLM(data, length, out);
+        return;
+    }
+
+    uint32_t m[16];
+    LoadNTLMWords<L>(m, data, std::make_index_sequence<16>());
+
+    uint32_t v[4] = { MD_INIT[0], MD_INIT[1], MD_INIT[2], MD_INIT[3] };
+    MD4Steps(v, m, std::make_index_sequence<48>());
+    for (int i = 0; i < 4; ++i)
+        StoreLE32(out + 4 * i, MD_INIT[i] + v[i]);
+}
+
+// index 0 is unused - empty messages go through the generic kernels
+template<size_t... L>
+HashFunc SelectShortMD5(size_t length, std::index_sequence<L...>)
+{
+    static const HashFunc kernels[] = { nullptr, ShortMD5<L + 1>... };
+    return length < sizeof(kernels) / sizeof(kernels[0]) ? kernels[length] : nullptr;
+}
+
+template<size_t... L>
+HashFunc SelectShortNTLM(size_t length, std::index_sequence<L...>)
+{
+    static const HashFunc kernels[] = { nullptr, ShortNTLM<L + 1>... };
+    return length < sizeof(kernels) / sizeof(kernels[0]) ? kernels[length] : nullptr;
+}
+
+} // anonymous namespace
+
+
+void MD5(const unsigned char* data, size_t length, unsigned char* out)
+{
+    uint32_t state[4] = { MD_INIT[0], MD_INIT[1], MD_INIT[2], MD_INIT[3] };
+    Detail::ProcessMessage(state, data, length, false, MD5Compress);
+
+    for (int i = 0; i < 4; ++i)
+        StoreLE32(out + 4 * i, state[i]);
+}
+
+void NTLM(const unsigned char* data, size_t length, unsigned char* out)
+{
+    thread_local std::vector<unsigned char> message;
+    ToUTF16LE(data, length, message);
+
+    uint32_t state[4] = { MD_INIT[0], MD_INIT[1], MD_INIT[2], MD_INIT[3] };
+    Detail::ProcessMessage(state, message.data(), message.size(), false, MD4Compress);
+
+    for (int i = 0; i < 4; ++i)
+        StoreLE32(out + 4 * i, state[i]);
+}
+
+HashFunc GetShortMD5(size_t length)
+{
+    return SelectShortMD5(length, std::make_index_sequence<SHORT_MAX_LENGTH>());
+}
+
+HashFunc GetShortNTLM(size_t length)
+{
+    return SelectShortNTLM(length, std::make_index_sequence<SHORT_NTLM_MAX_LENGTH>());
+}
+
+} // namespace HashKernels
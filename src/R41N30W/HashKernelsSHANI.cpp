@@ -0,0 +1,334 @@
+#include "HashKernels.hpp"
+
+#include <cstring>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define R41N30W_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// GCC and Clang need the instruction sets enabled per function, MSVC allows intrinsics anywhere
+#if defined(R41N30W_X86) && (defined(__GNUC__) || defined(__clang__))
+#define SHANI_TARGET __attribute__((target("sha,sse4.1,ssse3")))
+#else
+#define SHANI_TARGET
+#endif
+
+
+namespace HashKernels {
+
+#ifdef R41N30W_X86
+
+namespace {
+
+const uint32_t SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+// four SHA-1 rounds per group, message words are kept in a ring of four registers:
+// at group G the ring holds W for groups G..G+3, partially expanded
+template<int G>
+SHANI_TARGET inline void SHA1Group(__m128i& abcd, __m128i& e0, __m128i& e1, __m128i* msg)
+{
+    __m128i& cur = msg[G % 4];
+
+    if (G == 0)
+    {
+        e0 = _mm_add_epi32(e0, cur);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, G / 5);
+    }
+    else if (G % 2 == 1)
+    {
+        e1 = _mm_sha1nexte_epu32(e1, cur);
+        e0 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, G / 5);
+    }
+    else
+    {
+        e0 = _mm_sha1nexte_epu32(e0, cur);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, G / 5);
+    }
+
+    if (G >= 3 && G <= 18)
+        msg[(G + 1) % 4] = _mm_sha1msg2_epu32(msg[(G + 1) % 4], cur);
+    if (G >= 1 && G <= 16)
+        msg[(G + 3) % 4] = _mm_sha1msg1_epu32(msg[(G + 3) % 4], cur);
+    if (G >= 2 && G <= 17)
+        msg[(G + 2) % 4] = _mm_xor_si128(msg[(G + 2) % 4], cur);
+}
+
+SHANI_TARGET void SHA1CompressSHANI(uint32_t* state, const unsigned char* blocks, size_t blockCount)
+{
+    const __m128i mask = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+
+    __m128i abcd = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state));
+    abcd = _mm_shuffle_epi32(abcd, 0x1B);
+    __m128i e0 = _mm_set_epi32(static_cast<int>(state[4]), 0, 0, 0);
+    __m128i e1;
+    __m128i msg[4];
+
+    for (size_t block = 0; block < blockCount; ++block, blocks += 64)
+    {
+        const __m128i abcdSave = abcd;
+        const __m128i e0Save = e0;
+
+        for (int i = 0; i < 4; ++i)
+            msg[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks + 16 * i)), mask);
+
+        SHA1Group<0>(abcd, e0, e1, msg);   SHA1Group<1>(abcd, e0, e1, msg);
+        SHA1Group<2>(abcd, e0, e1, msg);   SHA1Group<3>(abcd, e0, e1, msg);
+        SHA1Group<4>(abcd, e0, e1, msg);   SHA1Group<5>(abcd, e0, e1, msg);
+        SHA1Group<6>(abcd, e0, e1, msg);   SHA1Group<7>(abcd, e0, e1, msg);
+        SHA1Group<8>(abcd, e0, e1, msg);   SHA1Group<9>(abcd, e0, e1, msg);
+        SHA1Group<10>(abcd, e0, e1, msg);  SHA1Group<11>(abcd, e0, e1, msg);
+        SHA1Group<12>(abcd, e0, e1, msg);  SHA1Group<13>(abcd, e0, e1, msg);
+        SHA1Group<14>(abcd, e0, e1, msg);  SHA1Group<15>(abcd, e0, e1, msg);
+        SHA1Group<16>(abcd, e0, e1, msg);  SHA1Group<17>(abcd, e0, e1, msg);
+        SHA1Group<18>(abcd, e0, e1, msg);  SHA1Group<19>(abcd, e0, e1, msg);
+
+        e0 = _mm_sha1nexte_epu32(e0, e0Save);
+        abcd = _mm_add_epi32(abcd, abcdSave);
+    }
+
+    abcd = _mm_shuffle_epi32(abcd, 0x1B);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state), abcd);
+    state[4] = static_cast<uint32_t>(_mm_extract_epi32(e0, 3));
+}
+
+SHANI_TARGET void SHA256CompressSHANI(uint32_t* state, const unsigned char* blocks, size_t blockCount)
+{
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    // state is kept as ABEF/CDGH pairs, as sha256rnds2 expects
+    __m128i tmp = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state));
+    __m128i state1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state + 4));
+    tmp = _mm_shuffle_epi32(tmp, 0xB1);
+    state1 = _mm_shuffle_epi32(state1, 0x1B);
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+    __m128i msg[4];
+    for (size_t block = 0; block < blockCount; ++block, blocks += 64)
+    {
+        const __m128i abefSave = state0;
+        const __m128i cdghSave = state1;
+
+        for (int i = 0; i < 4; ++i)
+            msg[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks + 16 * i)), mask);
+
+        for (int g = 0; g < 16; ++g)
+        {
+            __m128i& cur = msg[g % 4];
+            __m128i words = _mm_add_epi32(cur, _mm_loadu_si128(reinterpret_cast<const __m128i*>(SHA256_K + 4 * g)));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, words);
+
+            if (g >= 3 && g <= 14)
+            {
+                __m128i& next = msg[(g + 1) % 4];
+                next = _mm_add_epi32(next, _mm_alignr_epi8(cur, msg[(g + 3) % 4], 4));
+                next = _mm_sha256msg2_epu32(next, cur);
+            }
+
+            words = _mm_shuffle_epi32(words, 0x0E);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, words);
+
+            if (g >= 1 && g <= 12)
+                msg[(g + 3) % 4] = _mm_sha256msg1_epu32(msg[(g + 3) % 4], cur);
+        }
+
+        state0 = _mm_add_epi32(state0, abefSave);
+        state1 = _mm_add_epi32(state1, cdghSave);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+    state1 = _mm_alignr_epi8(state1, tmp, 8);
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state), state0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state + 4), state1);
+}
+
+void StoreBE32(unsigned char* p, uint32_t x)
+{
+    p[0] = static_cast<unsigned char>(x >> 24);
+    p[1] = static_cast<unsigned char>(x >> 16);
+    p[2] = static_cast<unsigned char>(x >> 8);
+    p[3] = static_cast<unsigned char>(x);
+}
+
+// padded single block for a fixed message length, the message is copied over its start
+struct ShortBlock
+{
+    unsigned char bytes[64];
+};
+
+constexpr ShortBlock MakeShortBlock(size_t length)
+{
+    ShortBlock block{};
+    block.bytes[length] = 0x80;
+    block.bytes[62] = static_cast<unsigned char>((length * 8) >> 8);
+    block.bytes[63] = static_cast<unsigned char>(length * 8);
+    return block;
+}
+
+template<size_t L>
+struct ShortBlocks
+{
+    static constexpr ShortBlock block = MakeShortBlock(L);
+};
+
+template<size_t L>
+constexpr ShortBlock ShortBlocks<L>::block;
+
+template<size_t L>
+void ShortSHA1(const unsigned char* data, size_t, unsigned char* out)
+{
+    unsigned char block[64];
+    std::memcpy(block, ShortBlocks<L>::block.bytes, sizeof(block));
+    std::memcpy(block, data, L);
+
+    uint32_t state[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    SHA1CompressSHANI(state, block, 1);
+    for (int i = 0; i < 5; ++i)
+        StoreBE32(out + 4 * i, state[i]);
+}
+
+template<size_t L>
+void ShortSHA256(const unsigned char* data, size_t, unsigned char* out)
+{
+    unsigned char block[64];
+    std::memcpy(block, ShortBlocks<L>::block.bytes, sizeof(block));
+    std::memcpy(block, data, L);
+
+    uint32_t state[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+    SHA256CompressSHANI(state, block, 1);
+    for (int i = 0; i < 8; ++i)
+        StoreBE32(out + 4 * i, state[i]);
+}
+
+// index 0 is unused - empty messages go through the generic kernels
+template<size_t... L>
+HashFunc SelectShortSHA1(size_t length, std::index_sequence<L...>)
+{
+    static const HashFunc kernels[] = { nullptr, ShortSHA1<L + 1>... };
+    return length < sizeof(kernels) / sizeof(kernels[0]) ? kernels[length] : nullptr;
+}
+
+template<size_t... L>
+HashFunc SelectShortSHA256(size_t length, std::index_sequence<L...>)
+{
+    static const HashFunc kernels[] = { nullptr, ShortSHA256<L + 1>... };
+    return length < sizeof(kernels) / sizeof(kernels[0]) ? kernels[length] : nullptr;
+}
+
+bool DetectSHAExtensions()
+{
+    unsigned int regs1[4] = { 0 };
+    unsigned int regs7[4] = { 0 };
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    __cpuid(info, 1);
+    for (int i = 0; i < 4; ++i)
+        regs1[i] = static_cast<unsigned int>(info[i]);
+    __cpuidex(info, 7, 0);
+    for (int i = 0; i < 4; ++i)
+        regs7[i] = static_cast<unsigned int>(info[i]);
+#else
+    if (__get_cpuid_max(0, nullptr) < 7)
+        return false;
+    __get_cpuid(1, &regs1[0], &regs1[1], &regs1[2], &regs1[3]);
+    __get_cpuid_count(7, 0, &regs7[0], &regs7[1], &regs7[2], &regs7[3]);
+#endif
+
+    const bool ssse3 = (regs1[2] & (1u << 9)) != 0;
+    const bool sse41 = (regs1[2] & (1u << 19)) != 0;
+    const bool sha = (regs7[1] & (1u << 29)) != 0;
+    return ssse3 && sse41 && sha;
+}
+
+} // anonymous namespace
+
+
+bool HasSHAExtensions()
+{
+    static const bool supported = DetectSHAExtensions();
+    return supported;
+}
+
+void SHA1_SHANI(const unsigned char* data, size_t length, unsigned char* out)
+{
+    uint32_t state[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    Detail::ProcessMessage(state, data, length, true, SHA1CompressSHANI);
+
+    for (int i = 0; i < 5; ++i)
+        StoreBE32(out + 4 * i, state[i]);
+}
+
+void SHA256_SHANI(const unsigned char* data, size_t length, unsigned char* out)
+{
+    uint32_t state[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+    Detail::ProcessMessage(state, data, length, true, SHA256CompressSHANI);
+
+    for (int i = 0; i < 8; ++i)
+        StoreBE32(out + 4 * i, state[i]);
+}
+
+HashFunc GetShortSHA1_SHANI(size_t length)
+{
+    return SelectShortSHA1(length, std::make_index_sequence<SHORT_MAX_LENGTH>());
+}
+
+HashFunc GetShortSHA256_SHANI(size_t length)
+{
+    return SelectShortSHA256(length, std::make_index_sequence<SHORT_MAX_LENGTH>());
+}
+
+#else // R41N30W_X86
+
+bool HasSHAExtensions()
+{
+    return false;
+}
+
+void SHA1_SHANI(const unsigned char* data, size_t length, unsigned char* out)
+{
+    SHA1(data, length, out);
+}
+
+void SHA256_SHANI(const unsigned char* data, size_t length, unsigned char* out)
+{
+    SHA256(data, length, out);
+}
+
+HashFunc GetShortSHA1_SHANI(size_t length)
+{
+    return GetShortSHA1(length);
+}
+
+HashFunc GetShortSHA256_SHANI(size_t length)
+{
+    return GetShortSHA256(length);
+}
+
+#endif // R41N30W_X86
+
+} // namespace HashKernels
@@ -0,0 +1,68 @@
+#include "HyperLogLog.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+
+namespace {
+
+const unsigned int PRECISION = 16; // bits of the key picking the register
+const size_t REGISTERS = size_t(1) << PRECISION;
+
+} // anonymous namespace
+
+
+HyperLogLog::HyperLogLog()
+    : mRegisters(REGISTERS, 0)
+{
+}
+
+void HyperLogLog::Add(const unsigned char* hash)
+{
+    uint64_t key = 0;
+    std::memcpy(&key, hash, sizeof(key));
+
+    // the remaining bits, with a stop bit so the rank never runs past them
+    uint64_t rest = (key << PRECISION) | (uint64_t(1) << (PRECISION - 1));
+    uint8_t rank = 1;
+    while ((rest & (uint64_t(1) << 63)) == 0)
+    {
+        rest <<= 1;
+        rank++;
+    }
+
+    uint8_t& reg = mRegisters[key >> (64 - PRECISION)];
+    reg = std::max(reg, rank);
+}
+
+void HyperLogLog::Merge(const HyperLogLog& other)
+{
+    for (size_t i = 0; i < REGISTERS; ++i)
+        mRegisters[i] = std::max(mRegisters[i], other.mRegisters[i]);
+}
+
+double HyperLogLog::Estimate() const
+{
+    const double m = static_cast<double>(REGISTERS);
+    double sum = 0.0;
+    size_t zeros = 0;
+    for (uint8_t reg : mRegisters)
+    {
+        sum += std::ldexp(1.0, -static_cast<int>(reg));
+        zeros += (reg == 0) ? 1 : 0;
+    }
+
+    const double alpha = 0.7213 / (1.0 + 1.079 / m);
+    const double estimate = alpha * m * m / sum;
+
+    // small counts leave registers empty - linear counting is exact enough there
+    if (estimate <= 2.5 * m && zeros > 0)
+        return m * std::log(m / static_cast<double>(zeros));
+    return estimate;
+}
+
+double HyperLogLog::RelativeError()
+{
+    return 1.04 / std::sqrt(static_cast<double>(REGISTERS));
+}
@@ -0,0 +1,184 @@
+#include "LookupScheduler.hpp"
+
+#include <atomic>
+#include "Utils.hpp"
+
+
+namespace {
+
+// chain steps a slice walks - a few milliseconds, the longest a high priority query waits for a worker
+const uint64_t SLICE_STEPS = 1 << 18;
+// positions of a slice at least, so chain batches stay full
+const uint32_t SLICE_MIN_POSITIONS = 32;
+
+} // anonymous namespace
+
+
+struct LookupScheduler::Query
+{
+    ucharVector hashValue;
+    uint64_t submitted;
+    uint64_t deadline; // 0 for none
+    uint32_t positions; // chain positions of the table
+
+    std::mutex mutex;
+    std::atomic<bool> decided; // later slices are skipped once set
+    uint32_t pendingSlices;
+    Result result;
+    Callback callback;
+};
+
+LookupScheduler::LookupScheduler(RainbowTable& table, uint32_t threadCount)
+    : mTable(table)
+    , mFreq(GetClockFreq())
+    , mOwnedPool(new ThreadPool(threadCount))
+    , mExecutor(*mOwnedPool)
+    , mMutex()
+    , mIdle()
+    , mSlices()
+    , mSequence(0)
+    , mPosted(0)
+    , mStopping(false)
+{
+}
+
+LookupScheduler::LookupScheduler(RainbowTable& table, Executor& executor)
+    : mTable(table)
+    , mFreq(GetClockFreq())
+    , mOwnedPool()
+    , mExecutor(executor)
+    , mMutex()
+    , mIdle()
+    , mSlices()
+    , mSequence(0)
+    , mPosted(0)
+    , mStopping(false)
+{
+}
+
+LookupScheduler::~LookupScheduler()
+{
+    // posted tasks refer to the scheduler - each still takes a slice, just without walking it
+    std::unique_lock<std::mutex> lock(mMutex);
+    mStopping = true;
+    mIdle.wait(lock, [this]() { return mPosted == 0; });
+}
+
+bool LookupScheduler::Later::operator()(const Slice& a, const Slice& b) const
+{
+    if (a.priority != b.priority)
+        return a.priority < b.priority;
+    if (a.deadline != b.deadline)
+        return a.deadline > b.deadline;
+    return a.sequence > b.sequence;
+}
+
+std::future<LookupScheduler::Result> LookupScheduler::Submit(const ucharVector& hashValue, double timeoutSeconds, Priority priority)
+{
+    std::shared_ptr<std::promise<Result>> promise = std::make_shared<std::promise<Result>>();
+    std::future<Result> future = promise->get_future();
+    Submit(hashValue, timeoutSeconds, priority, [promise](const Result& result) { promise->set_value(result); });
+    return future;
+}
+
+void LookupScheduler::Submit(const ucharVector& hashValue, double timeoutSeconds, Priority priority, Callback callback)
+{
+    Result invalid;
+    invalid.status = Result::Status::INVALID;
+    const RainbowTable::LoadState state = mTable.GetLoadState();
+    if (state == RainbowTable::LoadState::EMPTY || state == RainbowTable::LoadState::FAILED)
+        invalid.error = "No table is loaded";
+    else if (hashValue.size() != mTable.GetHashLength())
+        invalid.error = "Hash has to be " + std::to_string(mTable.GetHashLength()) + " bytes long, not " + std::to_string(hashValue.size());
+    if (!invalid.error.empty())
+    {
+        // delivered like any other result, so the caller is never called back from within Submit
+        mExecutor.Post([callback, invalid]() { callback(invalid); });
+        return;
+    }
+
+    std::shared_ptr<Query> query = std::make_shared<Query>();
+    query->hashValue = hashValue;
+    query->submitted = GetTime();
+    query->deadline = timeoutSeconds > 0.0 ? query->submitted + static_cast<uint64_t>(timeoutSeconds * static_cast<double>(mFreq)) : 0;
+    query->positions = mTable.GetChainSteps() + 1;
+    query->decided = false;
+    query->pendingSlices = 0;
+    query->callback = std::move(callback);
+
+    // position p walks the tail of chainSteps - p steps - slices are cut from the cheap end
+    std::vector<std::pair<uint32_t, uint32_t>> ranges;
+    const uint32_t chainSteps = mTable.GetChainSteps();
+    uint64_t steps = 0;
+    uint32_t first = chainSteps;
+    for (uint32_t position = chainSteps; ; --position)
+    {
+        steps += chainSteps - position + 1;
+        if (position == 0 || (steps >= SLICE_STEPS && first - position + 1 >= SLICE_MIN_POSITIONS))
+        {
+            ranges.emplace_back(first, position);
+            steps = 0;
+            first = position - 1;
+        }
+        if (position == 0)
+            break;
+    }
+    query->pendingSlices = static_cast<uint32_t>(ranges.size());
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (const auto& range : ranges)
+            mSlices.push({ query, range.first, range.second, priority, query->deadline ? query->deadline : UINT64_MAX, mSequence++ });
+        mPosted += static_cast<uint32_t>(ranges.size());
+    }
+    for (size_t i = 0; i < ranges.size(); ++i)
+        mExecutor.Post([this]() { RunNext(); });
+}
+
+void LookupScheduler::RunNext()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    Slice slice = mSlices.top();
+    mSlices.pop();
+    const bool stopping = mStopping;
+    lock.unlock();
+
+    // slices of decided or expired queries are only accounted for
+    Query& query = *slice.query;
+    LookupStats stats;
+    LookupHit hit;
+    std::string password;
+    if (!stopping && !query.decided && (query.deadline == 0 || GetTime() < query.deadline))
+        password = mTable.FindPasswordInPositions(query.hashValue, slice.first, slice.last, query.deadline, stats, &hit);
+    Complete(query, password, hit, stats);
+
+    lock.lock();
+    if (--mPosted == 0)
+        mIdle.notify_all();
+}
+
+void LookupScheduler::Complete(Query& query, const std::string& password, const LookupHit& hit, const LookupStats& stats)
+{
+    std::unique_lock<std::mutex> lock(query.mutex);
+    query.result.stats += stats;
+    query.pendingSlices--;
+    if (query.decided || (password.empty() && query.pendingSlices > 0))
+        return;
+
+    // found, or no slices left - whatever was not checked by now is not going to be
+    Result& result = query.result;
+    result.password = password;
+    result.hit = hit;
+    result.coverage = static_cast<double>(result.stats.positions) / static_cast<double>(query.positions);
+    result.seconds = static_cast<double>(GetTime() - query.submitted) / static_cast<double>(mFreq);
+    if (!password.empty())
+        result.status = Result::Status::FOUND;
+    else
+        result.status = result.stats.positions >= query.positions ? Result::Status::NOT_FOUND : Result::Status::TIMED_OUT;
+
+    // slices still running add their stats to query.result, so a copy is delivered
+    query.decided = true;
+    const Result decided = result;
+    lock.unlock();
+    query.callback(decided);
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <vector>
+#include "Executor.hpp"
+#include "RainbowTable.hpp"
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#include <coroutine>
+#define RAINBOW_LOOKUP_COROUTINES 1
+#endif
+#endif
+
+
+// Shared lookup workers for queries with a deadline and a priority. Every query is split into
+// slices of chain positions of about equal cost, cheapest positions first. Workers take the slice
+// of the highest priority, then of the earliest deadline, then of the oldest query - so a high
+// priority query overtakes batch work at the next slice boundary, and a query that runs out of
+// time has checked the cheap positions, which are the likely ones to hit.
+// Slices run on an Executor - either one the caller hands in, shared with its own work so
+// concurrent lookups do not add threads, or a pool of threadCount workers owned by the scheduler.
+class LookupScheduler
+{
+public:
+    enum class Priority
+    {
+        BATCH = 0,
+        NORMAL,
+        HIGH,
+    };
+
+    struct Result
+    {
+        enum class Status
+        {
+            FOUND,
+            NOT_FOUND, // all chain positions were checked
+            TIMED_OUT, // deadline passed first, coverage tells how far the lookup got
+            INVALID, // nothing was checked, error tells why
+        };
+
+        Status status;
+        std::string password;
+        LookupHit hit; // chain and position of the password when found
+        std::string error;
+        double coverage; // fraction of chain positions checked
+        double seconds; // from Submit to the result
+        LookupStats stats;
+
+        Result()
+            : status(Status::NOT_FOUND)
+            , password()
+            , hit()
+            , error()
+            , coverage(0.0)
+            , seconds(0.0)
+            , stats()
+        {
+        }
+    };
+
+    typedef std::function<void(const Result&)> Callback;
+
+    LookupScheduler(RainbowTable& table, uint32_t threadCount);
+    // executor has to outlive the scheduler
+    LookupScheduler(RainbowTable& table, Executor& executor);
+    // queued queries are finished as timed out, running slices are waited for
+    ~LookupScheduler();
+
+    LookupScheduler(const LookupScheduler&) = delete;
+    LookupScheduler& operator=(const LookupScheduler&) = delete;
+
+    // hashValue is the binary digest, timeoutSeconds <= 0 means no deadline
+    std::future<Result> Submit(const ucharVector& hashValue, double timeoutSeconds, Priority priority);
+    // callback runs once, on an executor thread - it must not destroy the scheduler
+    void Submit(const ucharVector& hashValue, double timeoutSeconds, Priority priority, Callback callback);
+
+#ifdef RAINBOW_LOOKUP_COROUTINES
+    struct Awaitable
+    {
+        LookupScheduler& scheduler;
+        ucharVector hashValue;
+        double timeoutSeconds;
+        Priority priority;
+        Result result;
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        // the coroutine resumes on an executor thread
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            scheduler.Submit(hashValue, timeoutSeconds, priority, [this, handle](const Result& lookupResult)
+            {
+                result = lookupResult;
+                handle.resume();
+            });
+        }
+
+        Result await_resume()
+        {
+            return std::move(result);
+        }
+    };
+
+    // co_await scheduler.Lookup(...) - available when compiled as C++20
+    Awaitable Lookup(const ucharVector& hashValue, double timeoutSeconds, Priority priority)
+    {
+        return Awaitable{ *this, hashValue, timeoutSeconds, priority, Result() };
+    }
+#endif
+
+private:
+    struct Query;
+
+    struct Slice
+    {
+        std::shared_ptr<Query> query;
+        uint32_t first; // chain positions first down to last
+        uint32_t last;
+        Priority priority;
+        uint64_t deadline; // UINT64_MAX for none, so it orders last
+        uint64_t sequence;
+    };
+
+    // order of the priority queue - true when a is to be taken after b
+    struct Later
+    {
+        bool operator()(const Slice& a, const Slice& b) const;
+    };
+
+    // one is posted per slice - runs whichever slice is first by then
+    void RunNext();
+    // takes over work done on a slice, delivers the result when the query is decided
+    void Complete(Query& query, const std::string& password, const LookupHit& hit, const LookupStats& stats);
+
+    RainbowTable& mTable;
+    uint64_t mFreq;
+    std::unique_ptr<ThreadPool> mOwnedPool; // when constructed with a thread count
+    Executor& mExecutor;
+    std::mutex mMutex;
+    std::condition_variable mIdle;
+    std::priority_queue<Slice, std::vector<Slice>, Later> mSlices;
+    uint64_t mSequence;
+    uint32_t mPosted; // RunNext tasks not finished yet
+    bool mStopping;
+};
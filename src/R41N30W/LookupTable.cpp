@@ -0,0 +1,453 @@
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include "Common.hpp"
+#include "LookupTable.hpp"
+#include "Profiler.hpp"
+
+
+const std::string LOOKUP_MAGIC_FILE = "RLUT"; // Rainbow LookUp Table
+
+namespace {
+
+/**
+ * File structure:
+ * Header:
+ *   -> MAGIC (4 bytes)
+ *   -> hash function ID (4 bytes)
+ *   -> password length (4 bytes)
+ *   -> index bits (4 bytes)
+ *   -> bucket bits (4 bytes)
+ *   -> reserved (4 bytes)
+ *   -> entry count (8 bytes)
+ * Data, 8-byte aligned so the file can be used straight from a memory mapping:
+ *   -> bucket offsets (2^bucket bits + 1 entries, 8 bytes each)
+ *   -> sorted keys (entry count, 8 bytes each)
+ */
+struct LookupHeader
+{
+    char magic[4];
+    uint32_t hashID;
+    uint32_t passwordLength;
+    uint32_t indexBits;
+    uint32_t bucketBits;
+    uint32_t reserved;
+    uint64_t entryCount;
+};
+
+static_assert(sizeof(LookupHeader) == 32, "Lookup table header must stay packed");
+
+// coarse partitions used to scatter keys before sorting - keeps per-thread histograms small
+const uint32_t MAX_PARTITION_BITS = 12;
+// passwords hashed between progress counter updates
+const uint64_t PROGRESS_STEP = 1 << 16;
+
+} // anonymous namespace
+
+
+LookupTable::LookupTable(uint32_t passwordLength, OSSLHasher::HashType hashType)
+    : mHashFunc(OSSLHasher::GetHashFunc(hashType, passwordLength))
+    , mHashType(hashType)
+    , mHashLen(static_cast<uint32_t>(OSSLHasher::GetHashSize(hashType)))
+    , mPasswordLength(passwordLength)
+    , mThreadCount(1)
+    , mIndexBits(0)
+    , mBucketBits(0)
+    , mEntryCount(0)
+    , mOffsets(nullptr)
+    , mEntries(nullptr)
+{
+}
+
+LookupTable::~LookupTable()
+{
+}
+
+void LookupTable::SetThreadCount(uint32_t threadCount)
+{
+    if (threadCount > hardwareConcurrency())
+    {
+        threadCount = hardwareConcurrency();
+        std::cout << "Requested more threads than system can handle - reducing to " << threadCount << std::endl;
+    }
+
+    mThreadCount = threadCount ? threadCount : 1;
+}
+
+void LookupTable::LogTableInfo()
+{
+    std::cout << "\tHash function:\t\t" << OSSLHasher::GetHashFuncName(mHashType) << std::endl;
+    std::cout << "\tHash backend:\t\t" << OSSLHasher::GetBackendName(mHashType) << std::endl;
+    std::cout << "\tTable type:\t\tlookup" << std::endl;
+    std::cout << "\tTable size:\t\t" << mEntryCount << std::endl;
+    std::cout << "\tPassword length:\t" << mPasswordLength << std::endl;
+    std::cout << "\tPrefix bits:\t\t" << 64 - mIndexBits << std::endl;
+}
+
+bool LookupTable::CreateTable()
+{
+    Profiler::ScopedTimer timer("generate");
+    // lookup tables store every password, so the keyspace has to fit in 32-bit indices
+    uint64_t keyspace = Common::KeyspaceSize(mPasswordLength);
+    if (keyspace == 0 || keyspace > (1ull << 32))
+    {
+        std::cout << "Keyspace for password length " << mPasswordLength << " is too big for a lookup table." << std::endl;
+        std::cout << "Use a Rainbow Table for passwords of this length instead." << std::endl;
+        return false;
+    }
+
+    if (mPasswordLength == 0 || mHashLen < sizeof(uint64_t))
+    {
+        std::cout << "Cannot create lookup table with given parameters." << std::endl;
+        return false;
+    }
+
+    mEntryCount = keyspace;
+    mIndexBits = 1;
+    while ((1ull << mIndexBits) < keyspace)
+        mIndexBits++;
+    // ~16 entries per bucket keeps a probe within a couple of cache lines
+    mBucketBits = mIndexBits > 5 ? mIndexBits - 4 : 1;
+
+    std::cout << "Threads used: " << mThreadCount << std::endl;
+    std::cout << "Creating lookup table with parameters:" << std::endl;
+    LogTableInfo();
+
+    uint64_t start = GetTime();
+
+    // hash the whole keyspace
+    std::vector<uint64_t> keys(static_cast<size_t>(mEntryCount));
+    mProgress.Start("generate", mEntryCount);
+    {
+        std::vector<std::future<void>> results;
+        uint64_t perThread = (mEntryCount + mThreadCount - 1) / mThreadCount;
+        for (uint32_t i = 0; i < mThreadCount; ++i)
+        {
+            uint64_t begin = std::min(mEntryCount, i * perThread);
+            uint64_t end = std::min(mEntryCount, begin + perThread);
+            results.push_back(std::async(std::launch::async, &LookupTable::CreateEntries, this, begin, end, keys.data()));
+        }
+        for (auto& i : results)
+            i.wait();
+    }
+    mProgress.Stop();
+
+    // scatter keys into coarse partitions by their top bits
+    const uint32_t partitionBits = std::min(mBucketBits, MAX_PARTITION_BITS);
+    const size_t partitions = static_cast<size_t>(1) << partitionBits;
+    const uint64_t perThread = (mEntryCount + mThreadCount - 1) / mThreadCount;
+    std::vector<std::vector<uint64_t>> histograms(mThreadCount, std::vector<uint64_t>(partitions, 0));
+    {
+        std::vector<std::future<void>> results;
+        for (uint32_t t = 0; t < mThreadCount; ++t)
+        {
+            results.push_back(std::async(std::launch::async, [&, t]()
+            {
+                uint64_t begin = std::min(mEntryCount, t * perThread);
+                uint64_t end = std::min(mEntryCount, begin + perThread);
+                for (uint64_t i = begin; i < end; ++i)
+                    histograms[t][keys[i] >> (64 - partitionBits)]++;
+            }));
+        }
+        for (auto& i : results)
+            i.wait();
+    }
+
+    std::vector<uint64_t> partitionStart(partitions + 1, 0);
+    {
+        uint64_t position = 0;
+        for (size_t p = 0; p < partitions; ++p)
+        {
+            partitionStart[p] = position;
+            for (uint32_t t = 0; t < mThreadCount; ++t)
+            {
+                uint64_t count = histograms[t][p];
+                histograms[t][p] = position; // reuse as thread's write cursor
+                position += count;
+            }
+        }
+        partitionStart[partitions] = position;
+    }
+
+    mEntryStorage.resize(static_cast<size_t>(mEntryCount));
+    {
+        std::vector<std::future<void>> results;
+        for (uint32_t t = 0; t < mThreadCount; ++t)
+        {
+            results.push_back(std::async(std::launch::async, [&, t]()
+            {
+                uint64_t begin = std::min(mEntryCount, t * perThread);
+                uint64_t end = std::min(mEntryCount, begin + perThread);
+                for (uint64_t i = begin; i < end; ++i)
+                    mEntryStorage[histograms[t][keys[i] >> (64 - partitionBits)]++] = keys[i];
+            }));
+        }
+        for (auto& i : results)
+            i.wait();
+    }
+    std::vector<uint64_t>().swap(keys);
+
+    // sort partitions and fill in bucket offsets
+    const uint64_t bucketCount = 1ull << mBucketBits;
+    const uint64_t bucketsPerPartition = bucketCount / partitions;
+    mOffsetStorage.resize(static_cast<size_t>(bucketCount + 1));
+    {
+        std::atomic<size_t> nextPartition(0);
+        std::vector<std::future<void>> results;
+        for (uint32_t t = 0; t < mThreadCount; ++t)
+        {
+            results.push_back(std::async(std::launch::async, [&]()
+            {
+                for (size_t p = nextPartition++; p < partitions; p = nextPartition++)
+                {
+                    uint64_t* begin = mEntryStorage.data() + partitionStart[p];
+                    uint64_t* end = mEntryStorage.data() + partitionStart[p + 1];
+                    std::sort(begin, end);
+
+                    uint64_t position = partitionStart[p];
+                    for (uint64_t b = p * bucketsPerPartition; b < (p + 1) * bucketsPerPartition; ++b)
+                    {
+                        mOffsetStorage[static_cast<size_t>(b)] = position;
+                        while (position < partitionStart[p + 1] && (mEntryStorage[static_cast<size_t>(position)] >> (64 - mBucketBits)) == b)
+                            position++;
+                    }
+                }
+            }));
+        }
+        for (auto& i : results)
+            i.wait();
+    }
+    mOffsetStorage[static_cast<size_t>(bucketCount)] = mEntryCount;
+
+    mOffsets = mOffsetStorage.data();
+    mEntries = mEntryStorage.data();
+
+    uint64_t diff = static_cast<uint64_t>(static_cast<double>(GetTime() - start) / static_cast<double>(GetClockFreq()));
+    std::cout << std::endl << "Lookup table with " << mEntryCount << " entries built in ";
+    PrettyLogTime(diff);
+    std::cout << std::endl;
+    return true;
+}
+
+void LookupTable::CreateEntries(uint64_t begin, uint64_t end, uint64_t* keys)
+{
+    if (begin >= end)
+        return;
+
+    ucharVector hashValue;
+    hashValue.resize(mHashLen);
+    ucharVector plainValue;
+    Common::IndexToPassword(begin, mPasswordLength, plainValue);
+
+    // password digits, least significant first - advanced like an odometer
+    std::vector<unsigned int> digits(mPasswordLength);
+    uint64_t index = begin;
+    for (auto& d : digits)
+    {
+        d = static_cast<unsigned int>(index % Common::CharsetLength);
+        index /= Common::CharsetLength;
+    }
+
+    const uint64_t prefixMask = ~((1ull << mIndexBits) - 1);
+    for (uint64_t i = begin; i < end; ++i)
+    {
+        mHashFunc(plainValue, hashValue);
+        keys[i] = (DigestPrefix(hashValue) & prefixMask) | i;
+        if ((i - begin + 1) % PROGRESS_STEP == 0)
+        {
+            mProgress.AddDone(PROGRESS_STEP);
+            mProgress.AddHashes(PROGRESS_STEP);
+        }
+
+        for (uint32_t d = 0; d < mPasswordLength; ++d)
+        {
+            if (++digits[d] < Common::CharsetLength)
+            {
+                plainValue[d] = Common::Charset[digits[d]];
+                break;
+            }
+            digits[d] = 0;
+            plainValue[d] = Common::Charset[0];
+        }
+    }
+    mProgress.AddDone((end - begin) % PROGRESS_STEP);
+    mProgress.AddHashes((end - begin) % PROGRESS_STEP);
+    Profiler::Add(Profiler::Counter::HashCalls, end - begin);
+}
+
+uint64_t LookupTable::DigestPrefix(const ucharVector& hashValue) const
+{
+    uint64_t prefix = 0;
+    for (size_t i = 0; i < sizeof(uint64_t); ++i)
+        prefix = (prefix << 8) | hashValue[i];
+    return prefix;
+}
+
+std::string LookupTable::FindPassword(const std::string& hashedPassword)
+{
+    if (mEntryCount == 0)
+        return "";
+
+    // hash in string form takes two chars for each byte
+    if (hashedPassword.size() != (mHashLen * 2))
+    {
+        std::cout << "Hash length mismatch! Hashed passwords in the table are " << mHashLen*2 << " chars long (" << mHashLen << " bytes)" << std::endl;
+        std::cout << "and provided hash is " << hashedPassword.size() << " chars long (" << hashedPassword.size() / 2 << " bytes)" << std::endl;
+        return "";
+    }
+
+    ucharVector hashValue;
+    hashValue.reserve(mHashLen);
+    if (!StrToHash(hashedPassword, hashValue))
+    {
+        std::cout << "Hash \"" << hashedPassword << "\" is not in hex form!" << std::endl;
+        return "";
+    }
+    return FindPassword(hashValue);
+}
+
+std::string LookupTable::FindPassword(const ucharVector& hashValue)
+{
+    if (mEntryCount == 0 || hashValue.size() != mHashLen)
+        return "";
+
+    Profiler::ScopedTimer timer("lookup");
+    Profiler::Add(Profiler::Counter::DictionaryProbes, 1);
+    const uint64_t digest = DigestPrefix(hashValue);
+    const uint64_t prefix = digest >> mIndexBits;
+    const uint64_t bucket = digest >> (64 - mBucketBits);
+    const uint64_t indexMask = (1ull << mIndexBits) - 1;
+
+    ucharVector plainValue;
+    ucharVector candidateHash;
+    candidateHash.resize(mHashLen);
+
+    for (uint64_t i = mOffsets[bucket]; i < mOffsets[bucket + 1]; ++i)
+    {
+        uint64_t entryPrefix = mEntries[i] >> mIndexBits;
+        if (entryPrefix > prefix)
+            break;
+        if (entryPrefix < prefix)
+            continue;
+
+        // prefixes are truncated - confirm with a full hash
+        Common::IndexToPassword(mEntries[i] & indexMask, mPasswordLength, plainValue);
+        mHashFunc(plainValue, candidateHash);
+        Profiler::Add(Profiler::Counter::HashCalls, 1);
+        if (candidateHash == hashValue)
+            return std::string(plainValue.begin(), plainValue.end());
+        Profiler::Add(Profiler::Counter::FalseAlarms, 1);
+    }
+
+    return "";
+}
+
+bool LookupTable::Save(const std::string& filename)
+{
+    if (mEntryCount == 0)
+        return false;
+
+    std::cout << "Saving table to file \"" << filename << "\"\n";
+    Profiler::ScopedTimer timer("save");
+    std::ofstream file(filename, std::ofstream::binary);
+    if (!file)
+    {
+        std::cout << "Unable to open file \"" << filename << "\"!\n";
+        return false;
+    }
+
+    LookupHeader header;
+    std::copy(LOOKUP_MAGIC_FILE.begin(), LOOKUP_MAGIC_FILE.end(), header.magic);
+    header.hashID = static_cast<uint32_t>(mHashType);
+    header.passwordLength = mPasswordLength;
+    header.indexBits = mIndexBits;
+    header.bucketBits = mBucketBits;
+    header.reserved = 0;
+    header.entryCount = mEntryCount;
+
+    const uint64_t bucketCount = 1ull << mBucketBits;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(mOffsets), (bucketCount + 1) * sizeof(uint64_t));
+    file.write(reinterpret_cast<const char*>(mEntries), mEntryCount * sizeof(uint64_t));
+    file.close();
+
+    if (!file)
+    {
+        std::cout << "Failed to write table to file \"" << filename << "\"!\n";
+        return false;
+    }
+
+    std::cout << "Saved table:" << std::endl;
+    LogTableInfo();
+    return true;
+}
+
+bool LookupTable::Load(const std::string& filename)
+{
+    Profiler::ScopedTimer timer("load");
+    std::cout << "Loading table from file \"" << filename << "\"\n";
+    if (!mFile.Open(filename))
+    {
+        std::cout << "Unable to open file \"" << filename << "\"!\n";
+        return false;
+    }
+
+    LookupHeader header;
+    if (mFile.Size() < sizeof(header))
+    {
+        std::cout << "Provided file is not a proper R41N30W lookup table file." << std::endl;
+        return false;
+    }
+    std::copy(mFile.Data(), mFile.Data() + sizeof(header), reinterpret_cast<unsigned char*>(&header));
+
+    if (LOOKUP_MAGIC_FILE.compare(0, 4, header.magic, 4) != 0 || header.indexBits == 0 || header.indexBits > 32
+        || header.bucketBits == 0 || header.bucketBits > header.indexBits)
+    {
+        std::cout << "Provided file is not a proper R41N30W lookup table file." << std::endl;
+        return false;
+    }
+
+    mHashType = static_cast<OSSLHasher::HashType>(header.hashID);
+    mHashFunc = OSSLHasher::GetHashFunc(mHashType, header.passwordLength);
+    if (!mHashFunc)
+    {
+        std::cout << "Unrecognized hash function type." << std::endl;
+        return false;
+    }
+
+    mHashLen = static_cast<uint32_t>(OSSLHasher::GetHashSize(mHashType));
+    mPasswordLength = header.passwordLength;
+    mIndexBits = header.indexBits;
+    mBucketBits = header.bucketBits;
+    mEntryCount = header.entryCount;
+
+    const uint64_t bucketCount = 1ull << mBucketBits;
+    const uint64_t expectedSize = sizeof(header) + (bucketCount + 1 + mEntryCount) * sizeof(uint64_t);
+    if (mFile.Size() != expectedSize)
+    {
+        std::cout << "Incomplete file provided (expected " << expectedSize << " bytes, got " << mFile.Size() << ")" << std::endl;
+        mEntryCount = 0;
+        return false;
+    }
+
+    mOffsets = reinterpret_cast<const uint64_t*>(mFile.Data() + sizeof(header));
+    mEntries = mOffsets + bucketCount + 1;
+    std::vector<uint64_t>().swap(mOffsetStorage);
+    std::vector<uint64_t>().swap(mEntryStorage);
+
+    std::cout << "\nTable loaded:" << std::endl;
+    LogTableInfo();
+    return true;
+}
+
+bool LookupTable::IsLookupTableFile(const std::string& filename)
+{
+    std::ifstream file(filename, std::ifstream::binary);
+    char magic[4];
+    if (!file.read(magic, 4))
+        return false;
+
+    return LOOKUP_MAGIC_FILE.compare(0, 4, magic, 4) == 0;
+}
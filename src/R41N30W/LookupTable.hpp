@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "Utils.hpp"
+#include "OSSLHasher.hpp"
+#include "MappedFile.hpp"
+#include "Progress.hpp"
+
+
+// Exhaustive hash->password table covering the whole keyspace of given password length.
+// Each entry is a 64-bit key: top bits hold the digest prefix, low bits hold the password
+// index in the keyspace, so the plaintext is implied by the entry and never stored.
+// Entries are sorted and bucketed by the digest prefix, so a lookup is a single bucket probe
+// followed by one verification hash per matching prefix.
+class LookupTable
+{
+public:
+    LookupTable(uint32_t passwordLength, OSSLHasher::HashType hashType);
+    ~LookupTable();
+
+    void SetThreadCount(uint32_t threadCount);
+
+    bool CreateTable();
+    uint64_t GetSize() const { return mEntryCount; }
+
+    std::string FindPassword(const std::string& hashedPassword);
+    std::string FindPassword(const ucharVector& hashValue);
+
+    bool Save(const std::string& filename);
+    bool Load(const std::string& filename);
+
+    static bool IsLookupTableFile(const std::string& filename);
+
+private:
+    void CreateEntries(uint64_t begin, uint64_t end, uint64_t* keys);
+    uint64_t DigestPrefix(const ucharVector& hashValue) const;
+
+    void LogTableInfo();
+
+    OSSLHasher::HashFunc mHashFunc;
+    OSSLHasher::HashType mHashType;
+    uint32_t mHashLen;
+    uint32_t mPasswordLength;
+    uint32_t mThreadCount;
+
+    uint32_t mIndexBits;   // low key bits holding the password index
+    uint32_t mBucketBits;  // top key bits selecting a bucket
+    uint64_t mEntryCount;
+
+    // either filled by CreateTable, or pointing into the mapped file after Load
+    std::vector<uint64_t> mOffsetStorage;
+    std::vector<uint64_t> mEntryStorage;
+    const uint64_t* mOffsets;
+    const uint64_t* mEntries;
+    MappedFile mFile;
+    Progress mProgress;
+};
@@ -0,0 +1,133 @@
+#include "MappedFile.hpp"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+#ifdef _WIN32
+
+MappedFile::MappedFile()
+    : mData(nullptr)
+    , mSize(0)
+    , mFile(INVALID_HANDLE_VALUE)
+    , mMapping(nullptr)
+{
+}
+
+bool MappedFile::Open(const std::string& filename)
+{
+    Close();
+
+    mFile = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (mFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(mFile, &size))
+    {
+        Close();
+        return false;
+    }
+    mSize = static_cast<uint64_t>(size.QuadPart);
+
+    // empty files cannot be mapped, but are valid to open
+    if (mSize == 0)
+        return true;
+
+    mMapping = CreateFileMappingA(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mMapping == nullptr)
+    {
+        Close();
+        return false;
+    }
+
+    mData = static_cast<const unsigned char*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+    if (mData == nullptr)
+    {
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (mData != nullptr)
+        UnmapViewOfFile(mData);
+    if (mMapping != nullptr)
+        CloseHandle(mMapping);
+    if (mFile != INVALID_HANDLE_VALUE)
+        CloseHandle(mFile);
+
+    mData = nullptr;
+    mSize = 0;
+    mMapping = nullptr;
+    mFile = INVALID_HANDLE_VALUE;
+}
+
+#else // _WIN32
+
+MappedFile::MappedFile()
+    : mData(nullptr)
+    , mSize(0)
+    , mFile(-1)
+{
+}
+
+bool MappedFile::Open(const std::string& filename)
+{
+    Close();
+
+    mFile = open(filename.c_str(), O_RDONLY);
+    if (mFile < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(mFile, &info) != 0)
+    {
+        Close();
+        return false;
+    }
+    mSize = static_cast<uint64_t>(info.st_size);
+
+    // empty files cannot be mapped, but are valid to open
+    if (mSize == 0)
+        return true;
+
+    void* data = mmap(nullptr, static_cast<size_t>(mSize), PROT_READ, MAP_SHARED, mFile, 0);
+    if (data == MAP_FAILED)
+    {
+        Close();
+        return false;
+    }
+
+    mData = static_cast<const unsigned char*>(data);
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (mData != nullptr)
+        munmap(const_cast<unsigned char*>(mData), static_cast<size_t>(mSize));
+    if (mFile >= 0)
+        close(mFile);
+
+    mData = nullptr;
+    mSize = 0;
+    mFile = -1;
+}
+
+#endif // _WIN32
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+
+// read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const std::string& filename);
+    void Close();
+
+    const unsigned char* Data() const { return mData; }
+    uint64_t Size() const { return mSize; }
+
+private:
+    const unsigned char* mData;
+    uint64_t mSize;
+
+#ifdef _WIN32
+    void* mFile;
+    void* mMapping;
+#else
+    int mFile;
+#endif
+};
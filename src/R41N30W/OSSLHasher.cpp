@@ -1,7 +1,11 @@
 #include "OSSLHasher.hpp"
+#include "HashKernels.hpp"
 
 #include <openssl/ssl.h>
+#include <openssl/sha.h>
 #include <iostream>
+#include <mutex>
+#include <chrono>
 
 
 namespace OSSLHasher {
@@ -15,75 +19,397 @@ void destroyCtx(EVP_MD_CTX* ctx)
 }
 
 using MDCtxPtr = std::unique_ptr<EVP_MD_CTX, std::function<void(EVP_MD_CTX*)>>;
-using MDFunc = std::function<const EVP_MD*()>;
+using RawHashFunc = HashKernels::HashFunc;
+using ShortKernelFunc = RawHashFunc(*)(size_t length);
 
-MDFunc SelectMD(HashType type)
+// nullptr for hash types OpenSSL does not provide by default (MD4 lives in the legacy provider)
+const EVP_MD* SelectMD(HashType type)
 {
     switch (type)
     {
-    case HashType::SHA1: return EVP_sha1;
-    case HashType::SHA256: return EVP_sha256;
-    case HashType::BLAKE512: return EVP_blake2b512;
-    default:
-        std::cout << "Unsupported hash type" << std::endl;
-        return MDFunc();
+    case HashType::SHA1: return EVP_sha1();
+    case HashType::SHA256: return EVP_sha256();
+    case HashType::BLAKE512: return EVP_blake2b512();
+    case HashType::MD5: return EVP_md5();
+    default: return nullptr;
     }
 }
 
-} // anonymous namespace
-
-
-void Hash(HashType type, const ucharVector& plain, ucharVector& hash)
+void EVPHash(const EVP_MD* md, const unsigned char* data, size_t length, unsigned char* out)
 {
-    MDFunc mdFunc = SelectMD(type);
-    if (hash.size() < GetHashSize(type))
-    {
-        std::cout << "Not enough space to input " << GetHashFuncName(type).c_str() << " hash - needed " << GetHashSize(type) << std::endl;
-        return;
-    }
-
-    MDCtxPtr ctx(EVP_MD_CTX_new(), destroyCtx);
+    // context is reused by the thread, allocating it per hash is noticeable for short messages
+    thread_local MDCtxPtr ctx(EVP_MD_CTX_new(), destroyCtx);
     if (!ctx)
     {
         std::cout << "Failed to create MD context" << std::endl;
         return;
     }
 
-    if (!EVP_DigestInit(ctx.get(), mdFunc()))
+    if (!EVP_DigestInit_ex(ctx.get(), md, nullptr))
     {
-        std::cout << "Failed to initialize MD context to BLAKE 512 digest" << std::endl;
+        std::cout << "Failed to initialize MD context to " << EVP_MD_name(md) << " digest" << std::endl;
         return;
     }
 
-    if (!EVP_DigestUpdate(ctx.get(), plain.data(), plain.size()))
+    if (!EVP_DigestUpdate(ctx.get(), data, length))
     {
         std::cout << "Failed to update MD digest from data" << std::endl;
         return;
     }
 
-    if (!EVP_DigestFinal(ctx.get(), hash.data(), nullptr))
+    if (!EVP_DigestFinal_ex(ctx.get(), out, nullptr))
     {
         std::cout << "Failed to finalize MD digest" << std::endl;
         return;
     }
 }
 
+void EVPSHA1(const unsigned char* data, size_t length, unsigned char* out)
+{
+    EVPHash(EVP_sha1(), data, length, out);
+}
+
+void EVPSHA256(const unsigned char* data, size_t length, unsigned char* out)
+{
+    EVPHash(EVP_sha256(), data, length, out);
+}
+
+void EVPBLAKE512(const unsigned char* data, size_t length, unsigned char* out)
+{
+    EVPHash(EVP_blake2b512(), data, length, out);
+}
+
+void EVPMD5(const unsigned char* data, size_t length, unsigned char* out)
+{
+    EVPHash(EVP_md5(), data, length, out);
+}
+
+void LowLevelSHA1(const unsigned char* data, size_t length, unsigned char* out)
+{
+    ::SHA1(data, length, out);
+}
+
+void LowLevelSHA256(const unsigned char* data, size_t length, unsigned char* out)
+{
+    ::SHA256(data, length, out);
+}
+
+bool Always()
+{
+    return true;
+}
+
+struct Backend
+{
+    const char* name;
+    HashType type;
+    RawHashFunc func;
+    bool (*available)();
+    ShortKernelFunc shortKernel; // fixed-length single-block variants, may be nullptr
+};
+
+const Backend BACKENDS[] = {
+    { "evp",      HashType::SHA1,     EVPSHA1,                    Always,                         nullptr },
+    { "lowlevel", HashType::SHA1,     LowLevelSHA1,               Always,                         nullptr },
+    { "scalar",   HashType::SHA1,     HashKernels::SHA1,          Always,                         HashKernels::GetShortSHA1 },
+    { "simd",     HashType::SHA1,     HashKernels::SHA1_SHANI,    HashKernels::HasSHAExtensions,  HashKernels::GetShortSHA1_SHANI },
+    { "evp",      HashType::SHA256,   EVPSHA256,                  Always,                         nullptr },
+    { "lowlevel", HashType::SHA256,   LowLevelSHA256,             Always,                         nullptr },
+    { "scalar",   HashType::SHA256,   HashKernels::SHA256,        Always,                         HashKernels::GetShortSHA256 },
+    { "simd",     HashType::SHA256,   HashKernels::SHA256_SHANI,  HashKernels::HasSHAExtensions,  HashKernels::GetShortSHA256_SHANI },
+    { "evp",      HashType::BLAKE512, EVPBLAKE512,                Always,                         nullptr },
+    { "scalar",   HashType::BLAKE512, HashKernels::BLAKE512,      Always,                         nullptr },
+    { "evp",      HashType::MD5,      EVPMD5,                     Always,                         nullptr },
+    { "scalar",   HashType::MD5,      HashKernels::MD5,           Always,                         HashKernels::GetShortMD5 },
+    { "scalar",   HashType::NTLM,     HashKernels::NTLM,          Always,                         HashKernels::GetShortNTLM },
+};
+
+struct KnownVector
+{
+    HashType type;
+    const char* digest; // of "abc"
+};
+
+const KnownVector KNOWN_VECTORS[] = {
+    { HashType::SHA1,     "a9993e364706816aba3e25717850c26c9cd0d89d" },
+    { HashType::SHA256,   "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" },
+    { HashType::BLAKE512, "ba80a53f981c4d0d6a2797b69f12f6e94c212f14685ac4b74b12bb6fdbffa2d1"
+                          "7d87c5392aab792dc252d5de4533cc9518d38aa8dbf1925ab92386edd4009923" },
+    { HashType::MD5,      "900150983cd24fb0d6963f7d28e17f72" },
+    { HashType::NTLM,     "e0fba38268d0ec66ef1cb452d5885e53" },
+};
+
+const size_t HASH_TYPE_COUNT = static_cast<size_t>(HashType::NTLM) + 1;
+
+std::mutex gBackendMutex;
+std::string gRequestedBackend = "auto";
+const Backend* gSelected[HASH_TYPE_COUNT] = { nullptr };
+
+// OpenSSL where available, otherwise the generic in-tree kernel (checked against the known digest)
+void ReferenceHash(HashType type, const unsigned char* data, size_t length, unsigned char* out)
+{
+    const EVP_MD* md = SelectMD(type);
+    if (md != nullptr)
+        EVPHash(md, data, length, out);
+    else if (type == HashType::NTLM)
+        HashKernels::NTLM(data, length, out);
+}
+
+// compares backend against the known digest and against a reference for messages crossing block boundaries
+bool SelfTest(const Backend& backend)
+{
+    const size_t hashSize = GetHashSize(backend.type);
+    ucharVector hash(hashSize), reference(hashSize);
+
+    for (const auto& vector : KNOWN_VECTORS)
+    {
+        if (vector.type != backend.type)
+            continue;
+
+        const unsigned char abc[] = { 'a', 'b', 'c' };
+        backend.func(abc, sizeof(abc), hash.data());
+        if (HashToStr(hash) != vector.digest)
+            return false;
+    }
+
+    ucharVector message;
+    for (size_t length = 0; length <= 300; ++length)
+    {
+        backend.func(message.data(), message.size(), hash.data());
+        ReferenceHash(backend.type, message.data(), message.size(), reference.data());
+        if (hash != reference)
+            return false;
+        message.push_back(static_cast<unsigned char>(length * 31 + 7));
+    }
+
+    for (size_t length = 1; backend.shortKernel && length <= HashKernels::SHORT_MAX_LENGTH; ++length)
+    {
+        RawHashFunc shortFunc = backend.shortKernel(length);
+        if (shortFunc == nullptr)
+            continue;
+
+        message.resize(length);
+        shortFunc(message.data(), length, hash.data());
+        ReferenceHash(backend.type, message.data(), length, reference.data());
+        if (hash != reference)
+            return false;
+    }
+
+    return true;
+}
+
+// hashes per second for a password-sized message, through the kernel chains would use
+double Benchmark(const Backend& backend)
+{
+    unsigned char message[8] = { 'p', 'a', 's', 's', 'w', 'o', 'r', 'd' };
+    unsigned char hash[64];
+    const auto duration = std::chrono::milliseconds(20);
+
+    RawHashFunc func = backend.func;
+    if (backend.shortKernel && backend.shortKernel(sizeof(message)))
+        func = backend.shortKernel(sizeof(message));
+
+    uint64_t count = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto now = start;
+    do
+    {
+        for (int i = 0; i < 256; ++i)
+        {
+            func(message, sizeof(message), hash);
+            message[0] = hash[0];
+        }
+        count += 256;
+        now = std::chrono::steady_clock::now();
+    } while (now - start < duration);
+
+    return static_cast<double>(count) / std::chrono::duration<double>(now - start).count();
+}
+
+const Backend* SelectBackend(HashType type)
+{
+    const Backend* best = nullptr;
+    double bestRate = 0.0;
+
+    for (const auto& backend : BACKENDS)
+    {
+        if (backend.type != type || !backend.available())
+            continue;
+
+        const bool requested = gRequestedBackend == backend.name;
+        if (gRequestedBackend != "auto" && !requested)
+            continue;
+
+        if (!SelfTest(backend))
+        {
+            std::cout << "Hash backend " << backend.name << " failed self test for " << GetHashFuncName(type) << " - disabled" << std::endl;
+            continue;
+        }
+
+        if (requested)
+            return &backend;
+
+        double rate = Benchmark(backend);
+        if (rate > bestRate)
+        {
+            bestRate = rate;
+            best = &backend;
+        }
+    }
+
+    if (best == nullptr && gRequestedBackend != "auto")
+    {
+        // requested backend does not support this hash type (or this CPU) - pick the best one instead
+        std::string requested = gRequestedBackend;
+        gRequestedBackend = "auto";
+        best = SelectBackend(type);
+        gRequestedBackend = requested;
+    }
+
+    return best;
+}
+
+const Backend* GetBackend(HashType type)
+{
+    size_t index = static_cast<size_t>(type);
+    if (type == HashType::UNKNOWN || index >= HASH_TYPE_COUNT)
+        return nullptr;
+
+    std::lock_guard<std::mutex> lock(gBackendMutex);
+    if (gSelected[index] == nullptr)
+        gSelected[index] = SelectBackend(type);
+    return gSelected[index];
+}
+
+RawHashFunc GetShortKernel(const Backend* backend, size_t plainLength)
+{
+    if (backend == nullptr || backend->shortKernel == nullptr)
+        return nullptr;
+    return backend->shortKernel(plainLength);
+}
+
+} // anonymous namespace
+
+
+void Hash(HashType type, const ucharVector& plain, ucharVector& hash)
+{
+    HashFunc func = GetHashFunc(type);
+    if (!func)
+        return;
+
+    if (hash.size() < GetHashSize(type))
+    {
+        std::cout << "Not enough space to input " << GetHashFuncName(type).c_str() << " hash - needed " << GetHashSize(type) << std::endl;
+        return;
+    }
+
+    func(plain, hash);
+}
+
+bool SetBackend(const std::string& name)
+{
+    bool known = (name == "auto");
+    for (const auto& backend : BACKENDS)
+        known = known || (name == backend.name);
+
+    if (!known)
+    {
+        std::cout << "Unrecognized hash backend \"" << name << "\" - available are: auto, evp, lowlevel, scalar, simd" << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(gBackendMutex);
+    gRequestedBackend = name;
+    for (auto& i : gSelected)
+        i = nullptr;
+    return true;
+}
+
+std::string GetBackendName(HashType type)
+{
+    const Backend* backend = GetBackend(type);
+    return backend ? backend->name : "none";
+}
+
+std::vector<std::string> GetBackendNames(HashType type)
+{
+    std::vector<std::string> names;
+    for (const auto& backend : BACKENDS)
+        if (backend.type == type && backend.available())
+            names.push_back(backend.name);
+    return names;
+}
+
 size_t GetHashSize(HashType type)
 {
-    return static_cast<size_t>(EVP_MD_size(SelectMD(type)()));
+    switch (type)
+    {
+    case HashType::SHA1: return 20;
+    case HashType::SHA256: return 32;
+    case HashType::BLAKE512: return 64;
+    case HashType::MD5: return 16;
+    case HashType::NTLM: return 16;
+    default: return 0;
+    }
 }
 
 HashFunc GetHashFunc(HashType type)
 {
-    switch (type)
+    const Backend* backend = GetBackend(type);
+    if (backend == nullptr)
     {
-    case HashType::SHA1: return SHA1;
-    case HashType::SHA256: return SHA256;
-    case HashType::BLAKE512: return BLAKE512;
-    default:
-        std::cout << "Unsupported hash function" << std::endl;
+        // UNKNOWN means the hash is not known yet (e.g. until a table header is read) - not an error
+        if (type != HashType::UNKNOWN)
+            std::cout << "Unsupported hash function" << std::endl;
         return HashFunc();
     }
+
+    RawHashFunc func = backend->func;
+    return [func](const ucharVector& plain, ucharVector& hash)
+    {
+        func(plain.data(), plain.size(), hash.data());
+    };
+}
+
+HashFunc GetHashFunc(HashType type, size_t plainLength)
+{
+    const Backend* backend = GetBackend(type);
+    RawHashFunc shortFunc = GetShortKernel(backend, plainLength);
+    if (shortFunc == nullptr)
+        return GetHashFunc(type);
+
+    // other lengths can still show up (e.g. when verifying user input), keep the generic path for them
+    RawHashFunc func = backend->func;
+    return [func, shortFunc, plainLength](const ucharVector& plain, ucharVector& hash)
+    {
+        if (plain.size() == plainLength)
+            shortFunc(plain.data(), plainLength, hash.data());
+        else
+            func(plain.data(), plain.size(), hash.data());
+    };
+}
+
+BatchHashFunc GetBatchHashFunc(HashType type, size_t plainLength)
+{
+    const Backend* backend = GetBackend(type);
+    if (backend == nullptr)
+    {
+        if (type != HashType::UNKNOWN)
+            std::cout << "Unsupported hash function" << std::endl;
+        return BatchHashFunc();
+    }
+
+    // messages in the batch are independent, so consecutive calls overlap in the pipeline;
+    // a multi-buffer kernel would take the whole batch here instead
+    RawHashFunc func = GetShortKernel(backend, plainLength);
+    if (func == nullptr)
+        func = backend->func;
+    const size_t hashSize = GetHashSize(type);
+    return [func, plainLength, hashSize](const unsigned char* plains, unsigned char* hashes, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+            func(plains + i * plainLength, plainLength, hashes + i * hashSize);
+    };
 }
 
 std::string GetHashFuncName(HashType type)
@@ -93,6 +419,8 @@ std::string GetHashFuncName(HashType type)
     case HashType::SHA1: return "SHA1";
     case HashType::SHA256: return "SHA256";
     case HashType::BLAKE512: return "BLAKE512";
+    case HashType::MD5: return "MD5";
+    case HashType::NTLM: return "NTLM";
     default:
         std::cout << "Unsupported hash function" << std::endl;
         return "UNKNOWN";
@@ -104,6 +432,8 @@ HashType GetHashTypeFromString(const std::string& type)
     if (type == "SHA1") return HashType::SHA1;
     if (type == "SHA256") return HashType::SHA256;
     if (type == "BLAKE512") return HashType::BLAKE512;
+    if (type == "MD5") return HashType::MD5;
+    if (type == "NTLM") return HashType::NTLM;
     return HashType::UNKNOWN; // if strings do not match, return unknown to inform about an error
 }
 
@@ -122,4 +452,14 @@ void BLAKE512(const ucharVector& plain, ucharVector& hash)
     Hash(HashType::BLAKE512, plain, hash);
 }
 
+void MD5(const ucharVector& plain, ucharVector& hash)
+{
+    Hash(HashType::MD5, plain, hash);
+}
+
+void NTLM(const ucharVector& plain, ucharVector& hash)
+{
+    Hash(HashType::NTLM, plain, hash);
+}
+
 } // namespace OSSLHasher
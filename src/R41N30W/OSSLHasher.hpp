@@ -2,11 +2,15 @@
 
 #include "Utils.hpp"
 #include <functional>
+#include <string>
+#include <vector>
 
 namespace OSSLHasher
 {
 
 using HashFunc = std::function<void(const ucharVector&, ucharVector&)>;
+// hashes count messages of fixed length stored back to back, digests are stored back to back too
+using BatchHashFunc = std::function<void(const unsigned char* plains, unsigned char* hashes, size_t count)>;
 
 enum class HashType: unsigned char
 {
@@ -14,17 +18,35 @@ enum class HashType: unsigned char
     SHA1,
     SHA256,
     BLAKE512,
+    MD5,
+    NTLM, // MD4 of UTF-16LE text
 };
 
 void Hash(HashType type, const ucharVector& plain, ucharVector& hash);
 
+// Each hash type can be computed by several backends:
+//   evp      - OpenSSL EVP interface
+//   lowlevel - OpenSSL one-shot digest functions (SHA1 and SHA256, the rest are deprecated)
+//   scalar   - in-tree portable implementation
+//   simd     - in-tree implementation using x86 SHA extensions
+// Every backend is cross-checked against known digests before use. "auto" (default)
+// benchmarks the working backends and picks the fastest one for each hash type.
+bool SetBackend(const std::string& name);
+std::string GetBackendName(HashType type);
+std::vector<std::string> GetBackendNames(HashType type);
+
 size_t GetHashSize(HashType type);
 HashFunc GetHashFunc(HashType type);
+// same, but specialized for messages of plainLength bytes when the selected backend has such kernel
+HashFunc GetHashFunc(HashType type, size_t plainLength);
+BatchHashFunc GetBatchHashFunc(HashType type, size_t plainLength);
 std::string GetHashFuncName(HashType type);
 HashType GetHashTypeFromString(const std::string& type);
 
 void SHA1(const ucharVector& plain, ucharVector& hash);
 void SHA256(const ucharVector& plain, ucharVector& hash);
 void BLAKE512(const ucharVector& plain, ucharVector& hash);
+void MD5(const ucharVector& plain, ucharVector& hash);
+void NTLM(const ucharVector& plain, ucharVector& hash);
 
 } // namespace Blake
@@ -0,0 +1,199 @@
+#include "Planner.hpp"
+#include "Common.hpp"
+#include "Utils.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+
+namespace Planner {
+
+namespace {
+
+const double HEADER_BYTES = 24.0;
+
+// rough footprint of a single row in std::map<ucharVector, std::string>
+double RowMemory(size_t hashLength, uint32_t passwordLength)
+{
+    const double node = 32.0;                   // tree node header
+    const double key = 24.0 + 16.0 * std::ceil(hashLength / 16.0) + 16.0;  // vector + heap block
+    const double value = 32.0 + (passwordLength > 15 ? 16.0 * std::ceil((passwordLength + 1) / 16.0) + 16.0 : 0.0);
+    return node + key + value;
+}
+
+void LogBytes(double bytes)
+{
+    const char* units[] = { "B", "KiB", "MiB", "GiB", "TiB" };
+    unsigned int unit = 0;
+    while (bytes >= 1024.0 && unit < 4)
+    {
+        bytes /= 1024.0;
+        unit++;
+    }
+    std::cout << std::setprecision(2) << std::fixed << bytes << " " << units[unit];
+}
+
+void LogSeconds(double seconds)
+{
+    if (seconds < 1.0)
+        std::cout << std::setprecision(3) << std::fixed << seconds * 1000.0 << " ms";
+    else
+        PrettyLogTime(static_cast<uint64_t>(seconds));
+}
+
+} // anonymous namespace
+
+
+double Keyspace(uint32_t passwordLength)
+{
+    return std::pow(static_cast<double>(Common::CharsetLength), static_cast<double>(passwordLength));
+}
+
+TableEstimate Estimate(const TableParams& params, double stepsPerSecond)
+{
+    TableEstimate estimate;
+    const double N = params.keyspace;
+    const double t = static_cast<double>(params.chainSteps);
+
+    // Oechslin's recurrence - each column keeps m_{i+1} = N * (1 - e^(-m_i/N)) distinct points,
+    // a password is missed only when it misses every column
+    double m = std::min(static_cast<double>(params.startRows), N);
+    double logMiss = 0.0;
+    for (uint32_t i = 0; i <= params.chainSteps; ++i)
+    {
+        logMiss += std::log1p(-std::min(m / N, 1.0 - 1e-16));
+        if (i < params.chainSteps)
+            m = -N * std::expm1(-m / N);
+    }
+
+    estimate.successProbability = -std::expm1(logMiss);
+    estimate.rows = m;
+    estimate.diskBytes = HEADER_BYTES + m * static_cast<double>(params.hashLength + params.passwordLength);
+    estimate.ramBytes = m * RowMemory(params.hashLength, params.passwordLength);
+    estimate.tailHashes = t * (t + 1.0) / 2.0;
+    estimate.worstCaseHashes = estimate.tailHashes + (t + 1.0) * (t + 1.0);
+
+    if (stepsPerSecond > 0.0)
+    {
+        estimate.generationSeconds = static_cast<double>(params.startRows) * (t + 1.0) / stepsPerSecond;
+        estimate.worstCaseLookupSeconds = estimate.worstCaseHashes / stepsPerSecond;
+    }
+    else
+    {
+        estimate.generationSeconds = 0.0;
+        estimate.worstCaseLookupSeconds = 0.0;
+    }
+
+    return estimate;
+}
+
+bool Recommend(const TableParams& base, double stepsPerSecond, const Budget& budget, TableParams& result)
+{
+    if (stepsPerSecond <= 0.0)
+        return false;
+
+    const double N = base.keyspace;
+    const double rowBytes = RowMemory(base.hashLength, base.passwordLength);
+    double bestProbability = -1.0;
+
+    // closed form of the recurrence: m_i ~= 2N / (i + c), c = 2N / m_0, which gives
+    // success probability 1 - (c / (t + c))^2 for a table with t chain steps
+    for (double t = 16.0; t <= 1e6; t = std::ceil(t * 1.1))
+    {
+        if (budget.lookupSeconds > 0.0 && t * (t + 1.0) / 2.0 / stepsPerSecond > budget.lookupSeconds)
+            break;
+
+        double startRows = N;
+        if (budget.generationSeconds > 0.0)
+            startRows = std::min(startRows, budget.generationSeconds * stepsPerSecond / (t + 1.0));
+        if (budget.ramBytes > 0.0)
+        {
+            double maxRows = budget.ramBytes / rowBytes;
+            double minC = 2.0 * N / maxRows - t;
+            if (minC > 0.0)
+                startRows = std::min(startRows, 2.0 * N / minC);
+        }
+
+        startRows = std::floor(startRows);
+        if (startRows < 1.0)
+            continue;
+
+        double c = 2.0 * N / startRows;
+        double probability = 1.0 - (c / (t + c)) * (c / (t + c));
+
+        // only switch to longer chains when it is worth the quadratic lookup cost
+        if (probability > bestProbability + 1e-4)
+        {
+            bestProbability = probability;
+            result = base;
+            result.chainSteps = static_cast<uint32_t>(t);
+            result.startRows = static_cast<uint64_t>(startRows);
+        }
+    }
+
+    return bestProbability >= 0.0;
+}
+
+CoverageEstimate EstimateCoverage(double keyspace, uint64_t rows, uint64_t sampledChains, double sampledPoints,
+                                  double sampledDistinct, double relativeError)
+{
+    CoverageEstimate estimate;
+    estimate.distinct = 0.0;
+    estimate.successProbability = 0.0;
+    estimate.effectiveKeyspace = 0.0;
+    if (sampledChains == 0 || keyspace <= 0.0)
+        return estimate;
+
+    // distinct among U points drawn from N is N * (1 - e^(-U/N)) - growing in N, so N is found by
+    // bisection over log N, between the distinct count itself and a space where it is reached
+    const double collisions = sampledPoints - sampledDistinct;
+    if (collisions > 3.0 * relativeError * sampledDistinct)
+    {
+        auto distinctIn = [sampledPoints](double space) { return -space * std::expm1(-sampledPoints / space); };
+        double low = sampledDistinct, high = std::max(keyspace, sampledPoints);
+        while (distinctIn(high) < sampledDistinct && high < 1e300)
+            high *= 2.0;
+        for (int i = 0; i < 200; ++i)
+        {
+            const double middle = std::sqrt(low * high);
+            (distinctIn(middle) < sampledDistinct ? low : high) = middle;
+        }
+        estimate.effectiveKeyspace = high;
+    }
+
+    // points of the whole table fall into the effective keyspace - or the real one, when the sample
+    // collided less than random points would; a whole table with visible collisions is counted directly
+    const double points = sampledPoints * static_cast<double>(rows) / static_cast<double>(sampledChains);
+    const double space = estimate.effectiveKeyspace > 0.0 ? std::min(estimate.effectiveKeyspace, keyspace) : keyspace;
+    if (rows <= sampledChains && estimate.effectiveKeyspace > 0.0)
+        estimate.distinct = sampledDistinct;
+    else
+        estimate.distinct = -space * std::expm1(-points / space);
+    estimate.distinct = std::min(estimate.distinct, keyspace);
+    estimate.successProbability = estimate.distinct / keyspace;
+    return estimate;
+}
+
+void LogEstimate(const TableParams& params, const TableEstimate& estimate)
+{
+    std::cout << "\tKeyspace:\t\t" << std::setprecision(0) << std::fixed << params.keyspace
+              << " (" << Common::CharsetLength << "^" << params.passwordLength << ")" << std::endl;
+    std::cout << "\tStart rows:\t\t" << params.startRows << std::endl;
+    std::cout << "\tChain steps:\t\t" << params.chainSteps << std::endl;
+    std::cout << "\tSuccess probability:\t" << std::setprecision(4) << std::fixed << estimate.successProbability * 100.0 << "%" << std::endl;
+    std::cout << "\tRows after merges:\t" << std::setprecision(0) << std::fixed << estimate.rows << std::endl;
+    std::cout << "\tDisk size:\t\t";
+    LogBytes(estimate.diskBytes);
+    std::cout << std::endl << "\tRAM size:\t\t";
+    LogBytes(estimate.ramBytes);
+    std::cout << std::endl << "\tGeneration time:\t";
+    LogSeconds(estimate.generationSeconds);
+    std::cout << std::endl << "\tLookup work:\t\t" << std::setprecision(0) << std::fixed << estimate.tailHashes
+              << " hashes (worst case with false alarms " << estimate.worstCaseHashes << ", ";
+    LogSeconds(estimate.worstCaseLookupSeconds);
+    std::cout << ")" << std::endl;
+}
+
+} // namespace Planner
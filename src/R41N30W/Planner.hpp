@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+
+namespace Planner {
+
+struct TableParams
+{
+    double keyspace;            // number of possible passwords
+    uint64_t startRows;         // --vertical
+    uint32_t chainSteps;        // --horizontal
+    uint32_t passwordLength;
+    size_t hashLength;          // in bytes
+};
+
+struct TableEstimate
+{
+    double successProbability;  // chance a random password from the keyspace is found
+    double rows;                // rows left after merged chains are discarded
+    double diskBytes;
+    double ramBytes;
+    double generationSeconds;
+    double tailHashes;          // hashes needed to compute all chain tails during lookup
+    double worstCaseHashes;     // tails + every endpoint probe being a false alarm
+    double worstCaseLookupSeconds;
+};
+
+// distinct passwords of a whole table, extrapolated from a sample of its chains
+struct CoverageEstimate
+{
+    double distinct;            // distinct passwords the table covers
+    double successProbability;  // chance a random password from the keyspace is found
+    double effectiveKeyspace;   // keyspace random points would have to come from to collide as the sample did,
+                                // 0 when the sample's collisions are below the counter's error
+};
+
+struct Budget
+{
+    double ramBytes;            // 0 means unconstrained
+    double generationSeconds;   // 0 means unconstrained
+    double lookupSeconds;       // 0 means unconstrained
+};
+
+double Keyspace(uint32_t passwordLength);
+
+// stepsPerSecond is the measured hash+reduce rate using all threads
+TableEstimate Estimate(const TableParams& params, double stepsPerSecond);
+
+// finds chain steps and start rows giving the best success probability within the budget
+bool Recommend(const TableParams& base, double stepsPerSecond, const Budget& budget, TableParams& result);
+
+// sampledPoints of sampledChains are distinct within their chains, sampledDistinct across all of
+// them (counted with given relative error) - the difference are collisions between chains
+CoverageEstimate EstimateCoverage(double keyspace, uint64_t rows, uint64_t sampledChains, double sampledPoints,
+                                  double sampledDistinct, double relativeError);
+
+void LogEstimate(const TableParams& params, const TableEstimate& estimate);
+
+} // namespace Planner
@@ -0,0 +1,336 @@
+#include "Profiler.hpp"
+#include "Utils.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <map>
+#include <vector>
+
+
+namespace Profiler {
+
+namespace Detail {
+
+std::atomic<bool> gEnabled(false);
+
+} // namespace Detail
+
+namespace {
+
+const size_t COUNTER_COUNT = static_cast<size_t>(Counter::COUNT);
+const char* const COUNTER_NAMES[COUNTER_COUNT] = {
+    "hashCalls",
+    "reductions",
+    "dictionaryProbes",
+    "falseAlarms",
+    "filterRejects",
+    "lockWaitSeconds",
+};
+const size_t MAX_TIMERS = 32; // per thread, further timer names are ignored
+
+// Values are written only by the owning thread - relaxed atomics just let EndPhase read them
+// while the owner runs. Base values are what was already reported, guarded by gMutex.
+struct ThreadSlot
+{
+    std::atomic<uint64_t> counters[COUNTER_COUNT];
+    std::atomic<const char*> timerNames[MAX_TIMERS];
+    std::atomic<uint64_t> timerCalls[MAX_TIMERS];
+    std::atomic<uint64_t> timerTicks[MAX_TIMERS];
+    std::atomic<size_t> timerCount;
+
+    uint64_t counterBase[COUNTER_COUNT];
+    uint64_t timerCallsBase[MAX_TIMERS];
+    uint64_t timerTicksBase[MAX_TIMERS];
+
+    ThreadSlot()
+        : timerCount(0)
+    {
+        for (size_t i = 0; i < COUNTER_COUNT; ++i)
+        {
+            counters[i] = 0;
+            counterBase[i] = 0;
+        }
+        for (size_t i = 0; i < MAX_TIMERS; ++i)
+        {
+            timerNames[i] = nullptr;
+            timerCalls[i] = 0;
+            timerTicks[i] = 0;
+            timerCallsBase[i] = 0;
+            timerTicksBase[i] = 0;
+        }
+    }
+};
+
+struct TimerTotal
+{
+    uint64_t calls;
+    uint64_t ticks;
+};
+
+struct Totals
+{
+    uint64_t counters[COUNTER_COUNT];
+    std::map<std::string, TimerTotal> timers;
+    uint32_t threads; // threads which counted anything
+
+    Totals()
+    {
+        Clear();
+    }
+
+    void Clear()
+    {
+        std::fill(std::begin(counters), std::end(counters), 0);
+        timers.clear();
+        threads = 0;
+    }
+};
+
+struct Phase
+{
+    std::string name;
+    double wallSeconds;
+    Totals totals;
+};
+
+std::mutex gMutex;
+std::vector<ThreadSlot*> gSlots;
+Totals gRetired; // left by threads which exited during the current phase
+std::vector<Phase> gPhases;
+std::string gPhaseName;
+uint64_t gPhaseStart = 0;
+bool gPhaseOpen = false;
+
+inline void Bump(std::atomic<uint64_t>& value, uint64_t add)
+{
+    // single writer - no need for an atomic read-modify-write
+    value.store(value.load(std::memory_order_relaxed) + add, std::memory_order_relaxed);
+}
+
+// moves what slot gathered since the last call into totals, requires gMutex
+void Drain(ThreadSlot& slot, Totals& totals)
+{
+    bool active = false;
+    for (size_t i = 0; i < COUNTER_COUNT; ++i)
+    {
+        const uint64_t value = slot.counters[i].load(std::memory_order_relaxed);
+        totals.counters[i] += value - slot.counterBase[i];
+        active = active || value != slot.counterBase[i];
+        slot.counterBase[i] = value;
+    }
+
+    const size_t timerCount = slot.timerCount.load(std::memory_order_acquire);
+    for (size_t i = 0; i < timerCount; ++i)
+    {
+        const uint64_t calls = slot.timerCalls[i].load(std::memory_order_relaxed);
+        const uint64_t ticks = slot.timerTicks[i].load(std::memory_order_relaxed);
+        if (calls != slot.timerCallsBase[i])
+        {
+            TimerTotal& total = totals.timers[slot.timerNames[i].load(std::memory_order_relaxed)];
+            total.calls += calls - slot.timerCallsBase[i];
+            total.ticks += ticks - slot.timerTicksBase[i];
+            active = true;
+        }
+        slot.timerCallsBase[i] = calls;
+        slot.timerTicksBase[i] = ticks;
+    }
+
+    totals.threads += active ? 1 : 0;
+}
+
+// registers the slot on first use, and hands what is left over to gRetired on thread exit
+struct SlotHolder
+{
+    ThreadSlot slot;
+    bool registered;
+
+    SlotHolder()
+        : slot()
+        , registered(false)
+    {
+    }
+
+    ~SlotHolder()
+    {
+        if (!registered)
+            return;
+
+        std::lock_guard<std::mutex> lock(gMutex);
+        Drain(slot, gRetired);
+        gSlots.erase(std::remove(gSlots.begin(), gSlots.end(), &slot), gSlots.end());
+    }
+};
+
+ThreadSlot& LocalSlot()
+{
+    thread_local SlotHolder holder;
+    if (!holder.registered)
+    {
+        std::lock_guard<std::mutex> lock(gMutex);
+        gSlots.push_back(&holder.slot);
+        holder.registered = true;
+    }
+    return holder.slot;
+}
+
+void EndPhaseLocked()
+{
+    if (!gPhaseOpen)
+        return;
+
+    Phase phase;
+    phase.name = gPhaseName;
+    phase.wallSeconds = static_cast<double>(GetTime() - gPhaseStart) / static_cast<double>(GetClockFreq());
+    phase.totals = gRetired;
+    for (auto slot : gSlots)
+        Drain(*slot, phase.totals);
+
+    gRetired.Clear();
+    gPhases.push_back(phase);
+    gPhaseOpen = false;
+}
+
+} // anonymous namespace
+
+namespace Detail {
+
+void AddCounter(Counter counter, uint64_t value)
+{
+    Bump(LocalSlot().counters[static_cast<size_t>(counter)], value);
+}
+
+void AddTimer(const char* name, uint64_t ticks)
+{
+    ThreadSlot& slot = LocalSlot();
+
+    // names are literals, so the pointer identifies the timer within a thread
+    const size_t count = slot.timerCount.load(std::memory_order_relaxed);
+    size_t index = 0;
+    while (index < count && slot.timerNames[index].load(std::memory_order_relaxed) != name)
+        index++;
+
+    if (index == count)
+    {
+        if (count == MAX_TIMERS)
+            return;
+        slot.timerNames[index].store(name, std::memory_order_relaxed);
+        slot.timerCount.store(count + 1, std::memory_order_release);
+    }
+
+    Bump(slot.timerCalls[index], 1);
+    Bump(slot.timerTicks[index], ticks);
+}
+
+} // namespace Detail
+
+void Enable(bool enabled)
+{
+    Detail::gEnabled = enabled;
+}
+
+ScopedTimer::ScopedTimer(const char* name)
+    : mName(name)
+    , mStart(IsEnabled() ? GetTime() : 0)
+{
+}
+
+ScopedTimer::~ScopedTimer()
+{
+    if (mStart != 0)
+        Detail::AddTimer(mName, GetTime() - mStart);
+}
+
+ScopedLock::ScopedLock(std::mutex& mutex)
+    : mLock(mutex, std::defer_lock)
+{
+    // the clock is read only when the mutex is actually contended
+    if (!IsEnabled() || mLock.try_lock())
+    {
+        if (!mLock.owns_lock())
+            mLock.lock();
+        return;
+    }
+
+    const uint64_t start = GetTime();
+    mLock.lock();
+    Detail::AddCounter(Counter::LockWaitTicks, GetTime() - start);
+}
+
+void BeginPhase(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(gMutex);
+    EndPhaseLocked();
+
+    // whatever was counted between phases is dropped
+    Totals dropped;
+    for (auto slot : gSlots)
+        Drain(*slot, dropped);
+    gRetired.Clear();
+
+    gPhaseName = name;
+    gPhaseStart = GetTime();
+    gPhaseOpen = true;
+}
+
+void EndPhase()
+{
+    std::lock_guard<std::mutex> lock(gMutex);
+    EndPhaseLocked();
+}
+
+bool WriteReport(const std::string& filename)
+{
+    std::lock_guard<std::mutex> lock(gMutex);
+    EndPhaseLocked();
+
+    std::ofstream report(filename);
+    if (!report)
+    {
+        std::cout << "Unable to open file \"" << filename << "\"!\n";
+        return false;
+    }
+
+    const double freq = static_cast<double>(GetClockFreq());
+    const size_t lockWait = static_cast<size_t>(Counter::LockWaitTicks);
+
+    report << std::setprecision(6) << std::fixed;
+    report << "{\n";
+    report << "  \"phases\": [";
+    for (size_t p = 0; p < gPhases.size(); ++p)
+    {
+        const Phase& phase = gPhases[p];
+        report << (p ? "," : "") << "\n    {\n";
+        report << "      \"name\": \"" << phase.name << "\",\n";
+        report << "      \"wallSeconds\": " << phase.wallSeconds << ",\n";
+        report << "      \"threads\": " << phase.totals.threads << ",\n";
+        report << "      \"counters\": {";
+        for (size_t i = 0; i < COUNTER_COUNT; ++i)
+        {
+            report << (i ? ", " : " ") << "\"" << COUNTER_NAMES[i] << "\": ";
+            if (i == lockWait)
+                report << static_cast<double>(phase.totals.counters[i]) / freq;
+            else
+                report << phase.totals.counters[i];
+        }
+        report << " },\n";
+        report << "      \"timers\": {";
+        bool first = true;
+        for (const auto& i : phase.totals.timers)
+        {
+            report << (first ? "\n" : ",\n") << "        \"" << i.first << "\": { \"calls\": " << i.second.calls
+                   << ", \"seconds\": " << static_cast<double>(i.second.ticks) / freq << " }";
+            first = false;
+        }
+        report << (first ? "}\n" : "\n      }\n");
+        report << "    }";
+    }
+    report << (gPhases.empty() ? "]\n" : "\n  ]\n");
+    report << "}\n";
+
+    std::cout << "Profile written to \"" << filename << "\"" << std::endl;
+    return true;
+}
+
+} // namespace Profiler
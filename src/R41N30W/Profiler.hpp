@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+
+// Low overhead instrumentation - named scoped timers and event counters.
+// Every thread accumulates into its own slot, slots are merged only when a phase ends, so
+// instrumented code never contends on shared data. Until Enable() is called all of it boils
+// down to a single flag check.
+namespace Profiler {
+
+enum class Counter: unsigned char
+{
+    HashCalls = 0,
+    Reductions,
+    DictionaryProbes,
+    FalseAlarms,
+    FilterRejects, // endpoints the Bloom filter ruled out before a dictionary probe
+    LockWaitTicks, // in GetTime() ticks
+    COUNT,
+};
+
+void Enable(bool enabled);
+
+namespace Detail {
+
+extern std::atomic<bool> gEnabled;
+
+void AddCounter(Counter counter, uint64_t value);
+void AddTimer(const char* name, uint64_t ticks);
+
+} // namespace Detail
+
+inline bool IsEnabled()
+{
+    return Detail::gEnabled.load(std::memory_order_relaxed);
+}
+
+inline void Add(Counter counter, uint64_t value)
+{
+    if (IsEnabled())
+        Detail::AddCounter(counter, value);
+}
+
+// adds time spent in its scope to the timer of given name - name has to be a string literal
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(const char* name);
+    ~ScopedTimer();
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    const char* mName;
+    uint64_t mStart;
+};
+
+// std::unique_lock which counts time spent waiting for the mutex as LockWaitTicks
+class ScopedLock
+{
+public:
+    explicit ScopedLock(std::mutex& mutex);
+
+private:
+    std::unique_lock<std::mutex> mLock;
+};
+
+// Phases split the report - everything counted between BeginPhase and EndPhase is reported
+// under the phase name. Phases should change only when no instrumented worker threads run.
+void BeginPhase(const std::string& name); // ends the previous phase, if any
+void EndPhase();
+
+// ends the current phase and writes all phases to filename in JSON form
+bool WriteReport(const std::string& filename);
+
+} // namespace Profiler
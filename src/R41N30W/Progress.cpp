@@ -0,0 +1,189 @@
+#include "Progress.hpp"
+#include "Utils.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+
+
+namespace {
+
+// newer samples weigh this much in smoothed rates, so ETA follows changes without jitter
+const double RATE_SMOOTHING = 0.3;
+
+std::mutex gMachineMutex;
+std::ofstream gMachineFile;
+std::ostream* gMachineStream = nullptr;
+std::atomic<uint32_t> gInterval(500);
+
+} // anonymous namespace
+
+
+Progress::Progress()
+    : mTask()
+    , mTotal(0)
+    , mDone(0)
+    , mHashes(0)
+    , mDiscarded(0)
+    , mReporter()
+    , mMutex()
+    , mStopped()
+    , mStop(false)
+    , mPrinted(false)
+    , mStartTime(0)
+    , mLastTime(0)
+    , mLastDone(0)
+    , mLastHashes(0)
+    , mRowRate(0.0)
+    , mHashRate(0.0)
+{
+}
+
+Progress::~Progress()
+{
+    Stop();
+}
+
+bool Progress::SetMachineOutput(const std::string& filename)
+{
+    std::lock_guard<std::mutex> lock(gMachineMutex);
+    gMachineStream = nullptr;
+    if (gMachineFile.is_open())
+        gMachineFile.close();
+
+    if (filename.empty())
+        return true;
+    if (filename == "-")
+    {
+        gMachineStream = &std::cerr;
+        return true;
+    }
+
+    gMachineFile.open(filename);
+    if (!gMachineFile)
+    {
+        std::cout << "Unable to open file \"" << filename << "\"!\n";
+        return false;
+    }
+    gMachineStream = &gMachineFile;
+    return true;
+}
+
+void Progress::SetInterval(uint32_t milliseconds)
+{
+    gInterval = milliseconds ? milliseconds : 1;
+}
+
+void Progress::Start(const std::string& task, uint64_t total)
+{
+    Stop();
+
+    mTask = task;
+    mTotal = total;
+    mDone = 0;
+    mHashes = 0;
+    mDiscarded = 0;
+    mStop = false;
+    mPrinted = false;
+    mStartTime = GetTime();
+    mLastTime = mStartTime;
+    mLastDone = 0;
+    mLastHashes = 0;
+    mRowRate = 0.0;
+    mHashRate = 0.0;
+
+    mReporter = std::thread(&Progress::Report, this);
+}
+
+void Progress::Stop()
+{
+    if (!mReporter.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mStopped.notify_all();
+    mReporter.join();
+
+    Sample(true);
+}
+
+void Progress::Report()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (!mStopped.wait_for(lock, std::chrono::milliseconds(gInterval.load()), [this]() { return mStop; }))
+        Sample(false);
+}
+
+void Progress::Sample(bool final)
+{
+    const uint64_t now = GetTime();
+    const uint64_t done = mDone.load(std::memory_order_relaxed);
+    const uint64_t hashes = mHashes.load(std::memory_order_relaxed);
+    const uint64_t discarded = mDiscarded.load(std::memory_order_relaxed);
+    const double freq = static_cast<double>(GetClockFreq());
+    const double elapsed = static_cast<double>(now - mStartTime) / freq;
+
+    // final sample reports averages over the whole job
+    const double window = static_cast<double>(now - mLastTime) / freq;
+    if (final)
+    {
+        mRowRate = elapsed > 0.0 ? static_cast<double>(done) / elapsed : 0.0;
+        mHashRate = elapsed > 0.0 ? static_cast<double>(hashes) / elapsed : 0.0;
+    }
+    else if (window > 0.0)
+    {
+        const double rowRate = static_cast<double>(done - mLastDone) / window;
+        const double hashRate = static_cast<double>(hashes - mLastHashes) / window;
+        const bool first = (mLastTime == mStartTime);
+        mRowRate = first ? rowRate : RATE_SMOOTHING * rowRate + (1.0 - RATE_SMOOTHING) * mRowRate;
+        mHashRate = first ? hashRate : RATE_SMOOTHING * hashRate + (1.0 - RATE_SMOOTHING) * mHashRate;
+    }
+    mLastTime = now;
+    mLastDone = done;
+    mLastHashes = hashes;
+
+    const uint64_t remaining = mTotal > done ? mTotal - done : 0;
+    const double eta = mRowRate > 0.0 ? static_cast<double>(remaining) / mRowRate : 0.0;
+    const double percent = mTotal > 0 ? std::min(100.0, static_cast<double>(done) / static_cast<double>(mTotal) * 100.0) : 0.0;
+
+    // short jobs stay quiet on the console
+    if (!final || mPrinted)
+    {
+        // each line is formatted locally and written at once - std::cout formatting stays untouched
+        // and output of other threads cannot land in the middle of it
+        std::ostringstream line;
+        line << "Progress: " << done << "/" << mTotal << " [" << std::setfill(' ') << std::setw(6) << std::setprecision(2)
+             << std::fixed << percent << "% done] " << static_cast<uint64_t>(mRowRate) << " rows/s";
+        if (hashes > 0)
+            line << ", " << static_cast<uint64_t>(mHashRate) << " H/s";
+        if (discarded > 0)
+            line << ", " << discarded << " discarded";
+        line << " Elapsed ";
+        PrettyLogTime(line, static_cast<uint64_t>(elapsed));
+        line << " Remaining ";
+        PrettyLogTime(line, static_cast<uint64_t>(eta));
+        line << (final ? "        \n" : "        \r");
+        std::cout << line.str();
+        std::cout.flush();
+        mPrinted = true;
+    }
+
+    std::lock_guard<std::mutex> lock(gMachineMutex);
+    if (gMachineStream != nullptr)
+    {
+        std::ostringstream record;
+        record << std::setprecision(3) << std::fixed
+               << "{\"task\":\"" << mTask << "\",\"done\":" << done << ",\"total\":" << mTotal
+               << ",\"hashes\":" << hashes << ",\"discarded\":" << discarded
+               << ",\"elapsed\":" << elapsed << ",\"rowsPerSec\":" << mRowRate << ",\"hashesPerSec\":" << mHashRate
+               << ",\"eta\":" << eta << ",\"final\":" << (final ? "true" : "false") << "}\n";
+        *gMachineStream << record.str();
+        gMachineStream->flush();
+    }
+}
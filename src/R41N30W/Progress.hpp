@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+
+// Progress of a long running job. Workers only bump relaxed atomic counters, a single
+// reporter thread samples them on a timer and prints aggregate rates and ETA, so all
+// threads are accounted for and no worker ever writes to the console.
+class Progress
+{
+public:
+    Progress();
+    ~Progress();
+
+    Progress(const Progress&) = delete;
+    Progress& operator=(const Progress&) = delete;
+
+    // machine readable stream shared by all jobs - one JSON object per sample,
+    // "-" writes to stderr, empty string disables it
+    static bool SetMachineOutput(const std::string& filename);
+    static void SetInterval(uint32_t milliseconds);
+
+    // total is the number of work items (rows) expected, 0 when unknown
+    void Start(const std::string& task, uint64_t total);
+    // stops the reporter and emits the final sample
+    void Stop();
+
+    void AddDone(uint64_t count) { mDone.fetch_add(count, std::memory_order_relaxed); }
+    void AddHashes(uint64_t count) { mHashes.fetch_add(count, std::memory_order_relaxed); }
+    void AddDiscarded(uint64_t count) { mDiscarded.fetch_add(count, std::memory_order_relaxed); }
+
+private:
+    void Report();
+    void Sample(bool final);
+
+    std::string mTask;
+    uint64_t mTotal;
+    std::atomic<uint64_t> mDone;
+    std::atomic<uint64_t> mHashes;
+    std::atomic<uint64_t> mDiscarded;
+
+    // reporter state
+    std::thread mReporter;
+    std::mutex mMutex;
+    std::condition_variable mStopped;
+    bool mStop;
+    bool mPrinted; // console line needs a final newline
+    uint64_t mStartTime;
+    uint64_t mLastTime;
+    uint64_t mLastDone;
+    uint64_t mLastHashes;
+    double mRowRate;  // smoothed, per second
+    double mHashRate; // smoothed, per second
+};
@@ -10,31 +10,350 @@
 #include <fstream>
 #include <future>
 #include <iomanip>
+#include <sstream>
+#include <atomic>
+#include <chrono>
+#include <cmath>
 #include "Common.hpp"
 #include "RainbowTable.hpp"
+#include "ChainBatch.hpp"
+#include "HyperLogLog.hpp"
+#include "Profiler.hpp"
+#include "SortedRuns.hpp"
+#include "Topology.hpp"
 
 
 const std::string RAINBOW_MAGIC_TEXT_FILE = "RTXT"; // Rainbow TeXT
 const std::string RAINBOW_MAGIC_BINARY_FILE = "RBIN"; // Rainbow BINary
 
+// chains walked in lockstep by a single thread
+const size_t CHAIN_BATCH_SIZE = 32;
+// chain steps between deadline checks of a lookup
+const uint32_t DEADLINE_CHECK_STEPS = 64;
+// rows loaded or saved between progress counter updates
+const unsigned int PROGRESS_STEP = 4096;
+// bytes of the password file claimed by a worker at once
+const uint64_t PASSWORD_CHUNK_SIZE = 1 << 20;
+// text tables are parsed in chunks of this many bytes, and formatted in chunks of rows
+const uint64_t TEXT_CHUNK_SIZE = 4 << 20;
+const size_t TEXT_CHUNK_ROWS = 1 << 16;
+// binary tables are loaded, saved and checksummed in blocks of about this many bytes (whole rows)
+const uint64_t BINARY_BLOCK_SIZE = 1 << 20;
+const uint64_t BINARY_HEADER_SIZE = 24;
+// optional section after the rows of a binary table, holding CRC-32 of every block
+const std::string RAINBOW_SECTION_CHECKSUMS = "BCRC"; // Block CRC
+// optional section holding the Bloom filter of table endpoints
+const std::string RAINBOW_SECTION_BLOOM = "BLOM";
+// rows gathered by a worker before they are sorted and handed to the writer, in pipelined generation
+const size_t STAGING_RUN_ROWS = 1 << 16;
+// rows merged by a single task when runs or tables are merged
+const uint64_t MERGE_SLICE_ROWS = 1 << 18;
+
+namespace {
+
+uint64_t SplitMix64(uint64_t& state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// start point of a row in seeded generation - the same seed and row index always give the same password
+std::string SeededPassword(uint64_t seed, uint64_t row, uint32_t length)
+{
+    uint64_t state = seed ^ (row * 0x9E3779B97F4A7C15ULL);
+    uint64_t bits = 0;
+    std::string password(length, '\0');
+    for (uint32_t i = 0; i < length; ++i, bits >>= 8)
+    {
+        if (i % 8 == 0)
+            bits = SplitMix64(state);
+        password[i] = Common::Charset[(bits & 0xFF) % Common::CharsetLength];
+    }
+    return password;
+}
+
+using Dictionary = std::map<ucharVector, std::string>;
+using RowFormatter = std::function<void(Dictionary::const_iterator, Dictionary::const_iterator, std::vector<char>&)>;
+
+// Formats rows on all threads, chunkRows rows per task, and writes the chunks to file in order.
+// CRC-32 of every chunk is appended to checksums, when given.
+void WriteRows(std::ostream& file, const Dictionary& dictionary, size_t chunkRows, uint32_t threadCount,
+               const RowFormatter& format, Progress& progress, std::vector<uint32_t>* checksums)
+{
+    std::vector<std::vector<char>> buffers(threadCount);
+    std::vector<uint32_t> crcs(threadCount);
+    for (auto row = dictionary.begin(); row != dictionary.end();)
+    {
+        std::vector<std::future<void>> results;
+        std::vector<size_t> rowCounts;
+        for (uint32_t t = 0; t < threadCount && row != dictionary.end(); ++t)
+        {
+            auto begin = row;
+            size_t count = 0;
+            for (; row != dictionary.end() && count < chunkRows; ++row)
+                count++;
+            rowCounts.push_back(count);
+            results.push_back(std::async(std::launch::async, [&, begin, row, t]()
+            {
+                format(begin, row, buffers[t]);
+                if (checksums != nullptr)
+                    crcs[t] = Crc32(reinterpret_cast<const unsigned char*>(buffers[t].data()), buffers[t].size());
+            }));
+        }
+
+        for (size_t t = 0; t < results.size(); ++t)
+        {
+            results[t].wait();
+            file.write(buffers[t].data(), static_cast<std::streamsize>(buffers[t].size()));
+            if (checksums != nullptr)
+                checksums->push_back(crcs[t]);
+            progress.AddDone(rowCounts[t]);
+        }
+    }
+}
+
+// Calls func(line, length) for every line starting within [begin, end) of data - a line belongs
+// to the chunk it starts in, so consecutive chunks visit every line exactly once. Line endings
+// (\n or \r\n) are not passed to func.
+template<typename Func>
+void ForEachLine(const char* data, uint64_t size, uint64_t begin, uint64_t end, Func func)
+{
+    uint64_t position = begin;
+    if (position > 0 && position < size && data[position - 1] != '\n')
+    {
+        const void* newline = std::memchr(data + position, '\n', static_cast<size_t>(size - position));
+        if (newline == nullptr)
+            return;
+        position = static_cast<uint64_t>(static_cast<const char*>(newline) - data) + 1;
+    }
+
+    end = std::min(end, size);
+    while (position < end)
+    {
+        const char* line = data + position;
+        const void* newline = std::memchr(line, '\n', static_cast<size_t>(size - position));
+        size_t length = newline ? static_cast<size_t>(static_cast<const char*>(newline) - line) : static_cast<size_t>(size - position);
+        position += length + 1;
+
+        if (length > 0 && line[length - 1] == '\r')
+            length--;
+        func(line, length);
+    }
+}
+
+} // anonymous namespace
+
+/**
+ * Binary table mapped in memory.
+ * Header:
+ *   -> MAGIC (4 bytes)
+ *   -> hash function ID (4 bytes)
+ *   -> vertical size (8 bytes)
+ *   -> horizontal size aka. chain steps (4 bytes)
+ *   -> password length (4 bytes)
+ * Data, for all vertical sizes:
+ *   -> hash (size depends on hash function)
+ *   -> password string (length depends on pwd length)
+ * Optional sections, until the end of file:
+ *   -> tag (4 bytes)
+ *   -> payload size (8 bytes)
+ *   -> payload - for BCRC: block size in rows (4 bytes), CRC-32 of every block (4 bytes each)
+ *                for BLOM: blocks of the endpoint Bloom filter (BloomFilter::BLOCK_SIZE bytes each)
+ */
+struct BinaryTableFile
+{
+    MappedFile file;
+    uint32_t hashID;
+    uint64_t verticalSize;
+    uint32_t chainSteps;
+    uint32_t passwordLength;
+    uint32_t hashLength;
+    uint64_t rowSize;
+    const unsigned char* rows;
+    uint64_t blockRows;
+    const unsigned char* checksums; // nullptr when the table has none
+    const unsigned char* filter; // nullptr when the table has none
+    uint64_t filterSize;
+
+    // prints what is wrong when the file is not a complete binary table
+    bool Open(const std::string& filename)
+    {
+        if (!file.Open(filename))
+        {
+            std::cout << "Unable to open file \"" << filename << "\"!\n";
+            return false;
+        }
+
+        const unsigned char* data = file.Data();
+        const uint64_t size = file.Size();
+        if (size < BINARY_HEADER_SIZE || RAINBOW_MAGIC_BINARY_FILE.compare(0, 4, reinterpret_cast<const char*>(data), 4) != 0)
+        {
+            std::cout << "\"" << filename << "\" is not a binary table file." << std::endl;
+            return false;
+        }
+
+        std::memcpy(&hashID, data + 4, sizeof(hashID));
+        std::memcpy(&verticalSize, data + 8, sizeof(verticalSize));
+        std::memcpy(&chainSteps, data + 16, sizeof(chainSteps));
+        std::memcpy(&passwordLength, data + 20, sizeof(passwordLength));
+
+        hashLength = static_cast<uint32_t>(OSSLHasher::GetHashSize(static_cast<OSSLHasher::HashType>(hashID)));
+        if (hashLength == 0)
+        {
+            std::cout << "Unrecognized hash function type (" << hashID << ")." << std::endl;
+            return false;
+        }
+
+        // datasize should be at least (passwordlength + size(hash)) * verticalsize
+        rowSize = passwordLength + hashLength;
+        rows = data + BINARY_HEADER_SIZE;
+        const uint64_t dataSize = size - BINARY_HEADER_SIZE;
+        if (verticalSize > dataSize / rowSize)
+        {
+            std::cout << "Incomplete file provided (" << dataSize / rowSize << " of " << verticalSize << " rows present)" << std::endl;
+            return false;
+        }
+
+        // sections of unknown tags are skipped, so tables with newer sections still load
+        blockRows = std::max<uint64_t>(1, BINARY_BLOCK_SIZE / rowSize);
+        checksums = nullptr;
+        filter = nullptr;
+        filterSize = 0;
+        for (uint64_t position = BINARY_HEADER_SIZE + verticalSize * rowSize; position < size;)
+        {
+            uint64_t payloadSize = 0;
+            if (size - position >= 12)
+                std::memcpy(&payloadSize, data + position + 4, sizeof(payloadSize));
+            if (size - position < 12 || payloadSize > size - position - 12)
+            {
+                std::cout << "Malformed section found after table rows." << std::endl;
+                return false;
+            }
+
+            const unsigned char* payload = data + position + 12;
+            if (RAINBOW_SECTION_CHECKSUMS.compare(0, 4, reinterpret_cast<const char*>(data + position), 4) == 0)
+            {
+                uint32_t sectionBlockRows = 0;
+                if (payloadSize >= 4)
+                    std::memcpy(&sectionBlockRows, payload, sizeof(sectionBlockRows));
+                const uint64_t blockCount = sectionBlockRows ? (verticalSize + sectionBlockRows - 1) / sectionBlockRows : 0;
+                if (sectionBlockRows == 0 || payloadSize != 4 + 4 * blockCount)
+                {
+                    std::cout << "Malformed checksum section." << std::endl;
+                    return false;
+                }
+                blockRows = sectionBlockRows;
+                checksums = payload + 4;
+            }
+            else if (RAINBOW_SECTION_BLOOM.compare(0, 4, reinterpret_cast<const char*>(data + position), 4) == 0)
+            {
+                if (payloadSize == 0 || payloadSize % BloomFilter::BLOCK_SIZE != 0)
+                {
+                    std::cout << "Malformed Bloom filter section." << std::endl;
+                    return false;
+                }
+                filter = payload;
+                filterSize = payloadSize;
+            }
+            position += 12 + payloadSize;
+        }
+
+        return true;
+    }
+
+    uint64_t BlockCount() const
+    {
+        return (verticalSize + blockRows - 1) / blockRows;
+    }
+
+    // true when the block matches its checksum, or there are none
+    bool VerifyBlock(uint64_t block) const
+    {
+        if (checksums == nullptr)
+            return true;
+
+        const uint64_t first = block * blockRows;
+        const uint64_t count = std::min(blockRows, verticalSize - first);
+        uint32_t expected = 0;
+        std::memcpy(&expected, checksums + 4 * block, sizeof(expected));
+        return Crc32(rows + first * rowSize, static_cast<size_t>(count * rowSize)) == expected;
+    }
+};
+
+namespace {
+
+// checks all blocks of tables which have checksums, on all threads - corrupted rows would
+// otherwise be carried over into tables built from them
+bool VerifyTables(const std::vector<const BinaryTableFile*>& tables, const std::vector<std::string>& names, uint32_t threadCount)
+{
+    std::vector<std::pair<size_t, uint64_t>> blocks;
+    for (size_t i = 0; i < tables.size(); ++i)
+        for (uint64_t block = 0; tables[i]->checksums != nullptr && block < tables[i]->BlockCount(); ++block)
+            blocks.emplace_back(i, block);
+
+    std::mutex outputMutex;
+    std::atomic<size_t> nextBlock(0);
+    std::atomic<bool> corrupted(false);
+    std::vector<std::future<void>> results;
+    for (uint32_t t = 0; t < threadCount; ++t)
+    {
+        results.push_back(std::async(std::launch::async, [&]()
+        {
+            for (size_t b = nextBlock++; b < blocks.size(); b = nextBlock++)
+            {
+                if (!tables[blocks[b].first]->VerifyBlock(blocks[b].second))
+                {
+                    std::lock_guard<std::mutex> lock(outputMutex);
+                    std::cout << "Checksum mismatch in block " << blocks[b].second << " of \"" << names[blocks[b].first] << "\".\n";
+                    corrupted = true;
+                }
+            }
+        }));
+    }
+    for (auto& i : results)
+        i.wait();
+
+    return !corrupted;
+}
+
+} // anonymous namespace
+
 
 RainbowTable::RainbowTable(size_t startSize, uint32_t passwordLength, int chainSteps, OSSLHasher::HashType hashType)
     : mChainSteps(chainSteps)
     , mThreadCount(1)
     , mVerticalSize(startSize)
     , mPasswordLength(passwordLength)
-    , mHashFunc(OSSLHasher::GetHashFunc(hashType))
+    , mHashFunc(OSSLHasher::GetHashFunc(hashType, passwordLength))
+    , mBatchHashFunc(OSSLHasher::GetBatchHashFunc(hashType, passwordLength))
     , mHashType(hashType)
     , mHashLen(static_cast<uint32_t>(OSSLHasher::GetHashSize(hashType)))
+    , mNextPasswordChunk(0)
+    , mStagedRows(0)
+    , mStagedChains(0)
+    , mShardIndex(0)
+    , mShardCount(0)
+    , mSeed(0)
+    , mNextRow(0)
+    , mShardEnd(0)
+    , mChecksumMode(false)
+    , mBloomMode(false)
     , mRetryCount(1)
+    , mLoadState(LoadState::EMPTY)
+    , mResidentBlocks(0)
+    , mCancelLoad(false)
 {
     mReductionFunc = Reduction::Salted;
+    mBatchReductionFunc = Reduction::SaltedBatch;
     mFreq = GetClockFreq();
 }
 
 
 RainbowTable::~RainbowTable()
 {
+    StopLoader();
 }
 
 void RainbowTable::SetThreadCount(uint32_t threadCount)
@@ -58,11 +377,53 @@ void RainbowTable::SetTextMode(bool textMode)
     mTextMode = textMode;
 }
 
+void RainbowTable::SetChecksumMode(bool checksumMode)
+{
+    mChecksumMode = checksumMode;
+}
+
+void RainbowTable::SetBloomMode(bool bloomMode)
+{
+    mBloomMode = bloomMode;
+}
+
+void RainbowTable::SetStagingFile(const std::string& filename)
+{
+    mStagingFile = filename;
+}
+
+void RainbowTable::SetShard(uint32_t index, uint32_t count, uint64_t seed)
+{
+    mShardIndex = index;
+    mShardCount = count;
+    mSeed = seed;
+}
+
 bool RainbowTable::CreateTable()
 {
+    Profiler::ScopedTimer timer("generate");
     std::cout << "Threads used: " << mThreadCount << std::endl;
+    mFilter.Clear();
+    mNodeFilters.clear();
 
-    uint32_t sizeMod = mVerticalSize % mThreadCount;
+    // passwords from a file are handed out in chunks, seeded rows in batches - any count works
+    const bool fromFile = (mPasswordFile.Data() != nullptr);
+    const bool sharded = (mShardCount > 0);
+    if (sharded && fromFile)
+    {
+        // shard k walks every N-th chunk of the list - the row count is an estimate
+        const uint64_t chunks = (mPasswordFile.Size() + PASSWORD_CHUNK_SIZE - 1) / PASSWORD_CHUNK_SIZE;
+        const uint64_t shardChunks = chunks > mShardIndex ? (chunks - mShardIndex + mShardCount - 1) / mShardCount : 0;
+        mVerticalSize = chunks ? mVerticalSize * shardChunks / chunks : 0;
+    }
+    else if (sharded)
+    {
+        mNextRow = mVerticalSize * mShardIndex / mShardCount;
+        mShardEnd = mVerticalSize * (mShardIndex + 1) / mShardCount;
+        mVerticalSize = mShardEnd - mNextRow;
+        std::cout << "Shard " << mShardIndex << "/" << mShardCount << " covers rows " << mNextRow << " to " << mShardEnd - 1 << std::endl;
+    }
+    uint32_t sizeMod = (fromFile || sharded) ? 0 : mVerticalSize % mThreadCount;
     if (sizeMod != 0)
     {
         mVerticalSize -= sizeMod;
@@ -71,479 +432,1223 @@ bool RainbowTable::CreateTable()
     }
 
     std::cout << "Creating Rainbow Table with parameters:" << std::endl;
-    LogTableInfo();
+    LogTableInfo(std::cout);
 
-    if (mVerticalSize > std::numeric_limits<uint32_t>::max())
+    if (!fromFile && mVerticalSize > std::numeric_limits<uint32_t>::max())
     {
         std::cout << "Cannot create " << mVerticalSize << " Rainbow Table on 32-bit compilation." << std::endl;
         std::cout << "Please use 64-bit build for big Rainbow Tables." << std::endl;
         return false;
     }
 
+    // pipelined - workers hand sorted runs to a writer thread, the table is never held in memory
+    const bool staged = !mStagingFile.empty();
+    if (staged)
+    {
+        mRunWriter.reset(new RunWriter());
+        if (!mRunWriter->Open(mStagingFile, mThreadCount))
+        {
+            mRunWriter.reset();
+            return false;
+        }
+        mStagedRows = 0;
+        mStagedChains = 0;
+    }
+
     const unsigned int limit = static_cast<unsigned int>(mVerticalSize / mThreadCount);
     std::vector<std::future<void>> createRowsResults;
     createRowsResults.reserve(mThreadCount);
-    mOriginalPasswords.reserve(static_cast<size_t>(mVerticalSize));
     mStartTime = GetTime();
+    mProgress.Start("generate", mVerticalSize);
 
-    if (mOriginalPasswords.empty())
+    if (fromFile)
+    {
+        mNextPasswordChunk = 0;
+        for (unsigned int i = 0; i < mThreadCount; ++i)
+            createRowsResults.push_back(std::async(std::launch::async, [this, i]() { Topology::ScopedPin pin(i); CreateRowsFromFile(); }));
+    }
+    else if (sharded)
     {
         for (unsigned int i = 0; i < mThreadCount; ++i)
-            createRowsResults.push_back(std::async(std::launch::async, &RainbowTable::CreateRows, this, limit, i));
+            createRowsResults.push_back(std::async(std::launch::async, [this, i]() { Topology::ScopedPin pin(i); CreateRowsSeeded(); }));
     }
     else
     {
+        if (!staged)
+            mOriginalPasswords.reserve(static_cast<size_t>(mVerticalSize));
         for (unsigned int i = 0; i < mThreadCount; ++i)
-            createRowsResults.push_back(std::async(std::launch::async, &RainbowTable::CreateRowsFromPass, this, limit, i));
+            createRowsResults.push_back(std::async(std::launch::async, [this, limit, i]() { Topology::ScopedPin pin(i); CreateRows(limit); }));
     }
 
     for (auto &i : createRowsResults)
         if (!i.valid())
         {
+            mProgress.Stop();
             std::cout << "Invalid worker threads dispatch." << std::endl;
             return false;
         }
 
     for (auto &i : createRowsResults)
         i.wait();
+    mProgress.Stop();
 
     uint64_t stop = GetTime();
     uint64_t diff = static_cast<uint64_t>(static_cast<double>(stop - mStartTime) / static_cast<double>(mFreq));
+    // duplicates in the password file end up as colliding chains too
+    const uint64_t chains = staged ? mStagedChains.load() : (fromFile || sharded) ? mVerticalSize : mOriginalPasswords.size();
+
+    if (staged)
+    {
+        if (!mRunWriter->Close())
+        {
+            mRunWriter.reset();
+            return false;
+        }
+        mVerticalSize = mStagedRows;
+
+        std::cout << std::endl << mStagedRows << " rows staged in " << mRunWriter->GetRunSizes().size() << " sorted runs in ";
+        PrettyLogTime(diff);
+        std::cout << std::endl;
+        std::cout << chains - mStagedRows << " chains discarded due to collisions within runs, the rest is dropped when runs are merged.\n";
+        return true;
+    }
+
     mVerticalSize = mDictionary.size();
 
     std::cout << std::endl << "Table with " << mDictionary.size() << " entries built in ";
     PrettyLogTime(diff);
     std::cout << std::endl;
-    std::cout << mOriginalPasswords.size() - mDictionary.size() << " chains discarded due to collisions.\n";
+    std::cout << chains - mDictionary.size() << " chains discarded due to collisions.\n";
 
     return true;
 }
 
-void RainbowTable::LogTableInfo()
+void RainbowTable::LogTableInfo(std::ostream& log)
 {
-    std::cout << "\tHash function:\t\t" << OSSLHasher::GetHashFuncName(mHashType) << std::endl;
-    std::cout << "\tTable size:\t\t" << mVerticalSize << std::endl;
-    std::cout << "\tChain steps:\t\t" << mChainSteps << std::endl;
-    std::cout << "\tPassword length:\t" << mPasswordLength << std::endl;
+    log << "\tHash function:\t\t" << OSSLHasher::GetHashFuncName(mHashType) << std::endl;
+    log << "\tHash backend:\t\t" << OSSLHasher::GetBackendName(mHashType) << std::endl;
+    log << "\tTable size:\t\t" << mVerticalSize << std::endl;
+    log << "\tChain steps:\t\t" << mChainSteps << std::endl;
+    log << "\tPassword length:\t" << mPasswordLength << std::endl;
 }
 
-void RainbowTable::LogProgress(unsigned int current, unsigned int step, unsigned int limit)
+void RainbowTable::CreateRows(unsigned int limit)
 {
-    if (current == 0)
+    std::vector<std::string> batch;
+    std::vector<bool> inserted;
+    std::vector<int> retries;
+    std::vector<size_t> pending, collided;
+    // staged rows are not checked for collisions until the merge, so they are never retried
+    // and start passwords are not tracked - duplicates collide in the merge as well
+    RowBlock run;
+    RowBlock* staged = mRunWriter ? &run : nullptr;
+
+    for (unsigned int i = 0; i < limit; i += static_cast<unsigned int>(retries.size()))
     {
-        // for first step, do not log anything
-        return;
-    }
+        // every row of the batch gets mRetryCount attempts - only colliding ones are walked again
+        retries.assign(std::min<size_t>(CHAIN_BATCH_SIZE, limit - i), mRetryCount);
+        pending.resize(retries.size());
+        for (size_t r = 0; r < pending.size(); ++r)
+            pending[r] = r;
 
-    if ((current % step) == 0)
-    {
-        uint64_t stop = GetTime();
-        double diff = static_cast<double>(stop - mStartTime) / static_cast<double>(mFreq);
-        double progress = (static_cast<double>(current) / static_cast<double>(limit)) * 100.0;
+        while (!pending.empty())
+        {
+            batch.clear();
+            {
+                Profiler::ScopedLock lock(mPasswordMutex);
+                for (size_t r = 0; r < pending.size(); ++r)
+                {
+                    std::string password = GetRandomPassword(mPasswordLength);
+                    while (staged == nullptr && !mOriginalPasswords.insert(password).second)
+                    {
+                        // generate passwords until we'll find a unique one
+                        password = GetRandomPassword(mPasswordLength);
+                    }
+                    batch.push_back(password);
+                }
+            }
 
-        uint64_t diffSeconds = static_cast<uint64_t>(diff);
-        uint64_t etaSeconds = (static_cast<uint64_t>(diff * limit) / current) - diffSeconds;
+            RunChains(batch, inserted, staged);
 
-        std::cout << "Progress: " << current << "/" << limit << " ["
-                  << std::setw(6) << std::setprecision(4) << std::fixed << progress << "% done] Elapsed ";
-        PrettyLogTime(diffSeconds);
-        std::cout << " Remaining ";
-        PrettyLogTime(etaSeconds);
-        std::cout << "        \r";
+            collided.clear();
+            for (size_t b = 0; b < pending.size(); ++b)
+                if (!inserted[b] && --retries[pending[b]] > 0)
+                    collided.push_back(pending[b]);
+            pending.swap(collided);
+        }
+        mProgress.AddDone(retries.size());
     }
+
+    if (staged != nullptr)
+        StageRun(run);
 }
 
-void RainbowTable::CreateRows(unsigned int limit, unsigned int thread)
+namespace {
+
+struct TestResult
 {
-    std::string password;
-    unsigned int lastIndex = thread * limit;
-    for (unsigned int i = 0; i < limit; ++i)
-    {
-        if (thread == 0)
-            LogProgress(i, 200, limit);
-        int counter = mRetryCount;
-        do {
-            std::lock_guard<std::mutex> lock(mPasswordMutex);
-            password = GetRandomPassword(mPasswordLength);
-            while (!mOriginalPasswords.insert(password).second)
-            {
-                // generate passwords until we'll find a unique one
-                password = GetRandomPassword(mPasswordLength);
-            }
-        } while (!RunChain(password, lastIndex - i) && --counter > 0);
-    }
-}
+    bool found;
+    uint64_t latency; // in clock ticks
+    LookupStats stats;
+};
 
-void RainbowTable::GeneratePasswords(unsigned int limit)
+// nearest-rank percentile of already sorted values
+uint64_t Percentile(const std::vector<uint64_t>& sorted, double percent)
 {
-    std::string password;
-    for (unsigned int i = 0; i < limit; ++i)
-    {
-        std::lock_guard<std::mutex> lock(mPasswordMutex);
+    if (sorted.empty())
+        return 0;
 
-        password = GetRandomPassword(mPasswordLength);
-        while (!mOriginalPasswords.insert(password).second)
-        {
-            // generate passwords until we'll find a unique one
-            password = GetRandomPassword(mPasswordLength);
-        }
-    }
+    size_t rank = static_cast<size_t>(std::ceil(percent / 100.0 * static_cast<double>(sorted.size())));
+    rank = std::max<size_t>(rank, 1);
+    return sorted[std::min(rank, sorted.size()) - 1];
 }
 
-uint32_t RainbowTable::RunTest(uint32_t iterations)
+} // anonymous namespace
+
+uint32_t RainbowTable::RunTest(uint32_t iterations, uint32_t seed, const std::string& reportFile)
 {
     if (iterations == 0)
         return 0;
 
-    std::cout << "Test mode enabled!\n\tGenerating " << iterations << " random passwords.\n";
-    GeneratePasswords(iterations);
-    int passed = 0, counter = 0;
-    std::string pass;
-    std::vector<uint32_t> passedIndex;
-    ucharVector hashValue;
-    hashValue.resize(mHashLen);
-
-    ucharVector plainValue;
-    plainValue.reserve(mPasswordLength);
-    for (const auto& i : mOriginalPasswords)
+    if (seed == 0)
     {
-        std::cout << "\tRunning test [";
-        std::cout << std::setw(4) << std::setfill('0') << counter++;
-        std::cout << "/" << std::setw(4) << std::setfill('0') << iterations << "]          \r";
-
-        plainValue.assign(i.begin(), i.end());
-        mHashFunc(plainValue, hashValue);
-        if (!FindPassword(HashToStr(hashValue)).empty())
-        {
-            ++passed;
-            passedIndex.push_back(counter - 1);
-        }
+        std::random_device rd;
+        seed = rd() | 1;
     }
-    std::cout << "\n\tNumber of passwords found in table: " << passed << std::endl;
-    std::cout << "\tPasswords are: " << std::endl;
-    counter = 0;
-    uint32_t passedCounter = 0;
-    for (const auto& i : mOriginalPasswords)
-    {
-        if (passedCounter == passedIndex.size())
-            break;
 
-        if (counter == passedIndex[passedCounter])
-        {
-            std::cout << "\t\t" << i << std::endl;
-            passedCounter++;
-        }
+    std::cout << "Test mode enabled!\n\tGenerating " << iterations << " random passwords (seed " << seed << ").\n";
 
-        counter++;
+    // passwords are generated up-front from a single engine, so the sample does not depend on thread count
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<unsigned int> uni(0, Common::CharsetLength - 1);
+    std::vector<std::string> passwords(iterations);
+    for (auto& pass : passwords)
+    {
+        pass.resize(mPasswordLength);
+        for (auto& c : pass)
+            c = Common::Charset[uni(rng)];
     }
 
-    return passed;
-}
-
-void RainbowTable::CreateRowsFromPass(unsigned int limit, unsigned int index)
-{
-    auto begin = mOriginalPasswords.begin();
-    std::advance(begin, index * limit);
-    auto end = mOriginalPasswords.begin();
-    std::advance(end, (index + 1) * limit);
-    unsigned int counter = 0;
+    std::vector<TestResult> results(iterations);
+    std::atomic<uint32_t> nextQuery(0);
+    std::atomic<uint32_t> doneQueries(0);
 
-    for (auto i = begin; i != end; ++i)
+    // each query runs single-threaded, parallelism comes from running many queries at once
+    auto worker = [&](unsigned int thread)
     {
-        if (index == 0)
-            LogProgress(counter, 200, limit);
+        Topology::ScopedPin pin(thread);
+        ucharVector hashValue;
+        hashValue.resize(mHashLen);
+        ucharVector plainValue;
+        plainValue.reserve(mPasswordLength);
 
-        RunChain(*i, counter++);
-    }
-}
+        for (uint32_t i = nextQuery++; i < iterations; i = nextQuery++)
+        {
+            TestResult& result = results[i];
+            plainValue.assign(passwords[i].begin(), passwords[i].end());
+            mHashFunc(plainValue, hashValue);
 
-bool RainbowTable::RunChain(std::string password, unsigned int rowSalt)
-{
-    ucharVector hashValue;
-    hashValue.resize(mHashLen);
+            uint64_t start = GetTime();
+            result.found = !FindPassword(hashValue, 1, result.stats).empty();
+            result.latency = GetTime() - start;
+            ++doneQueries;
+        }
+    };
 
-    ucharVector plainValue;
-    plainValue.reserve(mPasswordLength);
-    plainValue.assign(password.begin(), password.end());
+    uint64_t testStart = GetTime();
+    std::vector<std::future<void>> workers;
+    workers.reserve(mThreadCount);
+    for (uint32_t i = 0; i < mThreadCount; ++i)
+        workers.push_back(std::async(std::launch::async, worker, i));
 
-    mHashFunc(plainValue, hashValue);
-    for (uint32_t i = 0; i < mChainSteps; ++i)
+    for (auto& i : workers)
     {
-        mReductionFunc(i, mPasswordLength, hashValue, plainValue);
-        mHashFunc(plainValue, hashValue);
+        while (i.wait_for(std::chrono::milliseconds(200)) != std::future_status::ready)
+        {
+            std::cout << "\tRunning test [" << doneQueries << "/" << iterations << "]          \r";
+            std::cout.flush();
+        }
     }
+    double wallTime = static_cast<double>(GetTime() - testStart) / static_cast<double>(mFreq);
 
+    uint32_t passed = 0;
+    uint64_t hashOps = 0, falseAlarms = 0;
+    std::vector<uint64_t> latencies;
+    latencies.reserve(iterations);
+    for (const auto& i : results)
     {
-        std::lock_guard<std::mutex> lock(mDictionaryMutex);
-        const auto res = mDictionary.insert(std::make_pair(hashValue, password));
-        return res.second;
+        passed += i.found ? 1 : 0;
+        hashOps += i.stats.hashOps;
+        falseAlarms += i.stats.falseAlarms;
+        latencies.push_back(i.latency);
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    // Wilson score interval at 95% confidence
+    const double z = 1.96;
+    const double n = static_cast<double>(iterations);
+    const double rate = static_cast<double>(passed) / n;
+    const double center = (rate + z * z / (2.0 * n)) / (1.0 + z * z / n);
+    const double margin = (z / (1.0 + z * z / n)) * std::sqrt(rate * (1.0 - rate) / n + z * z / (4.0 * n * n));
+    const double ciLow = std::max(0.0, center - margin);
+    const double ciHigh = std::min(1.0, center + margin);
+
+    const double toMs = 1000.0 / static_cast<double>(mFreq);
+    const double p50 = static_cast<double>(Percentile(latencies, 50.0)) * toMs;
+    const double p95 = static_cast<double>(Percentile(latencies, 95.0)) * toMs;
+    const double p99 = static_cast<double>(Percentile(latencies, 99.0)) * toMs;
+    const double falseAlarmsPerQuery = static_cast<double>(falseAlarms) / n;
+    const double hashOpsPerQuery = static_cast<double>(hashOps) / n;
+
+    std::cout << "\n\tNumber of passwords found in table: " << passed << "/" << iterations << std::endl;
+    std::cout << std::setprecision(4) << std::fixed;
+    std::cout << "\tSuccess rate:\t\t" << rate * 100.0 << "% (95% CI " << ciLow * 100.0 << "% - " << ciHigh * 100.0 << "%)" << std::endl;
+    std::cout << "\tFalse alarms/query:\t" << falseAlarmsPerQuery << std::endl;
+    std::cout << "\tHash ops/query:\t\t" << hashOpsPerQuery << std::endl;
+    std::cout << "\tLatency [ms]:\t\tp50 " << p50 << ", p95 " << p95 << ", p99 " << p99 << std::endl;
+    std::cout << "\tThroughput:\t\t" << n / wallTime << " queries/s (" << mThreadCount << " threads)" << std::endl;
+
+    if (!reportFile.empty())
+    {
+        std::ofstream report(reportFile);
+        if (report)
+        {
+            report << std::setprecision(6) << std::fixed;
+            report << "{\n";
+            report << "  \"hash\": \"" << OSSLHasher::GetHashFuncName(mHashType) << "\",\n";
+            report << "  \"rows\": " << mDictionary.size() << ",\n";
+            report << "  \"chainSteps\": " << mChainSteps << ",\n";
+            report << "  \"passwordLength\": " << mPasswordLength << ",\n";
+            report << "  \"threads\": " << mThreadCount << ",\n";
+            report << "  \"seed\": " << seed << ",\n";
+            report << "  \"queries\": " << iterations << ",\n";
+            report << "  \"found\": " << passed << ",\n";
+            report << "  \"successRate\": " << rate << ",\n";
+            report << "  \"successRateCI95\": [" << ciLow << ", " << ciHigh << "],\n";
+            report << "  \"falseAlarmsPerQuery\": " << falseAlarmsPerQuery << ",\n";
+            report << "  \"hashOpsPerQuery\": " << hashOpsPerQuery << ",\n";
+            report << "  \"latencyMs\": { \"p50\": " << p50 << ", \"p95\": " << p95 << ", \"p99\": " << p99 << " },\n";
+            report << "  \"wallTimeSeconds\": " << wallTime << "\n";
+            report << "}\n";
+            std::cout << "\tReport written to \"" << reportFile << "\"" << std::endl;
+        }
+        else
+        {
+            std::cout << "Unable to open file \"" << reportFile << "\"!\n";
+        }
     }
+
+    return passed;
 }
 
-void RainbowTable::LoadPasswords(const std::string& filename)
+bool RainbowTable::Analyze(uint64_t samples, TableAnalysis& analysis)
 {
-    std::cout << "Loading passwords from file \"" << filename << "\"\n";
-    std::string line1;
-    std::ifstream file(filename);
-
-    if (file)
+    analysis = TableAnalysis();
+    analysis.rows = mDictionary.size();
+    if (mDictionary.empty())
     {
-        std::lock_guard<std::mutex> lock(mPasswordMutex);
-
-        mOriginalPasswords.clear();
-        while (getline(file, line1))
-        {
-            mOriginalPasswords.insert(line1);
-        }
-        mVerticalSize = mOriginalPasswords.size();
-        if (mVerticalSize > 0)
-            mPasswordLength = static_cast<uint32_t>(mOriginalPasswords.begin()->size());
-        std::cout << "Loaded " << static_cast<unsigned int>(mVerticalSize) << " passwords of length = " << mPasswordLength << ".\n";
-        file.close();
+        std::cout << "Table is empty - nothing to analyze." << std::endl;
+        return false;
     }
-    else
+
+    Profiler::ScopedTimer timer("analyze");
+
+    // endpoints are hashes, so rows evenly spaced in endpoint order are a random sample
+    samples = (samples == 0) ? analysis.rows : std::min<uint64_t>(samples, analysis.rows);
+    std::vector<Dictionary::const_iterator> rows;
+    rows.reserve(static_cast<size_t>(samples));
+    uint64_t index = 0;
+    for (auto i = mDictionary.cbegin(); i != mDictionary.cend(); ++i, ++index)
     {
-        std::cout << "Unable to open file \"" << filename << "\"!\n";
+        if ((index * samples) % analysis.rows < samples)
+            rows.push_back(i);
     }
-}
 
-void RainbowTable::SavePasswords(const std::string& filename)
-{
-    std::cout << "Saving passwords to file \"" << filename << "\"\n";
-    std::string line1;
-    std::ofstream file(filename);
+    std::cout << "Analyzing " << samples << " of " << analysis.rows << " chains on " << mThreadCount << " threads..." << std::endl;
 
-    if (file)
+    std::atomic<uint64_t> nextChain(0);
+    std::vector<TableAnalysis> partials(mThreadCount);
+    std::vector<HyperLogLog> counters(mThreadCount);
+    auto worker = [&](unsigned int thread)
     {
-        std::lock_guard<std::mutex> lock(mPasswordMutex);
+        Topology::ScopedPin pin(thread);
+        TableAnalysis& partial = partials[thread];
+        HyperLogLog& counter = counters[thread];
 
-        for (const auto &pass : mOriginalPasswords)
+        ucharVector hashValue;
+        hashValue.resize(mHashLen);
+        ucharVector plainValue;
+        plainValue.reserve(mPasswordLength);
+        std::vector<uint64_t> keys(mChainSteps + 1);
+
+        for (uint64_t chain = nextChain++; chain < samples; chain = nextChain++)
         {
-            file << pass << std::endl;
+            const std::string& startPlain = rows[static_cast<size_t>(chain)]->second;
+            plainValue.assign(startPlain.begin(), startPlain.end());
+            for (uint32_t i = 0; i <= mChainSteps; ++i)
+            {
+                if (i > 0)
+                    mReductionFunc(i - 1, mPasswordLength, hashValue, plainValue);
+                mHashFunc(plainValue, hashValue);
+                std::memcpy(&keys[i], hashValue.data(), sizeof(uint64_t));
+                counter.Add(hashValue.data());
+            }
+
+            // chains of a table never share a point at the same step, but may repeat one at another
+            std::sort(keys.begin(), keys.end());
+            const uint64_t repeats = static_cast<uint64_t>(keys.end() - std::unique(keys.begin(), keys.end()));
+
+            partial.chains++;
+            partial.points += mChainSteps + 1;
+            partial.chainDistinct += mChainSteps + 1 - repeats;
+            partial.repeatChains += (repeats > 0) ? 1 : 0;
+            partial.brokenChains += (hashValue != rows[static_cast<size_t>(chain)]->first) ? 1 : 0;
+
+            Profiler::Add(Profiler::Counter::HashCalls, mChainSteps + 1);
+            Profiler::Add(Profiler::Counter::Reductions, mChainSteps);
+            mProgress.AddHashes(mChainSteps + 1);
+            mProgress.AddDone(1);
         }
+    };
+
+    const uint64_t start = GetTime();
+    mProgress.Start("analyze", samples);
+    std::vector<std::future<void>> workers;
+    workers.reserve(mThreadCount);
+    for (unsigned int i = 0; i < mThreadCount; ++i)
+        workers.push_back(std::async(std::launch::async, worker, i));
+    for (auto& i : workers)
+        i.wait();
+    mProgress.Stop();
 
-        std::cout << "Saved " << static_cast<unsigned int>(mOriginalPasswords.size()) << " passwords of length = " << mPasswordLength << ".\n";
-        file.close();
-    }
-    else
+    for (unsigned int i = 0; i < mThreadCount; ++i)
     {
-        std::cout << "Unable to open file \"" << filename << "\"!\n";
+        analysis.chains += partials[i].chains;
+        analysis.points += partials[i].points;
+        analysis.chainDistinct += partials[i].chainDistinct;
+        analysis.repeatChains += partials[i].repeatChains;
+        analysis.brokenChains += partials[i].brokenChains;
+        if (i > 0)
+            counters[0].Merge(counters[i]);
     }
+    analysis.distinct = std::min(counters[0].Estimate(), static_cast<double>(analysis.chainDistinct));
+    analysis.seconds = static_cast<double>(GetTime() - start) / static_cast<double>(mFreq);
+    return true;
 }
 
-bool RainbowTable::LoadText(const std::string& filename)
+void RainbowTable::CreateRowsFromFile()
 {
-    std::ifstream file(filename);
-
-    if (file)
+    const char* data = reinterpret_cast<const char*>(mPasswordFile.Data());
+    const uint64_t size = mPasswordFile.Size();
+
+    std::vector<std::string> batch;
+    std::vector<bool> inserted;
+    RowBlock run;
+    RowBlock* staged = mRunWriter ? &run : nullptr;
+    batch.reserve(CHAIN_BATCH_SIZE);
+    auto runBatch = [&]()
     {
-        std::string line1, line2;
-        try
+        RunChains(batch, inserted, staged);
+        mProgress.AddDone(batch.size());
+        batch.clear();
+    };
+
+    // a shard walks every N-th chunk of the file
+    const uint64_t stride = mShardCount > 0 ? mShardCount : 1;
+    auto nextChunk = [&]() { return (mShardIndex + mNextPasswordChunk++ * stride) * PASSWORD_CHUNK_SIZE; };
+    for (uint64_t begin = nextChunk(); begin < size; begin = nextChunk())
+    {
+        ForEachLine(data, size, begin, begin + PASSWORD_CHUNK_SIZE, [&](const char* line, size_t length)
         {
-            std::getline(file, line1); // dummy getline to pass the line with magic value
-
-            std::getline(file, line1);
-            std::string hashFuncStr = line1;
-            mHashType = OSSLHasher::GetHashTypeFromString(hashFuncStr);
-            if (mHashType == OSSLHasher::HashType::UNKNOWN)
-            {
-                std::cout << "Unrecognized hash function type." << std::endl;
-                return false;
-            }
-
-            mHashFunc = OSSLHasher::GetHashFunc(mHashType);
+            if (length != mPasswordLength)
+                return;
 
-            std::getline(file, line1);
-            mVerticalSize = std::stol(line1);
+            batch.emplace_back(line, length);
+            if (batch.size() == CHAIN_BATCH_SIZE)
+                runBatch();
+        });
+    }
 
-            std::getline(file, line1);
-            mChainSteps = std::stoi(line1);
+    if (!batch.empty())
+        runBatch();
+    if (staged != nullptr)
+        StageRun(run);
+}
 
-            std::getline(file, line1);
-            mPasswordLength = std::stoi(line1);
+void RainbowTable::CreateRowsSeeded()
+{
+    std::vector<std::string> batch;
+    std::vector<bool> inserted;
+    RowBlock run;
+    RowBlock* staged = mRunWriter ? &run : nullptr;
 
-            // 2 rows in file is 1 insertion into the dictionary
-            uint32_t counter = 0;
-            ucharVector hash;
-            hash.reserve(OSSLHasher::GetHashSize(mHashType));
-            while (getline(file, line1) && getline(file, line2))
-            {
-                LogProgress(counter, 10000, static_cast<unsigned int>(mVerticalSize));
-                hash.clear();
-                StrToHash(line1, hash);
-                mDictionary[hash] = line2;
-                counter++;
-            }
-        }
-        catch (const std::exception& e)
-        {
-            std::cout << "Exception caught while reading from file: " << e.what() << std::endl;
-            return false;
-        }
+    for (uint64_t first = mNextRow.fetch_add(CHAIN_BATCH_SIZE); first < mShardEnd; first = mNextRow.fetch_add(CHAIN_BATCH_SIZE))
+    {
+        batch.clear();
+        for (uint64_t row = first; row < std::min<uint64_t>(first + CHAIN_BATCH_SIZE, mShardEnd); ++row)
+            batch.push_back(SeededPassword(mSeed, row, mPasswordLength));
 
-        return true;
+        RunChains(batch, inserted, staged);
+        mProgress.AddDone(batch.size());
     }
 
-    return false;
+    if (staged != nullptr)
+        StageRun(run);
 }
 
-bool RainbowTable::LoadBinary(const std::string& filename)
+void RainbowTable::RunChains(const std::vector<std::string>& passwords, std::vector<bool>& inserted, RowBlock* staged)
 {
-    /**
-     * Header:
-     *   -> MAGIC (4 bytes)
-     *   -> hash function ID (4 bytes)
-     *   -> vertical size (8 bytes)
-     *   -> horizontal size aka. chain steps (4 bytes)
-     *   -> password length (4 bytes)
-     * Data, for all vertical sizes:
-     *   -> hash (size depends on hash function)
-     *   -> password string (length depends on pwd length)
-     */
+    inserted.assign(passwords.size(), false);
+    if (passwords.empty())
+        return;
 
-    std::ifstream file(filename, std::ifstream::binary);
+    std::vector<unsigned char> plains(passwords.size() * mPasswordLength);
+    for (size_t i = 0; i < passwords.size(); ++i)
+        std::memcpy(&plains[i * mPasswordLength], passwords[i].data(), mPasswordLength);
 
-    if (file)
+    std::vector<unsigned char> hashes(passwords.size() * mHashLen);
+    ChainBatch batch(passwords.size(), mPasswordLength, mHashLen, mBatchHashFunc, mBatchReductionFunc);
     {
-        uint32_t hashID = 0;
-        file.read(reinterpret_cast<char*>(&hashID), sizeof(hashID)); // dummy read to pass the magic value
-        file.read(reinterpret_cast<char*>(&hashID), sizeof(hashID)); // hash id
-        file.read(reinterpret_cast<char*>(&mVerticalSize), sizeof(mVerticalSize)); // vert size
-        file.read(reinterpret_cast<char*>(&mChainSteps), sizeof(mChainSteps)); // horizontal size
-        file.read(reinterpret_cast<char*>(&mPasswordLength), sizeof(mPasswordLength)); // pwd len
+        Profiler::ScopedTimer timer("generate/chains");
+        mBatchHashFunc(plains.data(), hashes.data(), passwords.size());
+        Profiler::Add(Profiler::Counter::HashCalls, passwords.size());
 
-        mHashType = static_cast<OSSLHasher::HashType>(hashID);
-        mHashLen = static_cast<uint32_t>(OSSLHasher::GetHashSize(mHashType));
+        for (size_t i = 0; i < passwords.size(); ++i)
+            batch.Add(&hashes[i * mHashLen], 0, mChainSteps, i);
+
+        // all lanes have the same length - they finish together
+        for (uint32_t i = 0; i < mChainSteps; ++i)
+            batch.Step();
+    }
 
-        // check how much data awaits for us
-        std::streampos curPos = file.tellg();
-        file.seekg(0, std::ios_base::end);
-        uint64_t dataSize = static_cast<uint64_t>(file.tellg() - curPos);
-        file.seekg(curPos, std::ios_base::beg);
+    mProgress.AddHashes(passwords.size() * (static_cast<uint64_t>(mChainSteps) + 1));
 
-        // calculate how much data we want to read
-        // datasize should be (passwordlength + size(hash)) * verticalsize
-        uint64_t expectedSize = (mPasswordLength + mHashLen) * mVerticalSize;
-        if (expectedSize != dataSize)
+    if (staged != nullptr)
+    {
+        const size_t rowSize = mHashLen + mPasswordLength;
+        batch.Collect([&](uint64_t tag, const unsigned char* hashValue)
         {
-            std::cout << "Incomplete file provided (difference of " << expectedSize - dataSize << " compared to expected size)" << std::endl;
+            staged->insert(staged->end(), hashValue, hashValue + mHashLen);
+            staged->insert(staged->end(), passwords[tag].begin(), passwords[tag].end());
             return false;
-        }
-
-        ucharVector hashBuffer;
-        hashBuffer.resize(mHashLen);
-        ucharVector passwordBuffer;
-        passwordBuffer.resize(mPasswordLength);
-        std::string passwordString;
-        passwordString.resize(mPasswordLength);
+        });
+        inserted.assign(passwords.size(), true);
+        mStagedChains += passwords.size();
 
-        for (uint64_t i = 0; i < mVerticalSize; ++i)
-        {
-            file.read(reinterpret_cast<char*>(hashBuffer.data()), mHashLen);
-            file.read(reinterpret_cast<char*>(passwordBuffer.data()), mPasswordLength);
+        if (staged->size() >= STAGING_RUN_ROWS * rowSize)
+            StageRun(*staged);
+        return;
+    }
 
-            // rewrite the password from buffer to string
-            for (uint32_t j = 0; j < mPasswordLength; ++j)
-                passwordString[j] = passwordBuffer[j];
-            mDictionary[hashBuffer] = passwordString;
-        }
+    std::vector<std::pair<uint64_t, ucharVector>> endpoints;
+    endpoints.reserve(passwords.size());
+    batch.Collect([&](uint64_t tag, const unsigned char* hashValue)
+    {
+        endpoints.emplace_back(tag, ucharVector(hashValue, hashValue + mHashLen));
+        return false;
+    });
 
-        return true;
+    Profiler::ScopedTimer timer("generate/insert");
+    Profiler::ScopedLock lock(mDictionaryMutex);
+    Profiler::Add(Profiler::Counter::DictionaryProbes, endpoints.size());
+    size_t collisions = 0;
+    for (auto& i : endpoints)
+    {
+        inserted[i.first] = mDictionary.insert(std::make_pair(std::move(i.second), passwords[i.first])).second;
+        collisions += inserted[i.first] ? 0 : 1;
     }
 
-    return false;
+    mProgress.AddDiscarded(collisions);
 }
 
-bool RainbowTable::Load(const std::string& filename)
+void RainbowTable::StageRun(RowBlock& run)
 {
-    std::cout << "Loading table from file \"" << filename << "\"\n";
-    std::ifstream file(filename, std::ifstream::binary);
-    mStartTime = GetTime();
+    if (run.empty())
+        return;
 
-    if (file)
+    const uint32_t rowSize = mHashLen + mPasswordLength;
     {
-        std::lock_guard<std::mutex> lock(mDictionaryMutex);
+        Profiler::ScopedTimer timer("generate/sort");
+        const uint64_t collisions = SortRows(run, mHashLen, rowSize);
+        mProgress.AddDiscarded(collisions);
+        mStagedRows += run.size() / rowSize;
+    }
 
-        mDictionary.clear();
+    Profiler::ScopedTimer timer("generate/stage");
+    mRunWriter->Push(std::move(run));
+    run = RowBlock();
+    run.reserve(STAGING_RUN_ROWS * rowSize);
+}
+
+double RainbowTable::MeasureChainRate(double seconds)
+{
+    if (mChainSteps == 0 || mPasswordLength == 0)
+        return 0.0;
+
+    const uint64_t duration = static_cast<uint64_t>(seconds * static_cast<double>(mFreq));
+    const uint32_t blockSteps = 256; // check the clock every few steps, chains may be very long
+
+    auto worker = [&](unsigned int thread) -> uint64_t
+    {
+        Topology::ScopedPin pin(thread);
+        std::mt19937 rng(thread + 1);
+        std::uniform_int_distribution<unsigned int> uni(0, Common::CharsetLength - 1);
 
-        // recognize file type and load appropriate
-        char magic[5];
-        file.read(magic, 4);
-        magic[4] = 0;
-        file.close(); // we will reopen the file in specific loaders, when we determine the type
+        std::vector<unsigned char> plain(mPasswordLength);
+        std::vector<unsigned char> hash(mHashLen);
+        ChainBatch batch(CHAIN_BATCH_SIZE, mPasswordLength, mHashLen, mBatchHashFunc, mBatchReductionFunc);
 
-        if (RAINBOW_MAGIC_TEXT_FILE.compare(0, 4, magic) == 0)
+        // finished chains are replaced by new random ones, so the batch stays full
+        auto refill = [&]()
         {
-            if (!LoadText(filename))
-                return false;
-        }
-        else if (RAINBOW_MAGIC_BINARY_FILE.compare(0, 4, magic) == 0)
+            while (!batch.Full())
+            {
+                for (auto& c : plain)
+                    c = Common::Charset[uni(rng)];
+                mBatchHashFunc(plain.data(), hash.data(), 1);
+                batch.Add(hash.data(), 0, mChainSteps, 0);
+            }
+        };
+
+        uint64_t steps = 0;
+        uint64_t start = GetTime();
+        while (GetTime() - start < duration)
         {
-            if (!LoadBinary(filename))
-                return false;
+            for (uint32_t i = 0; i < blockSteps; ++i)
+            {
+                batch.Collect([](uint64_t, const unsigned char*) { return false; });
+                refill();
+                batch.Step();
+                steps += batch.Size();
+            }
         }
-        else
+        return steps;
+    };
+
+    uint64_t start = GetTime();
+    std::vector<std::future<uint64_t>> results;
+    results.reserve(mThreadCount);
+    for (unsigned int i = 0; i < mThreadCount; ++i)
+        results.push_back(std::async(std::launch::async, worker, i));
+
+    uint64_t steps = 0;
+    for (auto& i : results)
+        steps += i.get();
+    double elapsed = static_cast<double>(GetTime() - start) / static_cast<double>(mFreq);
+
+    return elapsed > 0.0 ? static_cast<double>(steps) / elapsed : 0.0;
+}
+
+void RainbowTable::LoadPasswords(const std::string& filename)
+{
+    std::cout << "Loading passwords from file \"" << filename << "\"\n";
+    if (!mPasswordFile.Open(filename))
+    {
+        std::cout << "Unable to open file \"" << filename << "\"!\n";
+        return;
+    }
+
+    const char* data = reinterpret_cast<const char*>(mPasswordFile.Data());
+    const uint64_t size = mPasswordFile.Size();
+
+    // password length is taken from the first non-empty line, lines of other lengths are skipped
+    uint32_t passwordLength = 0;
+    for (uint64_t position = 0; position < size && passwordLength == 0; )
+    {
+        const char* line = data + position;
+        const void* newline = std::memchr(line, '\n', static_cast<size_t>(size - position));
+        size_t length = newline ? static_cast<size_t>(static_cast<const char*>(newline) - line) : static_cast<size_t>(size - position);
+        position += length + 1;
+
+        if (length > 0 && line[length - 1] == '\r')
+            length--;
+        passwordLength = static_cast<uint32_t>(length);
+    }
+    if (passwordLength == 0)
+    {
+        std::cout << "No passwords found in file \"" << filename << "\"!\n";
+        mPasswordFile.Close();
+        return;
+    }
+
+    // only count the lines here, chunk by chunk on all threads
+    std::atomic<uint64_t> nextChunk(0);
+    auto countLines = [&]() -> std::pair<uint64_t, uint64_t>
+    {
+        std::pair<uint64_t, uint64_t> counts(0, 0); // matching, skipped
+        for (uint64_t begin = nextChunk.fetch_add(PASSWORD_CHUNK_SIZE); begin < size; begin = nextChunk.fetch_add(PASSWORD_CHUNK_SIZE))
         {
-            std::cout << "Provided file is not a proper R41N30W table file." << std::endl;
-            std::cout << "Generate one to be used with --generate option (see help for details)." << std::endl;
-            return false;
+            ForEachLine(data, size, begin, begin + PASSWORD_CHUNK_SIZE, [&](const char*, size_t length)
+            {
+                if (length == passwordLength)
+                    counts.first++;
+                else if (length > 0)
+                    counts.second++;
+            });
         }
+        return counts;
+    };
+
+    std::vector<std::future<std::pair<uint64_t, uint64_t>>> results;
+    for (uint32_t i = 0; i < mThreadCount; ++i)
+        results.push_back(std::async(std::launch::async, countLines));
+
+    uint64_t passwords = 0, skipped = 0;
+    for (auto& i : results)
+    {
+        auto counts = i.get();
+        passwords += counts.first;
+        skipped += counts.second;
+    }
+
+    mVerticalSize = passwords;
+    if (mPasswordLength != passwordLength)
+    {
+        mPasswordLength = passwordLength;
+        mHashFunc = OSSLHasher::GetHashFunc(mHashType, mPasswordLength);
+        mBatchHashFunc = OSSLHasher::GetBatchHashFunc(mHashType, mPasswordLength);
+    }
+
+    std::cout << "Found " << passwords << " passwords of length = " << mPasswordLength << ".\n";
+    if (skipped > 0)
+        std::cout << "Skipped " << skipped << " lines of other lengths.\n";
+}
+
+void RainbowTable::SavePasswords(const std::string& filename)
+{
+    std::cout << "Saving passwords to file \"" << filename << "\"\n";
+    std::string line1;
+    std::ofstream file(filename);
 
-        if (mVerticalSize != mDictionary.size())
+    if (file)
+    {
+        std::lock_guard<std::mutex> lock(mPasswordMutex);
+
+        for (const auto &pass : mOriginalPasswords)
         {
-            std::cout << "\nIncomplete table provided:" << std::endl;
-            std::cout << "  Table has " << mDictionary.size() << " rows" << std::endl;
-            std::cout << "  Should have " << mVerticalSize << " rows" << std::endl;
-            return false;
+            file << pass << std::endl;
         }
 
-        if (mPasswordLength != mDictionary.begin()->second.size())
+        std::cout << "Saved " << static_cast<unsigned int>(mOriginalPasswords.size()) << " passwords of length = " << mPasswordLength << ".\n";
+        file.close();
+    }
+    else
+    {
+        std::cout << "Unable to open file \"" << filename << "\"!\n";
+    }
+}
+
+bool RainbowTable::LoadText(const std::string& filename)
+{
+    Profiler::ScopedTimer timer("load/text");
+    MappedFile file;
+    if (!file.Open(filename))
+        return false;
+
+    const char* data = reinterpret_cast<const char*>(file.Data());
+    const uint64_t size = file.Size();
+
+    // header lines: magic, hash function name, vertical size, chain steps, password length
+    std::vector<std::string> header;
+    uint64_t bodyStart = 0;
+    while (header.size() < 5 && bodyStart < size)
+    {
+        const void* newline = std::memchr(data + bodyStart, '\n', static_cast<size_t>(size - bodyStart));
+        const uint64_t lineEnd = newline ? static_cast<uint64_t>(static_cast<const char*>(newline) - data) : size;
+        header.emplace_back(data + bodyStart, static_cast<size_t>(lineEnd - bodyStart));
+        if (!header.back().empty() && header.back().back() == '\r')
+            header.back().pop_back();
+        bodyStart = std::min(size, lineEnd + 1);
+    }
+    if (header.size() < 5)
+    {
+        std::cout << "Incomplete table header." << std::endl;
+        return false;
+    }
+
+    try
+    {
+        mHashType = OSSLHasher::GetHashTypeFromString(header[1]);
+        if (mHashType == OSSLHasher::HashType::UNKNOWN)
         {
-            std::cout << "\nMalformed table provided - password lengths (declared vs actual) do not match." << std::endl;
+            std::cout << "Unrecognized hash function type." << std::endl;
             return false;
         }
 
         mHashFunc = OSSLHasher::GetHashFunc(mHashType);
+        mHashLen = static_cast<uint32_t>(OSSLHasher::GetHashSize(mHashType));
+        mVerticalSize = std::stoull(header[2]);
+        mChainSteps = static_cast<uint32_t>(std::stoul(header[3]));
+        mPasswordLength = static_cast<uint32_t>(std::stoul(header[4]));
+    }
+    catch (const std::exception& e)
+    {
+        std::cout << "Exception caught while reading from file: " << e.what() << std::endl;
+        return false;
+    }
+
+    // Rows are two lines (hash, password). Chunks start at arbitrary lines, so each chunk first
+    // counts its lines - line parity at the start of every chunk follows from the counts before it.
+    const uint64_t bodySize = size - bodyStart;
+    const size_t chunkCount = static_cast<size_t>((bodySize + TEXT_CHUNK_SIZE - 1) / TEXT_CHUNK_SIZE);
+    auto chunkBegin = [&](size_t chunk) { return bodyStart + chunk * TEXT_CHUNK_SIZE; };
+
+    std::vector<uint64_t> firstLine(chunkCount + 1, 0);
+    {
+        std::atomic<size_t> nextChunk(0);
+        std::vector<std::future<void>> results;
+        for (uint32_t t = 0; t < mThreadCount; ++t)
+        {
+            results.push_back(std::async(std::launch::async, [&]()
+            {
+                for (size_t c = nextChunk++; c < chunkCount; c = nextChunk++)
+                {
+                    uint64_t lines = 0;
+                    ForEachLine(data + bodyStart, bodySize, chunkBegin(c) - bodyStart, chunkBegin(c + 1) - bodyStart,
+                                [&](const char*, size_t) { lines++; });
+                    firstLine[c + 1] = lines;
+                }
+            }));
+        }
+        for (auto& i : results)
+            i.wait();
+    }
+    for (size_t c = 0; c < chunkCount; ++c)
+        firstLine[c + 1] += firstLine[c];
+
+    using Row = std::pair<ucharVector, std::string>;
+    std::atomic<bool> malformed(false);
+    auto parseChunk = [&](size_t chunk, std::vector<Row>& rows)
+    {
+        rows.clear();
+        uint64_t lineIndex = firstLine[chunk];
+        const char* bodyEnd = data + size;
+        ForEachLine(data + bodyStart, bodySize, chunkBegin(chunk) - bodyStart, chunkBegin(chunk + 1) - bodyStart,
+                    [&](const char* line, size_t length)
+        {
+            // rows are handled by the chunk holding their hash line, password line may be in the next one
+            if (lineIndex++ % 2 != 0)
+                return;
+
+            const char* password = static_cast<const char*>(std::memchr(line + length, '\n', static_cast<size_t>(bodyEnd - line - length)));
+            if (password == nullptr)
+                return; // hash without a password - incomplete last row
+            password++;
+            const char* passwordEnd = static_cast<const char*>(std::memchr(password, '\n', static_cast<size_t>(bodyEnd - password)));
+            passwordEnd = passwordEnd ? passwordEnd : bodyEnd;
+            if (passwordEnd > password && passwordEnd[-1] == '\r')
+                passwordEnd--;
+
+            rows.emplace_back(ucharVector(length / 2), std::string(password, passwordEnd));
+            if (length != 2 * static_cast<size_t>(mHashLen) || !HexToHash(line, length, rows.back().first.data()))
+                malformed = true;
+        });
+    };
+
+    // chunks are parsed in rounds of one per thread, then merged in file order
+    mProgress.Start("load", mVerticalSize);
+    std::vector<std::vector<Row>> parsed(mThreadCount);
+    uint64_t counter = 0;
+    for (size_t round = 0; round < chunkCount && !malformed; round += mThreadCount)
+    {
+        const size_t roundChunks = std::min<size_t>(mThreadCount, chunkCount - round);
+        std::vector<std::future<void>> results;
+        for (size_t c = 0; c < roundChunks; ++c)
+            results.push_back(std::async(std::launch::async, parseChunk, round + c, std::ref(parsed[c])));
+        for (auto& i : results)
+            i.wait();
+
+        for (size_t c = 0; c < roundChunks; ++c)
+        {
+            // rows are saved in key order, so appending at the end is the common case
+            for (auto& row : parsed[c])
+                mDictionary.emplace_hint(mDictionary.end(), std::move(row.first), std::string())->second = std::move(row.second);
+            counter += parsed[c].size();
+            mProgress.AddDone(parsed[c].size());
+        }
+    }
+    mProgress.Stop();
+    Profiler::Add(Profiler::Counter::DictionaryProbes, counter);
+
+    if (malformed)
+    {
+        std::cout << "Malformed hash found in table file." << std::endl;
+        return false;
+    }
+
+    return true;
+}
 
-        std::cout << "\nTable loaded:" << std::endl;
-        LogTableInfo();
+bool RainbowTable::LoadBinary(std::ostream& log, bool background)
+{
+    Profiler::ScopedTimer timer("load/binary");
+    const BinaryTableFile& table = *mMappedTable;
+
+    // A fixed set of workers claims blocks in file order and verifies and decodes them into a window
+    // of slots, while this thread inserts finished ones in file order. Rows are sorted by endpoint, so
+    // every insert lands at the end of the map - still one node at a time, building the map itself
+    // is not parallel.
+    using Row = std::pair<ucharVector, std::string>;
+    const uint64_t blockRows = table.blockRows;
+    const uint64_t blockCount = table.BlockCount();
+    auto parseBlock = [&](uint64_t block, std::vector<Row>& rows)
+    {
+        if (!table.VerifyBlock(block))
+            return false;
+
+        const uint64_t first = block * blockRows;
+        const uint64_t count = std::min(blockRows, mVerticalSize - first);
+        const unsigned char* row = table.rows + first * table.rowSize;
+        rows.clear();
+        rows.reserve(static_cast<size_t>(count));
+        for (uint64_t i = 0; i < count; ++i, row += table.rowSize)
+            rows.emplace_back(ucharVector(row, row + mHashLen), std::string(reinterpret_cast<const char*>(row) + mHashLen, mPasswordLength));
         return true;
+    };
+
+    const size_t window = 2 * static_cast<size_t>(mThreadCount);
+    std::vector<std::vector<Row>> parsed(window);
+    std::vector<uint64_t> parsedBlock(window, 0); // block + 1 once its slot holds it
+    std::vector<char> parsedValid(window, 0);
+    std::atomic<uint64_t> nextBlock(0);
+    uint64_t insertedBlocks = 0;
+    bool stop = false;
+    std::mutex slotMutex;
+    std::condition_variable slotChanged;
+
+    // a block waits for its slot until the one parsed there before is inserted
+    auto worker = [&]()
+    {
+        for (uint64_t block = nextBlock++; block < blockCount; block = nextBlock++)
+        {
+            const size_t slot = static_cast<size_t>(block % window);
+            {
+                std::unique_lock<std::mutex> lock(slotMutex);
+                slotChanged.wait(lock, [&]() { return stop || block < insertedBlocks + window; });
+                if (stop)
+                    return;
+            }
+
+            const bool valid = parseBlock(block, parsed[slot]);
+            {
+                std::lock_guard<std::mutex> lock(slotMutex);
+                parsedBlock[slot] = block + 1;
+                parsedValid[slot] = valid ? 1 : 0;
+            }
+            slotChanged.notify_all();
+        }
+    };
+
+    std::vector<std::future<void>> workers;
+    for (uint64_t t = 0; t < std::min<uint64_t>(mThreadCount, blockCount); ++t)
+        workers.push_back(std::async(std::launch::async, worker));
+    bool corrupted = false;
+
+    // the 'status' query reports progress of a background load
+    if (!background)
+        mProgress.Start("load", mVerticalSize);
+    for (uint64_t block = 0; block < blockCount && !mCancelLoad; ++block)
+    {
+        const size_t slot = static_cast<size_t>(block % window);
+        bool valid = false;
+        {
+            std::unique_lock<std::mutex> lock(slotMutex);
+            slotChanged.wait(lock, [&]() { return parsedBlock[slot] == block + 1; });
+            valid = parsedValid[slot] != 0;
+        }
+        if (!valid)
+        {
+            log << "Checksum mismatch in block " << block << " (rows " << block * blockRows << " and on)." << std::endl;
+            corrupted = true;
+            break;
+        }
+
+        for (auto& row : parsed[slot])
+            mDictionary.emplace_hint(mDictionary.end(), std::move(row.first), std::move(row.second));
+        mProgress.AddDone(parsed[slot].size());
+        {
+            std::lock_guard<std::mutex> lock(slotMutex);
+            insertedBlocks = block + 1;
+        }
+        slotChanged.notify_all();
+
+        // lookups running during a background load wait for verified blocks
+        {
+            std::lock_guard<std::mutex> lock(mLoadMutex);
+            mResidentBlocks = block + 1;
+        }
+        mBlockResident.notify_all();
     }
-    else
+    mProgress.Stop();
+    {
+        std::lock_guard<std::mutex> lock(slotMutex);
+        stop = true;
+    }
+    slotChanged.notify_all();
+    for (auto& i : workers)
+        i.wait();
+    Profiler::Add(Profiler::Counter::DictionaryProbes, mDictionary.size());
+
+    if (!corrupted && table.filter != nullptr)
+        mFilter.Assign(table.filter, static_cast<size_t>(table.filterSize));
+
+    return !corrupted && !mCancelLoad;
+}
+
+bool RainbowTable::OpenTable(const std::string& filename)
+{
+    std::cout << "Loading table from file \"" << filename << "\"\n";
+    std::ifstream file(filename, std::ifstream::binary);
+    mStartTime = GetTime();
+    if (!file)
     {
         std::cout << "Unable to open file \"" << filename << "\"!\n";
         return false;
     }
+
+    mDictionary.clear();
+    mFilter.Clear();
+    mNodeFilters.clear();
+    mMappedTable.reset();
+
+    // recognize file type and load appropriate
+    char magic[5];
+    file.read(magic, 4);
+    magic[4] = 0;
+    file.close(); // we will reopen the file in specific loaders, when we determine the type
+
+    if (RAINBOW_MAGIC_TEXT_FILE.compare(0, 4, magic) == 0)
+    {
+        if (!LoadText(filename))
+            return false;
+    }
+    else if (RAINBOW_MAGIC_BINARY_FILE.compare(0, 4, magic) == 0)
+    {
+        // only the header is read here, rows are loaded by LoadBinary
+        std::unique_ptr<BinaryTableFile> table(new BinaryTableFile());
+        if (!table->Open(filename))
+            return false;
+
+        mHashType = static_cast<OSSLHasher::HashType>(table->hashID);
+        mHashLen = table->hashLength;
+        mVerticalSize = table->verticalSize;
+        mChainSteps = table->chainSteps;
+        mPasswordLength = table->passwordLength;
+        mMappedTable = std::move(table);
+    }
+    else
+    {
+        std::cout << "Provided file is not a proper R41N30W table file." << std::endl;
+        std::cout << "Generate one to be used with --generate option (see help for details)." << std::endl;
+        return false;
+    }
+
+    mHashFunc = OSSLHasher::GetHashFunc(mHashType, mPasswordLength);
+    mBatchHashFunc = OSSLHasher::GetBatchHashFunc(mHashType, mPasswordLength);
+    mResidentBlocks = 0;
+    mLoadState = LoadState::LOADING;
+    return true;
 }
 
-void RainbowTable::SaveText(const std::string& filename)
+bool RainbowTable::CompleteLoad(bool background)
 {
-    std::ofstream file(filename);
+    // a background loader must not write to the console the main thread prompts on
+    std::ostringstream report;
+    std::ostream& log = background ? report : std::cout;
+
+    bool loaded = !mMappedTable || LoadBinary(log, background);
+
+    if (loaded && mVerticalSize != mDictionary.size())
+    {
+        log << "\nIncomplete table provided:" << std::endl;
+        log << "  Table has " << mDictionary.size() << " rows" << std::endl;
+        log << "  Should have " << mVerticalSize << " rows" << std::endl;
+        loaded = false;
+    }
+    else if (loaded && !mDictionary.empty() && mPasswordLength != mDictionary.begin()->second.size())
+    {
+        log << "\nMalformed table provided - password lengths (declared vs actual) do not match." << std::endl;
+        loaded = false;
+    }
+
+    if (loaded)
+    {
+        // tables saved without the filter get it built here
+        if (mFilter.Empty())
+            BuildFilter();
+        ReplicateFilter();
+    }
+    else
+    {
+        mDictionary.clear();
+        mFilter.Clear();
+    }
+
+    if (loaded)
+    {
+        log << "\nTable loaded:" << std::endl;
+        LogTableInfo(log);
+    }
+
+    // lookups started from now on use the dictionary
+    {
+        std::lock_guard<std::mutex> lock(mLoadMutex);
+        mLoadReport = report.str();
+        mLoadState = loaded ? LoadState::READY : LoadState::FAILED;
+    }
+    mBlockResident.notify_all();
+    return loaded;
+}
+
+bool RainbowTable::Load(const std::string& filename)
+{
+    Profiler::ScopedTimer timer("load");
+    StopLoader();
+    std::lock_guard<std::mutex> lock(mDictionaryMutex);
+
+    if (!OpenTable(filename))
+    {
+        mLoadState = LoadState::FAILED;
+        return false;
+    }
+
+    const bool loaded = CompleteLoad(false);
+    mMappedTable.reset();
+    return loaded;
+}
+
+bool RainbowTable::LoadAsync(const std::string& filename)
+{
+    StopLoader();
+    std::unique_lock<std::mutex> lock(mDictionaryMutex);
+
+    if (!OpenTable(filename))
+    {
+        mLoadState = LoadState::FAILED;
+        return false;
+    }
+    if (!mMappedTable)
+        return CompleteLoad(false);
+
+    lock.unlock();
+    mLoader = std::thread([this]()
+    {
+        Profiler::ScopedTimer timer("load");
+        std::lock_guard<std::mutex> lock(mDictionaryMutex);
+        CompleteLoad(true);
+    });
+    return true;
+}
+
+double RainbowTable::GetLoadProgress() const
+{
+    if (mLoadState != LoadState::LOADING)
+        return mLoadState == LoadState::READY ? 1.0 : 0.0;
+
+    const uint64_t blocks = mMappedTable ? mMappedTable->BlockCount() : 0;
+    return blocks ? static_cast<double>(mResidentBlocks) / static_cast<double>(blocks) : 0.0;
+}
+
+bool RainbowTable::WaitForLoad()
+{
+    std::unique_lock<std::mutex> lock(mLoadMutex);
+    mBlockResident.wait(lock, [this]() { return mLoadState != LoadState::LOADING; });
+    return mLoadState == LoadState::READY;
+}
+
+std::string RainbowTable::GetLoadReport()
+{
+    std::lock_guard<std::mutex> lock(mLoadMutex);
+    return mLoadReport;
+}
+
+void RainbowTable::StopLoader()
+{
+    if (!mLoader.joinable())
+        return;
+
+    mCancelLoad = true;
+    mLoader.join();
+    mCancelLoad = false;
+}
+
+bool RainbowTable::FindResident(const unsigned char* endpoint, std::string& startPlain)
+{
+    // rows are sorted by endpoint - first one not below it
+    const BinaryTableFile& table = *mMappedTable;
+    uint64_t low = 0, high = table.verticalSize;
+    while (low < high)
+    {
+        const uint64_t middle = low + (high - low) / 2;
+        if (std::memcmp(table.rows + middle * table.rowSize, endpoint, mHashLen) < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    if (low == table.verticalSize)
+        return false;
+
+    // rows of tables with checksums are trusted only once the loader verified their block
+    if (table.checksums != nullptr)
+    {
+        const uint64_t block = low / table.blockRows;
+        Profiler::ScopedTimer timer("lookup/wait");
+        std::unique_lock<std::mutex> lock(mLoadMutex);
+        mBlockResident.wait(lock, [&]() { return mResidentBlocks > block || mLoadState != LoadState::LOADING; });
+        if (mLoadState == LoadState::FAILED)
+            return false;
+    }
+
+    const unsigned char* row = table.rows + low * table.rowSize;
+    if (std::memcmp(row, endpoint, mHashLen) != 0)
+        return false;
+
+    startPlain.assign(reinterpret_cast<const char*>(row) + mHashLen, mPasswordLength);
+    return true;
+}
+
+bool RainbowTable::SaveText(const std::string& filename)
+{
+    std::ofstream file(filename, std::ofstream::binary);
 
     if (file)
     {
         std::lock_guard<std::mutex> lock(mDictionaryMutex);
 
         file.write(RAINBOW_MAGIC_TEXT_FILE.c_str(), 4); // to avoid writing the trailing zero from std string
-        file << std::endl;
-        file << OSSLHasher::GetHashFuncName(mHashType) << std::endl;
-        file << mVerticalSize << std::endl;
-        file << mChainSteps << std::endl;
-        file << mPasswordLength << std::endl;
+        file << '\n';
+        file << OSSLHasher::GetHashFuncName(mHashType) << '\n';
+        file << mVerticalSize << '\n';
+        file << mChainSteps << '\n';
+        file << mPasswordLength << '\n';
 
-        unsigned int counter = 0;
-        for (const auto &row : mDictionary)
+        auto formatRows = [](Dictionary::const_iterator begin, Dictionary::const_iterator end, std::vector<char>& buffer)
         {
-            LogProgress(counter, 10000, static_cast<unsigned int>(mVerticalSize));
-            HashToStream(file, row.first) << std::endl << row.second << std::endl;
-            counter++;
-        }
+            buffer.clear();
+            for (auto row = begin; row != end; ++row)
+            {
+                size_t position = buffer.size();
+                buffer.resize(position + row->first.size() * 2 + row->second.size() + 2);
+                char* out = HashToHex(row->first.data(), row->first.size(), &buffer[position]);
+                *out++ = '\n';
+                out = std::copy(row->second.begin(), row->second.end(), out);
+                *out = '\n';
+            }
+        };
+
+        mProgress.Start("save", mDictionary.size());
+        WriteRows(file, mDictionary, TEXT_CHUNK_ROWS, mThreadCount, formatRows, mProgress, nullptr);
+        mProgress.Stop();
 
         file.close();
     }
+
+    if (!file)
+        std::cout << "Unable to write file \"" << filename << "\"!\n";
+    return static_cast<bool>(file);
 }
 
-void RainbowTable::SaveBinary(const std::string& filename)
+bool RainbowTable::SaveBinary(const std::string& filename)
 {
     std::ofstream file(filename, std::ofstream::binary);
 
@@ -551,102 +1656,452 @@ void RainbowTable::SaveBinary(const std::string& filename)
     {
         std::lock_guard<std::mutex> lock(mDictionaryMutex);
 
-        /**
-         * Binary file structure is similar to text structure:
-         * Header:
-         *   -> MAGIC (4 bytes)
-         *   -> hash function ID (4 bytes)
-         *   -> vertical size (8 bytes)
-         *   -> horizontal size aka. chain steps (4 bytes)
-         *   -> password length (4 bytes)
-         * Data, for all vertical sizes:
-         *   -> hash (size depends on hash function)
-         *   -> password string (length depends on pwd length)
-         */
-        uint32_t hashID = static_cast<uint32_t>(mHashType);
-
-        file.write(RAINBOW_MAGIC_BINARY_FILE.c_str(), RAINBOW_MAGIC_BINARY_FILE.length()); // magic
-        file.write(reinterpret_cast<const char*>(&hashID), sizeof(hashID)); // hash
-        file.write(reinterpret_cast<const char*>(&mVerticalSize), sizeof(mVerticalSize)); // vert size
-        file.write(reinterpret_cast<const char*>(&mChainSteps), sizeof(mChainSteps)); // horizontal size
-        file.write(reinterpret_cast<const char*>(&mPasswordLength), sizeof(mPasswordLength)); // horizontal size
-
-        size_t hashSize = OSSLHasher::GetHashSize(mHashType);
-        for (const auto& row: mDictionary)
-        {
-            file.write(reinterpret_cast<const char*>(row.first.data()), hashSize);
-            file.write(reinterpret_cast<const char*>(row.second.data()), mPasswordLength);
+        WriteBinaryHeader(file);
+
+        const size_t hashSize = OSSLHasher::GetHashSize(mHashType);
+        const size_t rowSize = hashSize + mPasswordLength;
+        auto formatRows = [hashSize, rowSize](Dictionary::const_iterator begin, Dictionary::const_iterator end, std::vector<char>& buffer)
+        {
+            buffer.resize(static_cast<size_t>(std::distance(begin, end)) * rowSize);
+            char* out = buffer.data();
+            for (auto row = begin; row != end; ++row, out += rowSize)
+            {
+                std::memcpy(out, row->first.data(), hashSize);
+                std::memcpy(out + hashSize, row->second.data(), rowSize - hashSize);
+            }
+        };
+
+        const uint32_t blockRows = static_cast<uint32_t>(std::max<uint64_t>(1, BINARY_BLOCK_SIZE / rowSize));
+        std::vector<uint32_t> checksums;
+        mProgress.Start("save", mDictionary.size());
+        WriteRows(file, mDictionary, blockRows, mThreadCount, formatRows, mProgress, mChecksumMode ? &checksums : nullptr);
+        mProgress.Stop();
+
+        if (mChecksumMode)
+            WriteChecksumSection(file, blockRows, checksums);
+        if (mBloomMode)
+        {
+            if (mFilter.Empty())
+                BuildFilter();
+            WriteBloomSection(file, mFilter);
         }
 
         file.close();
     }
+
+    if (!file)
+        std::cout << "Unable to write file \"" << filename << "\"!\n";
+    return static_cast<bool>(file);
+}
+
+void RainbowTable::WriteBinaryHeader(std::ostream& file)
+{
+    // see LoadBinary for the file structure
+    uint32_t hashID = static_cast<uint32_t>(mHashType);
+
+    file.write(RAINBOW_MAGIC_BINARY_FILE.c_str(), RAINBOW_MAGIC_BINARY_FILE.length()); // magic
+    file.write(reinterpret_cast<const char*>(&hashID), sizeof(hashID)); // hash
+    file.write(reinterpret_cast<const char*>(&mVerticalSize), sizeof(mVerticalSize)); // vert size
+    file.write(reinterpret_cast<const char*>(&mChainSteps), sizeof(mChainSteps)); // horizontal size
+    file.write(reinterpret_cast<const char*>(&mPasswordLength), sizeof(mPasswordLength)); // horizontal size
 }
 
-void RainbowTable::Save(const std::string& filename)
+void RainbowTable::WriteChecksumSection(std::ostream& file, uint32_t blockRows, const std::vector<uint32_t>& checksums)
 {
-    if (GetSize() <= 0)
+    const uint64_t payloadSize = 4 + 4 * checksums.size();
+    file.write(RAINBOW_SECTION_CHECKSUMS.c_str(), RAINBOW_SECTION_CHECKSUMS.length());
+    file.write(reinterpret_cast<const char*>(&payloadSize), sizeof(payloadSize));
+    file.write(reinterpret_cast<const char*>(&blockRows), sizeof(blockRows));
+    file.write(reinterpret_cast<const char*>(checksums.data()), static_cast<std::streamsize>(4 * checksums.size()));
+}
+
+void RainbowTable::WriteBloomSection(std::ostream& file, const BloomFilter& filter)
+{
+    const uint64_t payloadSize = filter.ByteSize();
+    file.write(RAINBOW_SECTION_BLOOM.c_str(), RAINBOW_SECTION_BLOOM.length());
+    file.write(reinterpret_cast<const char*>(&payloadSize), sizeof(payloadSize));
+    file.write(reinterpret_cast<const char*>(filter.Data()), static_cast<std::streamsize>(payloadSize));
+}
+
+void RainbowTable::BuildFilter()
+{
+    Profiler::ScopedTimer timer("load/filter");
+    mFilter.Init(mDictionary.size());
+    for (const auto& row : mDictionary)
+        mFilter.Add(row.first.data());
+}
+
+void RainbowTable::ReplicateFilter()
+{
+    mNodeFilters.clear();
+    const Topology::Info& topology = Topology::Get();
+    if (Topology::GetPolicy() == Topology::Policy::NONE || topology.nodes < 2)
         return;
+
+    // copies are made by threads running on their node - memory is placed where it is first touched
+    unsigned int lastNode = 0;
+    for (const auto& cpu : topology.cpus)
+        lastNode = std::max(lastNode, cpu.node);
+    mNodeFilters.resize(lastNode + 1);
+
+    std::vector<std::future<void>> results;
+    for (unsigned int node = 0; node <= lastNode; ++node)
+    {
+        results.push_back(std::async(std::launch::async, [this, node]()
+        {
+            Topology::ScopedPin pin(Topology::NodeCpus(node));
+            mNodeFilters[node] = mFilter;
+        }));
+    }
+    for (auto& i : results)
+        i.wait();
+}
+
+const BloomFilter& RainbowTable::LocalFilter() const
+{
+    if (mNodeFilters.empty())
+        return mFilter;
+
+    const unsigned int node = Topology::CurrentNode();
+    return node < mNodeFilters.size() ? mNodeFilters[node] : mFilter;
+}
+
+bool RainbowTable::SaveStaged(const std::string& filename, std::vector<RowRange> runs)
+{
+    Profiler::ScopedTimer timer("save/merge");
+    std::unique_ptr<RunWriter> runWriter(std::move(mRunWriter));
+
+    MappedFile staging;
+    if (!staging.Open(runWriter->GetFilename()))
+    {
+        std::cout << "Unable to open file \"" << runWriter->GetFilename() << "\"!\n";
+        return false;
+    }
+
+    const unsigned char* position = staging.Data();
+    for (uint64_t runSize : runWriter->GetRunSizes())
+    {
+        runs.push_back({ position, position + runSize });
+        position += runSize;
+    }
+
+    uint64_t collisions = 0;
+    const bool written = WriteMerged(runs, filename, collisions);
+    staging.Close();
+    std::remove(runWriter->GetFilename().c_str());
+
+    std::cout << collisions << " chains discarded due to collisions between runs.\n";
+    return written;
+}
+
+bool RainbowTable::WriteMerged(const std::vector<RowRange>& runs, const std::string& filename, uint64_t& collisions)
+{
+    std::ofstream file(filename, std::ofstream::binary);
+    if (!file)
+    {
+        std::cout << "Unable to open file \"" << filename << "\"!\n";
+        return false;
+    }
+
+    // vertical size in the header is patched once the merge knows it
+    WriteBinaryHeader(file);
+
+    const uint32_t rowSize = mHashLen + mPasswordLength;
+    const uint32_t blockRows = static_cast<uint32_t>(std::max<uint64_t>(1, BINARY_BLOCK_SIZE / rowSize));
+    std::vector<uint32_t> checksums;
+    RowBlock block;
+    block.reserve(static_cast<size_t>(blockRows) * rowSize);
+    uint64_t rows = 0;
+
+    // slices of the key space are merged on all threads, this thread writes them in order and
+    // regroups them into checksum blocks
+    const std::vector<std::vector<RowRange>> slices = SplitRuns(runs, mHashLen, rowSize, MERGE_SLICE_ROWS);
+    std::vector<RowBlock> merged(mThreadCount);
+    std::vector<uint64_t> dropped(mThreadCount);
+    collisions = 0;
+
+    uint64_t totalRows = 0;
+    for (const auto& run : runs)
+        totalRows += static_cast<uint64_t>(run.end - run.begin) / rowSize;
+
+    // sized for the rows before collisions are dropped - slightly sparser than a loaded table builds
+    BloomFilter filter;
+    if (mBloomMode)
+        filter.Init(totalRows);
+    mProgress.Start("merge", totalRows);
+    for (size_t round = 0; round < slices.size(); round += mThreadCount)
+    {
+        const size_t roundSlices = std::min<size_t>(mThreadCount, slices.size() - round);
+        std::vector<std::future<void>> results;
+        for (size_t t = 0; t < roundSlices; ++t)
+        {
+            results.push_back(std::async(std::launch::async, [&, t]()
+            {
+                RowBlock& out = merged[t];
+                out.clear();
+                dropped[t] = MergeRuns(slices[round + t], mHashLen, rowSize, [&](const unsigned char* row)
+                {
+                    out.insert(out.end(), row, row + rowSize);
+                });
+            }));
+        }
+
+        for (size_t t = 0; t < roundSlices; ++t)
+        {
+            results[t].wait();
+            collisions += dropped[t];
+            mProgress.AddDone(merged[t].size() / rowSize + dropped[t]);
+            for (size_t offset = 0; mBloomMode && offset < merged[t].size(); offset += rowSize)
+                filter.Add(merged[t].data() + offset);
+
+            for (size_t offset = 0; offset < merged[t].size();)
+            {
+                const size_t length = std::min(block.capacity() - block.size(), merged[t].size() - offset);
+                block.insert(block.end(), merged[t].begin() + offset, merged[t].begin() + offset + length);
+                offset += length;
+                if (block.size() == block.capacity())
+                {
+                    if (mChecksumMode)
+                        checksums.push_back(Crc32(block.data(), block.size()));
+                    file.write(reinterpret_cast<const char*>(block.data()), static_cast<std::streamsize>(block.size()));
+                    rows += blockRows;
+                    block.clear();
+                }
+            }
+        }
+    }
+    if (!block.empty())
+    {
+        if (mChecksumMode)
+            checksums.push_back(Crc32(block.data(), block.size()));
+        file.write(reinterpret_cast<const char*>(block.data()), static_cast<std::streamsize>(block.size()));
+        rows += block.size() / rowSize;
+    }
+    mProgress.Stop();
+
+    if (mChecksumMode)
+        WriteChecksumSection(file, blockRows, checksums);
+    if (mBloomMode)
+        WriteBloomSection(file, filter);
+    mVerticalSize = rows;
+    file.seekp(8);
+    file.write(reinterpret_cast<const char*>(&mVerticalSize), sizeof(mVerticalSize));
+    file.close();
+
+    if (!file)
+    {
+        std::cout << "Writing to \"" << filename << "\" failed!\n";
+        return false;
+    }
+    return true;
+}
+
+bool RainbowTable::Merge(const std::vector<std::string>& inputs, const std::string& output)
+{
+    Profiler::ScopedTimer timer("merge");
+    std::vector<std::unique_ptr<BinaryTableFile>> tables;
+    for (const auto& input : inputs)
+    {
+        std::cout << "Merging table \"" << input << "\"\n";
+        tables.emplace_back(new BinaryTableFile());
+        if (!tables.back()->Open(input))
+            return false;
+
+        const BinaryTableFile& first = *tables.front();
+        const BinaryTableFile& table = *tables.back();
+        if (table.hashID != first.hashID || table.chainSteps != first.chainSteps || table.passwordLength != first.passwordLength)
+        {
+            std::cout << "Table \"" << input << "\" does not match \"" << inputs.front() << "\" - hash function, chain steps "
+                      << "and password length have to be the same." << std::endl;
+            return false;
+        }
+    }
+    if (tables.empty())
+    {
+        std::cout << "No tables to merge." << std::endl;
+        return false;
+    }
+
+    mHashType = static_cast<OSSLHasher::HashType>(tables.front()->hashID);
+    mHashLen = tables.front()->hashLength;
+    mChainSteps = tables.front()->chainSteps;
+    mPasswordLength = tables.front()->passwordLength;
+
+    std::vector<const BinaryTableFile*> views;
+    for (const auto& table : tables)
+        views.push_back(table.get());
+    if (!VerifyTables(views, inputs, mThreadCount))
+        return false;
+
+    std::vector<RowRange> runs;
+    uint64_t inputRows = 0;
+    for (const auto& table : tables)
+    {
+        runs.push_back({ table->rows, table->rows + table->verticalSize * table->rowSize });
+        inputRows += table->verticalSize;
+    }
+
+    uint64_t collisions = 0;
+    if (!WriteMerged(runs, output, collisions))
+        return false;
+
+    std::cout << "Merged " << inputRows << " rows of " << tables.size() << " tables, " << collisions
+              << " rows dropped due to duplicate endpoints.\n";
+    std::cout << "Saved table to file \"" << output << "\":" << std::endl;
+    LogTableInfo(std::cout);
+    return true;
+}
+
+bool RainbowTable::Extend(const std::string& filename)
+{
+    Profiler::ScopedTimer timer("extend");
+    std::cout << "Extending table \"" << filename << "\"\n";
+
+    BinaryTableFile table;
+    if (!table.Open(filename))
+        return false;
+
+    const bool fromFile = (mPasswordFile.Data() != nullptr);
+    if (fromFile && mPasswordLength != table.passwordLength)
+    {
+        std::cout << "Password list has passwords of length " << mPasswordLength << ", the table " << table.passwordLength << "." << std::endl;
+        return false;
+    }
+    if (!VerifyTables({ &table }, { filename }, mThreadCount))
+        return false;
+
+    mHashType = static_cast<OSSLHasher::HashType>(table.hashID);
+    mHashLen = table.hashLength;
+    mChainSteps = table.chainSteps;
+    mPasswordLength = table.passwordLength;
+    mHashFunc = OSSLHasher::GetHashFunc(mHashType, mPasswordLength);
+    mBatchHashFunc = OSSLHasher::GetBatchHashFunc(mHashType, mPasswordLength);
+    mChecksumMode = mChecksumMode || table.checksums != nullptr;
+    mBloomMode = mBloomMode || table.filter != nullptr;
+
+    // New chains are staged in sorted runs, the table is never loaded. A new chain from an existing
+    // start point reaches an existing endpoint, so the merge - where existing rows come first and
+    // win every collision - drops it together with all other colliding chains.
+    mStagingFile = filename + ".runs";
+    if (!CreateTable())
+        return false;
+
+    const std::string extended = filename + ".extended";
+    if (!SaveStaged(extended, { { table.rows, table.rows + table.verticalSize * table.rowSize } }))
+    {
+        std::remove(extended.c_str());
+        return false;
+    }
+
+    const uint64_t previousRows = table.verticalSize;
+    table.file.Close();
+    if (!MoveFileReplacing(extended, filename))
+    {
+        std::cout << "Unable to replace \"" << filename << "\" - extended table is left in \"" << extended << "\"!\n";
+        return false;
+    }
+
+    std::cout << "Table extended by " << mVerticalSize - previousRows << " rows:" << std::endl;
+    LogTableInfo(std::cout);
+    return true;
+}
+
+bool RainbowTable::Save(const std::string& filename)
+{
+    if (GetSize() <= 0 && !mRunWriter)
+    {
+        std::cout << "Table is empty, nothing to save." << std::endl;
+        return false;
+    }
     std::cout << "Saving table to file \"" << filename << "\"\n";
+    Profiler::ScopedTimer timer("save");
 
-    if (mTextMode)
-        SaveText(filename);
+    bool saved = false;
+    if (mRunWriter)
+        saved = SaveStaged(filename);
+    else if (mTextMode)
+        saved = SaveText(filename);
     else
-        SaveBinary(filename);
+        saved = SaveBinary(filename);
+    if (!saved)
+        return false;
 
     std::cout << "Saved table:" << std::endl;
-    LogTableInfo();
+    LogTableInfo(std::cout);
+    return true;
 }
 
-std::string RainbowTable::FindPassword(const std::string& hashedPassword)
+bool RainbowTable::ParseHash(const std::string& hashedPassword, ucharVector& hashValue) const
 {
-    if (mDictionary.size() <= 0)
-        return "";
-
     // hash in string form takes two chars for each byte
     if (hashedPassword.size() != (mHashLen * 2))
     {
         std::cout << "Hash length mismatch! Hashed passwords in the table are " << mHashLen*2 << " chars long (" << mHashLen << " bytes)" << std::endl;
         std::cout << "and provided hash is " << hashedPassword.size() << " chars long (" << hashedPassword.size() / 2 << " bytes)" << std::endl;
-        return "";
+        return false;
     }
 
-    ucharVector hashValue;
+    hashValue.clear();
     hashValue.reserve(mHashLen);
-    StrToHash(hashedPassword, hashValue);
-
-    ucharVector plainValue;
-    plainValue.reserve(mPasswordLength);
-
-    if (mDictionary.count(hashValue) > 0)
+    if (!StrToHash(hashedPassword, hashValue))
     {
-        // then the right chain is found
-        // the position of the password is in that chain, step i
-        return FindPasswordInChain(hashValue, hashValue);
+        std::cout << "Hash \"" << hashedPassword << "\" is not in hex form!" << std::endl;
+        return false;
     }
-    else
-    {
-        std::vector<std::future<std::string>> asyncFindPassResults;
-        asyncFindPassResults.reserve(mThreadCount);
-        for (unsigned int i = 0; i < mThreadCount; ++i)
-        {
-            asyncFindPassResults.push_back(std::async(std::launch::async, &RainbowTable::FindPasswordInChainParallel, this, hashValue, mChainSteps - 1 - i));
-        }
+    return true;
+}
 
-        std::string foundPassword;
-        for (auto& i : asyncFindPassResults)
+std::string RainbowTable::FindPassword(const std::string& hashedPassword)
+{
+    if (mLoadState != LoadState::LOADING && mDictionary.empty())
+        return "";
+
+    ucharVector hashValue;
+    if (!ParseHash(hashedPassword, hashValue))
+        return "";
+
+    LookupStats stats;
+    return FindPassword(hashValue, mThreadCount, stats);
+}
+
+std::string RainbowTable::FindPassword(const ucharVector& hashValue, uint32_t threadCount, LookupStats& stats)
+{
+    if ((mLoadState != LoadState::LOADING && mDictionary.empty()) || hashValue.size() != mHashLen)
+        return "";
+
+    Profiler::ScopedTimer timer("lookup");
+    // chain positions are split between threads - position mChainSteps is the endpoint itself
+    if (threadCount <= 1)
+        return FindPasswordInChainParallel(hashValue, mChainSteps, 1, stats);
+
+    std::vector<LookupStats> threadStats(threadCount);
+    std::vector<std::future<std::string>> asyncFindPassResults;
+    asyncFindPassResults.reserve(threadCount);
+    for (unsigned int i = 0; i < threadCount; ++i)
+    {
+        asyncFindPassResults.push_back(std::async(std::launch::async, [&, i]()
         {
-            std::string result = i.get();
-            if (!result.empty())
-                foundPassword = result;
-        }
+            Topology::ScopedPin pin(i);
+            return FindPasswordInChainParallel(hashValue, mChainSteps - i, threadCount, threadStats[i]);
+        }));
+    }
 
-        return foundPassword;
+    std::string foundPassword;
+    for (unsigned int i = 0; i < threadCount; ++i)
+    {
+        std::string result = asyncFindPassResults[i].get();
+        if (!result.empty())
+            foundPassword = result;
+        stats += threadStats[i];
     }
+
+    return foundPassword;
 }
 
-std::string RainbowTable::FindPasswordInChain(const ucharVector& destinationHash, const ucharVector& tableHashKey)
+std::string RainbowTable::FindPasswordInChain(const ucharVector& destinationHash, const std::string& startPlain, LookupStats& stats,
+                                              LookupHit* hit)
 {
-    std::string startPlain = mDictionary[tableHashKey];
+    Profiler::ScopedTimer timer("lookup/verify");
 
     ucharVector hashValue;
     hashValue.resize(mHashLen);
@@ -658,9 +2113,17 @@ std::string RainbowTable::FindPasswordInChain(const ucharVector& destinationHash
     for (uint32_t i = 0; i <= mChainSteps; ++i)
     {
         mHashFunc(plainValue, hashValue);
+        stats.hashOps++;
 
         if (hashValue == destinationHash)
         {
+            Profiler::Add(Profiler::Counter::HashCalls, i + 1);
+            Profiler::Add(Profiler::Counter::Reductions, i);
+            if (hit != nullptr)
+            {
+                hit->startPassword = startPlain;
+                hit->position = i;
+            }
             // found password = prehashvalue
             std::string password;
             password.reserve(plainValue.size());
@@ -675,37 +2138,90 @@ std::string RainbowTable::FindPasswordInChain(const ucharVector& destinationHash
             mReductionFunc(i, mPasswordLength, hashValue, plainValue);
         }
     }
+
+    // endpoint matched, but the chain does not contain our hash
+    stats.falseAlarms++;
+    Profiler::Add(Profiler::Counter::HashCalls, mChainSteps + 1);
+    Profiler::Add(Profiler::Counter::Reductions, mChainSteps + 1);
+    Profiler::Add(Profiler::Counter::FalseAlarms, 1);
     return "";
 }
 
-std::string RainbowTable::FindPasswordInChainParallel(const ucharVector& destinationHash, int startIndex)
+std::string RainbowTable::FindPasswordInChainParallel(const ucharVector& destinationHash, int startIndex, int step, LookupStats& stats,
+                                                      int lastIndex, uint64_t deadline, LookupHit* hit)
 {
-    ucharVector hashValue;
-    hashValue.reserve(mHashLen);
+    // tails for successive positions are walked together - shortest first, as each lane that
+    // finishes is replaced by the next position
+    Profiler::ScopedTimer timer("lookup/chains");
+    ChainBatch batch(CHAIN_BATCH_SIZE, mPasswordLength, mHashLen, mBatchHashFunc, mBatchReductionFunc);
+    ucharVector hashValue(mHashLen);
+    std::string startPlain;
+    std::string result;
 
-    ucharVector plainValue;
-    plainValue.reserve(mPasswordLength);
+    // a lookup started during a background load searches the mapped table until it ends, the
+    // dictionary and filter are being built meanwhile
+    const bool resident = (mLoadState == LoadState::LOADING);
+    const BloomFilter* filter = resident ? nullptr : &LocalFilter();
 
-    for (int i = startIndex; i >= 0; i -= mThreadCount)
+    auto checkEndpoint = [&](uint64_t position, const unsigned char* endpoint)
     {
-        hashValue.assign(destinationHash.begin(), destinationHash.end());
-        for (uint32_t y = i; y < mChainSteps; y++)
+        stats.hashOps += mChainSteps - position;
+        stats.positions++;
+        // most endpoints are not in the table - the filter rules them out with a single cache line read
+        if (filter != nullptr && !filter->MayContain(endpoint))
         {
-            mReductionFunc(y, mPasswordLength, hashValue, plainValue);
-            mHashFunc(plainValue, hashValue);
+            Profiler::Add(Profiler::Counter::FilterRejects, 1);
+            return false;
         }
-
-        if (mDictionary.count(hashValue) > 0)
+        Profiler::Add(Profiler::Counter::DictionaryProbes, 1);
+        if (resident)
+        {
+            if (!FindResident(endpoint, startPlain))
+                return false;
+        }
+        else
         {
-            std::string result = FindPasswordInChain(destinationHash, hashValue);
-            if (!result.empty())
-                return result;
+            hashValue.assign(endpoint, endpoint + mHashLen);
+            const auto row = mDictionary.find(hashValue);
+            if (row == mDictionary.end())
+                return false;
+            startPlain = row->second;
         }
+
+        result = FindPasswordInChain(destinationHash, startPlain, stats, hit);
+        return !result.empty();
+    };
+
+    int next = startIndex;
+    for (uint32_t steps = 1; ; ++steps)
+    {
+        for (; next >= lastIndex && !batch.Full(); next -= step)
+            batch.Add(destinationHash.data(), static_cast<uint32_t>(next), mChainSteps, static_cast<uint64_t>(next));
+
+        if (batch.Collect(checkEndpoint))
+            return result;
+        if (batch.Size() == 0 && next < lastIndex)
+            break;
+        // lanes still walking are dropped - stats.positions tells how far the lookup got
+        if (deadline != 0 && steps % DEADLINE_CHECK_STEPS == 0 && GetTime() >= deadline)
+            break;
+
+        batch.Step();
     }
 
     return "";
 }
 
+std::string RainbowTable::FindPasswordInPositions(const ucharVector& hashValue, uint32_t first, uint32_t last, uint64_t deadline, LookupStats& stats,
+                                                  LookupHit* hit)
+{
+    if ((mLoadState != LoadState::LOADING && mDictionary.empty()) || hashValue.size() != mHashLen || first < last)
+        return "";
+
+    Profiler::ScopedTimer timer("lookup");
+    return FindPasswordInChainParallel(hashValue, static_cast<int>(std::min(first, mChainSteps)), 1, stats, static_cast<int>(last), deadline, hit);
+}
+
 auto Rand()
 {
     static std::random_device rd;
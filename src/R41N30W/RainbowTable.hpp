@@ -6,67 +6,256 @@
 #include <vector>
 #include <memory>
 #include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
 #include "Utils.hpp"
 #include "OSSLHasher.hpp"
 #include "Reduction.hpp"
+#include "Progress.hpp"
+#include "MappedFile.hpp"
+#include "SortedRuns.hpp"
+#include "BloomFilter.hpp"
 
 
+// work counters gathered during a single lookup
+struct LookupStats
+{
+    uint64_t hashOps;
+    uint64_t falseAlarms;
+    uint64_t positions; // chain positions whose endpoint was checked
+
+    LookupStats()
+        : hashOps(0)
+        , falseAlarms(0)
+        , positions(0)
+    {
+    }
+
+    LookupStats& operator+=(const LookupStats& other)
+    {
+        hashOps += other.hashOps;
+        falseAlarms += other.falseAlarms;
+        positions += other.positions;
+        return *this;
+    }
+};
+
+struct BinaryTableFile;
+
+// what regenerating a sample of chains found, see RainbowTable::Analyze
+struct TableAnalysis
+{
+    uint64_t rows; // of the table
+    uint64_t chains; // sampled
+    uint64_t points; // chain points walked, chain steps + 1 per chain
+    uint64_t chainDistinct; // points not repeated within their own chain, summed over chains
+    double distinct; // distinct points of all sampled chains together, estimated
+    uint64_t repeatChains; // chains with a point repeated within them
+    uint64_t brokenChains; // chains not leading to their stored endpoint
+    double seconds;
+
+    TableAnalysis()
+        : rows(0)
+        , chains(0)
+        , points(0)
+        , chainDistinct(0)
+        , distinct(0.0)
+        , repeatChains(0)
+        , brokenChains(0)
+        , seconds(0.0)
+    {
+    }
+};
+
+// where a found password is in the table
+struct LookupHit
+{
+    std::string startPassword; // of the chain the password is on
+    uint32_t position; // step of the chain the password is hashed at
+
+    LookupHit()
+        : startPassword()
+        , position(0)
+    {
+    }
+};
+
 class RainbowTable
 {
 public:
+    enum class LoadState
+    {
+        EMPTY = 0, // nothing loaded - generated tables stay in this state
+        LOADING, // LoadAsync runs, lookups are served from the mapped file
+        READY,
+        FAILED,
+    };
+
     RainbowTable(size_t startSize, uint32_t passwordLength, int chainSteps, OSSLHasher::HashType hashType);
     ~RainbowTable();
 
     void SetThreadCount(uint32_t threadCount);
     void SetRetryCount(uint32_t retryCount);
     void SetTextMode(bool textMode);
+    // binary tables get CRC-32 of every block, verified on load - such tables need this version to load
+    void SetChecksumMode(bool checksumMode);
+    // Pipelined generation - workers hand locally sorted runs of rows to a writer thread, which
+    // appends them to filename. Save then merges the runs into the table (binary only). The
+    // table is never held in memory, collisions are dropped in the merge instead of retried.
+    void SetStagingFile(const std::string& filename);
+    // Generates only shard index of count - rows [V * index / count, V * (index + 1) / count) of a
+    // table of V rows, with start points derived from seed and row index, or every count-th chunk
+    // of the password list. Shards of the same seed are disjoint and can be merged into one table.
+    void SetShard(uint32_t index, uint32_t count, uint64_t seed);
+    // binary tables get the endpoint Bloom filter stored with them, so Load does not have to build it
+    void SetBloomMode(bool bloomMode);
 
     bool CreateTable();
-    void GeneratePasswords(unsigned int limit);
     int GetSize() { return static_cast<int>(mDictionary.size()); }
-    uint32_t RunTest(uint32_t iterations);
+    uint32_t GetChainSteps() const { return mChainSteps; }
+    uint32_t GetPasswordLength() const { return mPasswordLength; }
+    uint32_t GetHashLength() const { return mHashLen; }
+    OSSLHasher::HashType GetHashType() const { return mHashType; }
+    uint64_t GetVerticalSize() const { return mVerticalSize; }
+    // seed == 0 picks a random seed, reportFile (if not empty) receives results in JSON form
+    uint32_t RunTest(uint32_t iterations, uint32_t seed, const std::string& reportFile);
+
+    // Regenerates samples chains (all of them when 0 or more than the table has) on all threads,
+    // counting points repeated within chains exactly and distinct points across chains with a
+    // HyperLogLog counter. False when the table is empty.
+    bool Analyze(uint64_t samples, TableAnalysis& analysis);
+
+    // runs the chain kernel on random passwords on all threads, returns hash+reduce steps per second
+    double MeasureChainRate(double seconds);
 
     std::string FindPassword(const std::string& hashedPassword);
+    std::string FindPassword(const ucharVector& hashValue, uint32_t threadCount, LookupStats& stats);
+    // Checks chain positions from first down to last on the calling thread - cheapest (shortest
+    // tail) first. Stops when the password is found, or at deadline (GetTime() ticks, 0 for none);
+    // stats.positions tells how many positions were checked.
+    // Does not print anything, hit (when given) is filled in when the password is found.
+    std::string FindPasswordInPositions(const ucharVector& hashValue, uint32_t first, uint32_t last, uint64_t deadline, LookupStats& stats,
+                                        LookupHit* hit = nullptr);
+    // decodes a hash in hex form, prints what is wrong when it does not fit the table
+    bool ParseHash(const std::string& hashedPassword, ucharVector& hashValue) const;
 
-    void Save(const std::string& filename);
+    bool Save(const std::string& filename);
     bool Load(const std::string& filename);
+    // Starts loading a binary table on a background thread and returns once its header is read -
+    // table parameters are known and lookups work right away. Until the table is loaded they
+    // binary search the mapped rows, which the OS pages in on demand; rows of tables with
+    // checksums are used only once the loader verified their block. Text tables load synchronously.
+    bool LoadAsync(const std::string& filename);
+    LoadState GetLoadState() const { return mLoadState; }
+    // fraction of rows the loader went through, 1 once the table is ready
+    double GetLoadProgress() const;
+    // waits until a background load ends, returns whether the table is ready
+    bool WaitForLoad();
+    // what a background load reported (table info or what went wrong) - it keeps the console to the
+    // main thread, so the text is empty until the load ends
+    std::string GetLoadReport();
     void SavePasswords(const std::string& filename);
+    // merges binary tables of the same hash, chain steps and password length into output, keeping
+    // the first row of every endpoint (in order of inputs) - takes the thread count and checksum mode of this table
+    bool Merge(const std::vector<std::string>& inputs, const std::string& output);
+    // Adds chains to a binary table without loading it - GetVerticalSize() new random chains, or one
+    // per password of the list loaded by LoadPasswords. Chains colliding with existing rows are dropped.
+    bool Extend(const std::string& filename);
+    // maps the list and counts its lines - passwords are streamed from the file during generation
     void LoadPasswords(const std::string& filename);
 
 private:
-    void CreateRows(unsigned int limit, unsigned int thread);
-    void CreateRowsFromPass(unsigned int limit, unsigned int index);
-    bool RunChain(std::string password, unsigned int salt);
+    void CreateRows(unsigned int limit);
+    // claims chunks of the password file until all are walked
+    void CreateRowsFromFile();
+    // claims batches of row indices of the shard until all are walked
+    void CreateRowsSeeded();
+    // walks chains from given passwords and stores their endpoints, inserted tells which were not collisions
+    // with staged given, rows are appended to it instead of the table, full runs are handed to the writer
+    void RunChains(const std::vector<std::string>& passwords, std::vector<bool>& inserted, RowBlock* staged = nullptr);
+    // sorts the run and queues it for the writer, leaves run empty
+    void StageRun(RowBlock& run);
 
-    void LogTableInfo();
-    void LogProgress(unsigned int current, unsigned int step, unsigned int limit);
+    void LogTableInfo(std::ostream& log);
 
-    std::string FindPasswordInChain(const ucharVector& startingHashedPassword, const ucharVector& hashedPassword);
-    std::string FindPasswordInChainParallel(const ucharVector& startingHashedPassword, int startIndex);
+    std::string FindPasswordInChain(const ucharVector& destinationHash, const std::string& startPlain, LookupStats& stats,
+                                    LookupHit* hit = nullptr);
+    // positions startIndex, startIndex - step... down to lastIndex
+    std::string FindPasswordInChainParallel(const ucharVector& destinationHash, int startIndex, int step, LookupStats& stats,
+                                            int lastIndex = 0, uint64_t deadline = 0, LookupHit* hit = nullptr);
 
     std::string GetRandomPassword(size_t length);
 
+    // reads the table header (whole text tables) and makes the table usable for lookups
+    bool OpenTable(const std::string& filename);
+    // builds the dictionary of the opened table, checks it and publishes the result in mLoadState,
+    // a background load writes its messages to mLoadReport instead of the console
+    bool CompleteLoad(bool background);
     bool LoadText(const std::string& filename);
-    bool LoadBinary(const std::string& filename);
-    void SaveText(const std::string& filename);
-    void SaveBinary(const std::string& filename);
+    bool LoadBinary(std::ostream& log, bool background);
+    // cancels a background load and joins its thread
+    void StopLoader();
+    // binary search of the mapped table during a background load, waits for the block when it has to be verified
+    bool FindResident(const unsigned char* endpoint, std::string& startPlain);
+    bool SaveText(const std::string& filename);
+    bool SaveBinary(const std::string& filename);
+    // runs given are merged in front of the staged ones
+    bool SaveStaged(const std::string& filename, std::vector<RowRange> runs = std::vector<RowRange>());
+    // merges sorted runs into a binary table, dropping duplicate endpoints
+    bool WriteMerged(const std::vector<RowRange>& runs, const std::string& filename, uint64_t& collisions);
+    void WriteBinaryHeader(std::ostream& file);
+    void WriteChecksumSection(std::ostream& file, uint32_t blockRows, const std::vector<uint32_t>& checksums);
+    void WriteBloomSection(std::ostream& file, const BloomFilter& filter);
+    // builds mFilter from the dictionary
+    void BuildFilter();
+    // with threads pinned, every NUMA node gets a copy of mFilter allocated on it
+    void ReplicateFilter();
+    // replica of the node the calling thread runs on, mFilter when there are none
+    const BloomFilter& LocalFilter() const;
 
     Reduction::ReductionFunc mReductionFunc;
+    Reduction::BatchReductionFunc mBatchReductionFunc;
     OSSLHasher::HashFunc mHashFunc;
+    OSSLHasher::BatchHashFunc mBatchHashFunc;
     OSSLHasher::HashType mHashType;
     uint32_t mHashLen;
 
     std::map<ucharVector, std::string> mDictionary;
+    BloomFilter mFilter; // endpoints of mDictionary, probed before it during lookup
+    std::vector<BloomFilter> mNodeFilters; // copies of mFilter by NUMA node, see ReplicateFilter
     std::unordered_set<std::string> mOriginalPasswords;
+    MappedFile mPasswordFile;
+    std::atomic<uint64_t> mNextPasswordChunk; // number of chunks claimed so far
+    std::string mStagingFile;
+    std::unique_ptr<RunWriter> mRunWriter; // set while staged runs wait for Save
+    std::atomic<uint64_t> mStagedRows;
+    std::atomic<uint64_t> mStagedChains;
+    uint32_t mShardIndex;
+    uint32_t mShardCount; // 0 when not sharded
+    uint64_t mSeed;
+    std::atomic<uint64_t> mNextRow; // next row index to be claimed in seeded generation
+    uint64_t mShardEnd;
     uint32_t mThreadCount;
     bool mTextMode; // whether to save table to text
+    bool mChecksumMode; // whether to store block checksums in binary tables
+    bool mBloomMode; // whether to store the endpoint filter in binary tables
     uint32_t mRetryCount;
     uint64_t mVerticalSize;
     uint32_t mChainSteps;
     uint32_t mPasswordLength;
 
     std::mutex mDictionaryMutex;
+    std::unique_ptr<BinaryTableFile> mMappedTable; // kept while lookups may still search it
+    std::atomic<LoadState> mLoadState;
+    std::atomic<uint64_t> mResidentBlocks; // blocks of mMappedTable verified and inserted so far
+    std::atomic<bool> mCancelLoad;
+    std::mutex mLoadMutex;
+    std::string mLoadReport; // guarded by mLoadMutex
+    std::condition_variable mBlockResident;
+    std::thread mLoader;
     std::mutex mPasswordMutex;
+    Progress mProgress;
 
     uint64_t mStartTime;
     uint64_t mFreq;
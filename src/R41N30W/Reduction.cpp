@@ -1,6 +1,8 @@
 #include "Reduction.hpp"
 #include "Common.hpp"
 
+#include <vector>
+
 
 namespace Reduction {
 
@@ -37,4 +39,39 @@ void Salted(const unsigned int salt, const size_t resultLength, const ucharVecto
     }
 }
 
+void SaltedBatch(const uint32_t* salts, size_t resultLength, const unsigned char* hashes,
+                 size_t hashLength, unsigned char* plains, size_t count)
+{
+    if (hashLength == 0)
+        return;
+
+    // byte positions summed for each output char are the same for every hash in the batch (and every
+    // batch of the same table), so they are computed once per thread
+    const size_t TERMS = 5;
+    thread_local std::vector<size_t> positions;
+    thread_local size_t cachedResultLength = 0, cachedHashLength = 0;
+    if (cachedResultLength != resultLength || cachedHashLength != hashLength)
+    {
+        positions.resize(resultLength * TERMS);
+        for (size_t i = 0; i < resultLength; i++)
+            for (size_t t = 0; t < TERMS; t++)
+                positions[i * TERMS + t] = (i + t * resultLength) % hashLength;
+        cachedResultLength = resultLength;
+        cachedHashLength = hashLength;
+    }
+
+    for (size_t k = 0; k < count; k++)
+    {
+        const unsigned char* hashValue = hashes + k * hashLength;
+        unsigned char* plainValue = plains + k * resultLength;
+        for (size_t i = 0; i < resultLength; i++)
+        {
+            const size_t* p = &positions[i * TERMS];
+            unsigned int index = hashValue[p[0]] + hashValue[p[1]] + hashValue[p[2]]
+                                                 + hashValue[p[3]] + hashValue[p[4]] + salts[k];
+            plainValue[i] = Common::Charset[index % Common::CharsetLength];
+        }
+    }
+}
+
 }
@@ -2,13 +2,20 @@
 
 #include "Utils.hpp"
 #include <functional>
+#include <cstdint>
 
 
 namespace Reduction {
 
 using ReductionFunc = std::function<void(const unsigned int, const size_t, const ucharVector&, ucharVector&)>;
+// reduces count hashes (stored back to back) to count passwords of resultLength, each with its own salt
+using BatchReductionFunc = std::function<void(const uint32_t* salts, size_t resultLength, const unsigned char* hashes,
+                                              size_t hashLength, unsigned char* plains, size_t count)>;
 
 void Adrian(const unsigned int salt, const size_t resultLength, const ucharVector& hashValue, ucharVector& plainValue);
 void Salted(const unsigned int salt, const size_t resultLength, const ucharVector& hashValue, ucharVector& plainValue);
+// same results as Salted, for a whole batch
+void SaltedBatch(const uint32_t* salts, size_t resultLength, const unsigned char* hashes,
+                 size_t hashLength, unsigned char* plains, size_t count);
 
 } // namespace Reduction
@@ -0,0 +1,260 @@
+#include "Shards.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+
+namespace Shards {
+
+namespace {
+
+#ifdef _WIN32
+
+using ProcessId = HANDLE;
+
+// quotes an argument the way CommandLineToArgvW splits it back
+std::string QuoteArg(const std::string& arg)
+{
+    if (!arg.empty() && arg.find_first_of(" \t\"") == std::string::npos)
+        return arg;
+
+    std::string quoted = "\"";
+    size_t backslashes = 0;
+    for (char c : arg)
+    {
+        if (c == '\\')
+        {
+            backslashes++;
+            continue;
+        }
+        quoted.append(c == '"' ? 2 * backslashes + 1 : backslashes, '\\');
+        quoted.push_back(c);
+        backslashes = 0;
+    }
+    quoted.append(2 * backslashes, '\\');
+    return quoted + "\"";
+}
+
+bool Spawn(const std::string& executable, const std::vector<std::string>& args, const std::string& log, ProcessId& process)
+{
+    std::string commandLine = QuoteArg(executable);
+    for (const auto& arg : args)
+        commandLine += " " + QuoteArg(arg);
+
+    SECURITY_ATTRIBUTES inherit = { sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE };
+    HANDLE output = CreateFileA(log.c_str(), GENERIC_WRITE, FILE_SHARE_READ, &inherit, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    HANDLE input = CreateFileA("NUL", GENERIC_READ, 0, &inherit, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (output == INVALID_HANDLE_VALUE || input == INVALID_HANDLE_VALUE)
+    {
+        if (output != INVALID_HANDLE_VALUE)
+            CloseHandle(output);
+        if (input != INVALID_HANDLE_VALUE)
+            CloseHandle(input);
+        return false;
+    }
+
+    STARTUPINFOA startup = {};
+    startup.cb = sizeof(startup);
+    startup.dwFlags = STARTF_USESTDHANDLES;
+    startup.hStdInput = input;
+    startup.hStdOutput = output;
+    startup.hStdError = output;
+
+    PROCESS_INFORMATION info = {};
+    const BOOL created = CreateProcessA(nullptr, &commandLine[0], nullptr, nullptr, TRUE, 0, nullptr, nullptr, &startup, &info);
+    CloseHandle(output);
+    CloseHandle(input);
+    if (!created)
+        return false;
+
+    CloseHandle(info.hThread);
+    process = info.hProcess;
+    return true;
+}
+
+// waits until one of running exits, returns it - or an id not in running when waiting fails
+ProcessId WaitAny(const std::vector<ProcessId>& running, bool& success)
+{
+    // WaitForMultipleObjects takes at most MAXIMUM_WAIT_OBJECTS handles
+    const DWORD count = static_cast<DWORD>(std::min<size_t>(running.size(), MAXIMUM_WAIT_OBJECTS));
+    const DWORD result = WaitForMultipleObjects(count, running.data(), FALSE, INFINITE);
+    if (result == WAIT_FAILED || result >= WAIT_OBJECT_0 + count)
+    {
+        success = false;
+        return nullptr;
+    }
+    const ProcessId process = running[result - WAIT_OBJECT_0];
+
+    DWORD exitCode = 1;
+    success = GetExitCodeProcess(process, &exitCode) && exitCode == 0;
+    CloseHandle(process);
+    return process;
+}
+
+#else // _WIN32
+
+using ProcessId = pid_t;
+
+bool Spawn(const std::string& executable, const std::vector<std::string>& args, const std::string& log, ProcessId& process)
+{
+    // workers never wait for input, interactive mode would otherwise read the coordinator's stdin
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, log.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    posix_spawn_file_actions_adddup2(&actions, STDOUT_FILENO, STDERR_FILENO);
+
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>(executable.c_str()));
+    for (const auto& arg : args)
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    argv.push_back(nullptr);
+
+    const int result = posix_spawnp(&process, executable.c_str(), &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    return result == 0;
+}
+
+// waits until one of running exits, returns it - or an id not in running when waiting fails
+ProcessId WaitAny(const std::vector<ProcessId>& running, bool& success)
+{
+    for (;;)
+    {
+        int status = 0;
+        const pid_t process = waitpid(-1, &status, 0);
+        // a signal interrupting the wait is not a lost worker
+        if (process < 0 && errno == EINTR)
+            continue;
+        if (process < 0 || std::find(running.begin(), running.end(), process) != running.end())
+        {
+            success = process >= 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+            return process;
+        }
+    }
+}
+
+#endif // _WIN32
+
+bool FileExists(const std::string& filename)
+{
+    return static_cast<bool>(std::ifstream(filename));
+}
+
+} // anonymous namespace
+
+bool ParseShard(const std::string& shard, uint32_t& index, uint32_t& count)
+{
+    std::istringstream stream(shard);
+    char slash = '\0';
+    if (!(stream >> index >> slash >> count) || slash != '/' || !stream.eof() || index >= count)
+    {
+        std::cout << "Invalid shard \"" << shard << "\" - use k/N, where 0 <= k < N." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::string ShardFilename(const std::string& table, uint32_t index, uint32_t count)
+{
+    return table + ".shard-" + std::to_string(index) + "-of-" + std::to_string(count);
+}
+
+std::vector<std::string> RunWorkers(const std::string& executable, const std::vector<std::string>& args, const std::string& table,
+                                    uint32_t count, uint32_t parallel, uint32_t attempts)
+{
+    std::vector<std::string> files;
+    std::deque<uint32_t> pending;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        files.push_back(ShardFilename(table, i, count));
+        if (FileExists(files.back()))
+            std::cout << "Shard " << i << "/" << count << " already completed, keeping \"" << files.back() << "\"\n";
+        else
+            pending.push_back(i);
+    }
+
+    std::map<ProcessId, uint32_t> running;
+    std::vector<uint32_t> failures(count, 0);
+    bool failed = false;
+    while (!running.empty() || (!pending.empty() && !failed))
+    {
+        while (!failed && !pending.empty() && running.size() < std::max<uint32_t>(parallel, 1))
+        {
+            const uint32_t shard = pending.front();
+            pending.pop_front();
+
+            // workers write to a temporary file, so only completed shards ever have the final name
+            std::vector<std::string> workerArgs(args);
+            workerArgs.insert(workerArgs.end(), { "--shard", std::to_string(shard) + "/" + std::to_string(count), "-t", files[shard] + ".tmp" });
+
+            ProcessId process;
+            if (!Spawn(executable, workerArgs, files[shard] + ".log", process))
+            {
+                std::cout << "Unable to start worker for shard " << shard << "/" << count << "!\n";
+                failed = true;
+                break;
+            }
+            running[process] = shard;
+            std::cout << "Shard " << shard << "/" << count << " started (attempt " << failures[shard] + 1 << ")\n";
+        }
+        if (running.empty())
+            break;
+
+        std::vector<ProcessId> processes;
+        for (const auto& i : running)
+            processes.push_back(i.first);
+
+        bool success = false;
+        const ProcessId process = WaitAny(processes, success);
+        auto it = running.find(process);
+        if (it == running.end())
+        {
+            std::cout << "Lost track of worker processes!\n";
+            return std::vector<std::string>();
+        }
+        const uint32_t shard = it->second;
+        running.erase(it);
+
+        const std::string& file = files[shard];
+        std::remove(file.c_str());
+        if (success && std::rename((file + ".tmp").c_str(), file.c_str()) == 0)
+        {
+            std::remove((file + ".log").c_str());
+            std::cout << "Shard " << shard << "/" << count << " completed\n";
+            continue;
+        }
+
+        std::remove((file + ".tmp").c_str());
+        if (++failures[shard] < attempts)
+        {
+            std::cout << "Shard " << shard << "/" << count << " failed (see \"" << file << ".log\"), restarting\n";
+            pending.push_back(shard);
+        }
+        else
+        {
+            std::cout << "Shard " << shard << "/" << count << " failed " << attempts << " times (see \"" << file << ".log\"), giving up\n";
+            failed = true;
+        }
+    }
+
+    return failed ? std::vector<std::string>() : files;
+}
+
+} // namespace Shards
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// Sharded generation - shard k of N covers a disjoint, deterministic part of the table's rows, so
+// shards can be generated by separate processes or machines and merged afterwards.
+namespace Shards {
+
+// parses "k/N", where 0 <= k < N
+bool ParseShard(const std::string& shard, uint32_t& index, uint32_t& count);
+
+// file a coordinator keeps shard index of table in once it is completed
+std::string ShardFilename(const std::string& table, uint32_t index, uint32_t count);
+
+// Runs a worker process per shard - executable with args, followed by "--shard k/N -t <file>" -
+// at most parallel of them at once. Output of each worker goes to a log next to its shard file.
+// Shards completed by an earlier run are kept, failed ones are restarted up to attempts times.
+// Returns the shard files when all shards are completed, an empty vector otherwise.
+std::vector<std::string> RunWorkers(const std::string& executable, const std::vector<std::string>& args, const std::string& table,
+                                    uint32_t count, uint32_t parallel, uint32_t attempts);
+
+} // namespace Shards
@@ -0,0 +1,242 @@
+#include "SortedRuns.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+
+
+uint64_t SortRows(RowBlock& rows, uint32_t hashLength, uint32_t rowSize)
+{
+    const size_t count = rows.size() / rowSize;
+    std::vector<uint32_t> order(count);
+    std::iota(order.begin(), order.end(), 0);
+
+    // stable, so the first of equal hashes is the one kept
+    const unsigned char* data = rows.data();
+    std::stable_sort(order.begin(), order.end(), [data, hashLength, rowSize](uint32_t a, uint32_t b)
+    {
+        return std::memcmp(data + static_cast<size_t>(a) * rowSize, data + static_cast<size_t>(b) * rowSize, hashLength) < 0;
+    });
+
+    RowBlock sorted(rows.size());
+    unsigned char* out = sorted.data();
+    for (size_t i = 0; i < count; ++i)
+    {
+        const unsigned char* row = data + static_cast<size_t>(order[i]) * rowSize;
+        if (out != sorted.data() && std::memcmp(out - rowSize, row, hashLength) == 0)
+            continue;
+        std::memcpy(out, row, rowSize);
+        out += rowSize;
+    }
+
+    const uint64_t kept = static_cast<uint64_t>(out - sorted.data()) / rowSize;
+    sorted.resize(static_cast<size_t>(kept * rowSize));
+    rows.swap(sorted);
+    return count - kept;
+}
+
+uint64_t MergeRuns(const std::vector<RowRange>& runs, uint32_t hashLength, uint32_t rowSize,
+                   const std::function<void(const unsigned char*)>& sink)
+{
+    std::vector<const unsigned char*> cursors;
+    std::vector<size_t> heap;
+    for (const auto& run : runs)
+    {
+        cursors.push_back(run.begin);
+        if (run.begin != run.end)
+            heap.push_back(cursors.size() - 1);
+    }
+
+    // min-heap of runs by their current row, ties go to the earlier run
+    auto later = [&](size_t a, size_t b)
+    {
+        const int order = std::memcmp(cursors[a], cursors[b], hashLength);
+        return order > 0 || (order == 0 && a > b);
+    };
+    std::make_heap(heap.begin(), heap.end(), later);
+
+    uint64_t dropped = 0;
+    const unsigned char* last = nullptr;
+    while (!heap.empty())
+    {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        const size_t run = heap.back();
+        const unsigned char* row = cursors[run];
+
+        if (last != nullptr && std::memcmp(last, row, hashLength) == 0)
+        {
+            dropped++;
+        }
+        else
+        {
+            sink(row);
+            last = row;
+        }
+
+        cursors[run] += rowSize;
+        if (cursors[run] != runs[run].end)
+            std::push_heap(heap.begin(), heap.end(), later);
+        else
+            heap.pop_back();
+    }
+
+    return dropped;
+}
+
+std::vector<std::vector<RowRange>> SplitRuns(const std::vector<RowRange>& runs, uint32_t hashLength, uint32_t rowSize,
+                                             uint64_t sliceRows)
+{
+    uint64_t totalRows = 0;
+    size_t largest = 0;
+    for (size_t i = 0; i < runs.size(); ++i)
+    {
+        const uint64_t rows = static_cast<uint64_t>(runs[i].end - runs[i].begin) / rowSize;
+        totalRows += rows;
+        if (rows > static_cast<uint64_t>(runs[largest].end - runs[largest].begin) / rowSize)
+            largest = i;
+    }
+
+    std::vector<std::vector<RowRange>> slices;
+    if (totalRows == 0)
+        return slices;
+
+    // splitters are evenly spaced keys of the largest run - runs share the key distribution
+    const uint64_t sliceCount = std::max<uint64_t>(1, (totalRows + sliceRows - 1) / std::max<uint64_t>(1, sliceRows));
+    const uint64_t largestRows = static_cast<uint64_t>(runs[largest].end - runs[largest].begin) / rowSize;
+    std::vector<const unsigned char*> cursors;
+    for (const auto& run : runs)
+        cursors.push_back(run.begin);
+
+    for (uint64_t slice = 1; slice <= sliceCount; ++slice)
+    {
+        const unsigned char* splitter = nullptr;
+        const uint64_t splitterIndex = largestRows * slice / sliceCount;
+        if (slice < sliceCount && splitterIndex < largestRows)
+            splitter = runs[largest].begin + splitterIndex * rowSize;
+
+        std::vector<RowRange> ranges;
+        uint64_t rows = 0;
+        for (size_t i = 0; i < runs.size(); ++i)
+        {
+            const unsigned char* end = runs[i].end;
+            if (splitter != nullptr)
+            {
+                // first row not below the splitter, rows are fixed size so the search is over indices
+                uint64_t low = static_cast<uint64_t>(cursors[i] - runs[i].begin) / rowSize;
+                uint64_t high = static_cast<uint64_t>(runs[i].end - runs[i].begin) / rowSize;
+                while (low < high)
+                {
+                    const uint64_t middle = low + (high - low) / 2;
+                    if (std::memcmp(runs[i].begin + middle * rowSize, splitter, hashLength) < 0)
+                        low = middle + 1;
+                    else
+                        high = middle;
+                }
+                end = runs[i].begin + low * rowSize;
+            }
+            ranges.push_back({ cursors[i], end });
+            rows += static_cast<uint64_t>(end - cursors[i]) / rowSize;
+            cursors[i] = end;
+        }
+
+        if (rows > 0)
+            slices.push_back(ranges);
+    }
+
+    return slices;
+}
+
+RunWriter::RunWriter()
+    : mFilename()
+    , mFile()
+    , mRunSizes()
+    , mFailed(false)
+    , mWriter()
+    , mMutex()
+    , mNotEmpty()
+    , mNotFull()
+    , mQueue()
+    , mCapacity(1)
+    , mClosing(false)
+{
+}
+
+RunWriter::~RunWriter()
+{
+    Close();
+}
+
+bool RunWriter::Open(const std::string& filename, size_t capacity)
+{
+    Close();
+
+    mFile.open(filename, std::ofstream::binary | std::ofstream::trunc);
+    if (!mFile)
+    {
+        std::cout << "Unable to open file \"" << filename << "\"!\n";
+        return false;
+    }
+
+    mFilename = filename;
+    mRunSizes.clear();
+    mFailed = false;
+    mCapacity = capacity ? capacity : 1;
+    mClosing = false;
+    mWriter = std::thread(&RunWriter::Write, this);
+    return true;
+}
+
+void RunWriter::Push(RowBlock&& rows)
+{
+    if (rows.empty())
+        return;
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mNotFull.wait(lock, [this]() { return mQueue.size() < mCapacity; });
+    mQueue.push_back(std::move(rows));
+    lock.unlock();
+    mNotEmpty.notify_one();
+}
+
+bool RunWriter::Close()
+{
+    if (!mWriter.joinable())
+        return !mFailed;
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mClosing = true;
+    }
+    mNotEmpty.notify_one();
+    mWriter.join();
+
+    mFile.close();
+    mFailed = mFailed || mFile.fail();
+    if (mFailed)
+        std::cout << "Writing to \"" << mFilename << "\" failed!\n";
+    return !mFailed;
+}
+
+void RunWriter::Write()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (;;)
+    {
+        mNotEmpty.wait(lock, [this]() { return mClosing || !mQueue.empty(); });
+        if (mQueue.empty())
+            return;
+
+        // runs are written outside the lock, producers keep filling the queue meanwhile
+        RowBlock rows = std::move(mQueue.front());
+        mQueue.pop_front();
+        lock.unlock();
+        mNotFull.notify_one();
+
+        mFile.write(reinterpret_cast<const char*>(rows.data()), static_cast<std::streamsize>(rows.size()));
+        mFailed = mFailed || !mFile;
+        mRunSizes.push_back(rows.size());
+
+        lock.lock();
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// rows of a binary table laid out back to back - endpoint hash followed by the start password
+using RowBlock = std::vector<unsigned char>;
+
+struct RowRange
+{
+    const unsigned char* begin;
+    const unsigned char* end;
+};
+
+// sorts rows by hash and keeps only the first row of equal hashes, returns the number of dropped rows
+uint64_t SortRows(RowBlock& rows, uint32_t hashLength, uint32_t rowSize);
+
+// k-way merge of sorted runs - sink gets every row in hash order, of equal hashes only the one
+// from the earliest run, returns the number of dropped rows
+uint64_t MergeRuns(const std::vector<RowRange>& runs, uint32_t hashLength, uint32_t rowSize,
+                   const std::function<void(const unsigned char*)>& sink);
+
+// Splits sorted runs into key ranges of about sliceRows rows in total - slice i holds the part of
+// every run (in run order) with keys in its range, so slices can be merged independently and
+// equal hashes always end up in the same slice.
+std::vector<std::vector<RowRange>> SplitRuns(const std::vector<RowRange>& runs, uint32_t hashLength, uint32_t rowSize,
+                                             uint64_t sliceRows);
+
+// Appends sorted runs to a staging file on a dedicated writer thread. Producers block while
+// the queue is full, so memory held by pending runs stays bounded by its capacity.
+class RunWriter
+{
+public:
+    RunWriter();
+    ~RunWriter();
+
+    RunWriter(const RunWriter&) = delete;
+    RunWriter& operator=(const RunWriter&) = delete;
+
+    bool Open(const std::string& filename, size_t capacity);
+    // queues a sorted run for writing, blocks while the queue is full
+    void Push(RowBlock&& rows);
+    // writes all queued runs and closes the file, returns false if any write failed
+    bool Close();
+
+    const std::string& GetFilename() const { return mFilename; }
+    // byte size of every run, in file order
+    const std::vector<uint64_t>& GetRunSizes() const { return mRunSizes; }
+
+private:
+    void Write();
+
+    std::string mFilename;
+    std::ofstream mFile;
+    std::vector<uint64_t> mRunSizes;
+    bool mFailed;
+
+    std::thread mWriter;
+    std::mutex mMutex;
+    std::condition_variable mNotEmpty;
+    std::condition_variable mNotFull;
+    std::deque<RowBlock> mQueue;
+    size_t mCapacity;
+    bool mClosing;
+};
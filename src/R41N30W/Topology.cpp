@@ -0,0 +1,366 @@
+#include "Topology.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <tuple>
+#include "Utils.hpp"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <dirent.h>
+#include <sched.h>
+#endif
+
+
+namespace Topology {
+
+namespace {
+
+std::atomic<Policy> gPolicy(Policy::NONE);
+std::vector<unsigned int> gPlacement; // written only by SetPolicy, before workers start
+
+#ifdef _WIN32
+
+void Detect(Info& info)
+{
+    DWORD_PTR processMask = 0, systemMask = 0;
+    if (!GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask))
+        processMask = ~static_cast<DWORD_PTR>(0);
+
+    DWORD length = 0;
+    GetLogicalProcessorInformation(nullptr, &length);
+    std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> entries(length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+    if (entries.empty() || !GetLogicalProcessorInformation(entries.data(), &length))
+        return;
+
+    // only processor group 0 is seen here - at most 64 logical CPUs
+    std::map<unsigned int, Cpu> cpus;
+    unsigned int core = 0, package = 0;
+    for (const auto& entry : entries)
+    {
+        for (unsigned int id = 0; id < 8 * sizeof(ULONG_PTR); ++id)
+        {
+            if ((entry.ProcessorMask & (static_cast<ULONG_PTR>(1) << id)) == 0 || (processMask & (static_cast<DWORD_PTR>(1) << id)) == 0)
+                continue;
+
+            Cpu& cpu = cpus[id];
+            cpu.id = id;
+            if (entry.Relationship == RelationProcessorCore)
+                cpu.core = core;
+            else if (entry.Relationship == RelationProcessorPackage)
+                cpu.package = package;
+            else if (entry.Relationship == RelationNumaNode)
+                cpu.node = entry.NumaNode.NodeNumber;
+        }
+        core += (entry.Relationship == RelationProcessorCore) ? 1 : 0;
+        package += (entry.Relationship == RelationProcessorPackage) ? 1 : 0;
+    }
+
+    for (const auto& i : cpus)
+        info.cpus.push_back(i.second);
+}
+
+// previous (if given) gets the CPUs the thread could run on before
+bool SetAffinity(const std::vector<unsigned int>& cpus, std::vector<unsigned int>* previous = nullptr)
+{
+    DWORD_PTR mask = 0;
+    for (unsigned int id : cpus)
+        mask |= static_cast<DWORD_PTR>(1) << id;
+    const DWORD_PTR old = SetThreadAffinityMask(GetCurrentThread(), mask);
+    if (old == 0)
+        return false;
+
+    if (previous != nullptr)
+    {
+        previous->clear();
+        for (unsigned int id = 0; id < 8 * sizeof(DWORD_PTR); ++id)
+        {
+            if (old & (static_cast<DWORD_PTR>(1) << id))
+                previous->push_back(id);
+        }
+    }
+    return true;
+}
+
+unsigned int CurrentCpu()
+{
+    return GetCurrentProcessorNumber();
+}
+
+#else // _WIN32
+
+bool ReadValue(const std::string& path, unsigned int& value)
+{
+    std::ifstream file(path);
+    return static_cast<bool>(file >> value);
+}
+
+// parses lists like "0-3,8-11"
+std::vector<unsigned int> ReadCpuList(const std::string& path)
+{
+    std::vector<unsigned int> cpus;
+    std::ifstream file(path);
+    std::string range;
+    while (std::getline(file, range, ','))
+    {
+        std::istringstream stream(range);
+        unsigned int first = 0, last = 0;
+        char dash = '\0';
+        if (!(stream >> first))
+            continue;
+        last = (stream >> dash >> last && dash == '-') ? last : first;
+        for (unsigned int id = first; id <= last; ++id)
+            cpus.push_back(id);
+    }
+    return cpus;
+}
+
+void Detect(Info& info)
+{
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        return;
+
+    const std::string cpuPath = "/sys/devices/system/cpu/cpu";
+    for (unsigned int id = 0; id < CPU_SETSIZE; ++id)
+    {
+        if (!CPU_ISSET(id, &allowed))
+            continue;
+
+        Cpu cpu = { id, id, 0, 0, 0 };
+        ReadValue(cpuPath + std::to_string(id) + "/topology/core_id", cpu.core);
+        ReadValue(cpuPath + std::to_string(id) + "/topology/physical_package_id", cpu.package);
+        info.cpus.push_back(cpu);
+    }
+
+    // nodes may be numbered sparsely, so the directory is listed
+    const std::string nodePath = "/sys/devices/system/node/";
+    if (DIR* nodes = opendir(nodePath.c_str()))
+    {
+        while (const dirent* entry = readdir(nodes))
+        {
+            unsigned int node = 0;
+            if (std::sscanf(entry->d_name, "node%u", &node) != 1)
+                continue;
+            for (unsigned int id : ReadCpuList(nodePath + entry->d_name + "/cpulist"))
+            {
+                for (auto& cpu : info.cpus)
+                    if (cpu.id == id)
+                        cpu.node = node;
+            }
+        }
+        closedir(nodes);
+    }
+
+    // core ids repeat across packages - made unique here
+    std::map<std::pair<unsigned int, unsigned int>, unsigned int> cores;
+    for (auto& cpu : info.cpus)
+        cpu.core = cores.emplace(std::make_pair(cpu.package, cpu.core), static_cast<unsigned int>(cores.size())).first->second;
+}
+
+// previous (if given) gets the CPUs the thread could run on before
+bool SetAffinity(const std::vector<unsigned int>& cpus, std::vector<unsigned int>* previous = nullptr)
+{
+    cpu_set_t set;
+    if (previous != nullptr)
+    {
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) != 0)
+            return false;
+
+        previous->clear();
+        for (unsigned int id = 0; id < CPU_SETSIZE; ++id)
+        {
+            if (CPU_ISSET(id, &set))
+                previous->push_back(id);
+        }
+    }
+
+    CPU_ZERO(&set);
+    for (unsigned int id : cpus)
+        CPU_SET(id, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+unsigned int CurrentCpu()
+{
+    const int cpu = sched_getcpu();
+    return cpu < 0 ? 0 : static_cast<unsigned int>(cpu);
+}
+
+#endif // _WIN32
+
+Info DetectInfo()
+{
+    Info info;
+    Detect(info);
+    if (info.cpus.empty())
+    {
+        for (unsigned int id = 0; id < hardwareConcurrency(); ++id)
+            info.cpus.push_back({ id, id, 0, 0, 0 });
+    }
+
+    std::sort(info.cpus.begin(), info.cpus.end(), [](const Cpu& a, const Cpu& b) { return a.id < b.id; });
+    std::map<unsigned int, unsigned int> siblings;
+    std::vector<unsigned int> packages, nodes;
+    for (auto& cpu : info.cpus)
+    {
+        cpu.thread = siblings[cpu.core]++;
+        packages.push_back(cpu.package);
+        nodes.push_back(cpu.node);
+    }
+    std::sort(packages.begin(), packages.end());
+    std::sort(nodes.begin(), nodes.end());
+
+    info.cores = static_cast<unsigned int>(siblings.size());
+    info.packages = static_cast<unsigned int>(std::unique(packages.begin(), packages.end()) - packages.begin());
+    info.nodes = static_cast<unsigned int>(std::unique(nodes.begin(), nodes.end()) - nodes.begin());
+    return info;
+}
+
+} // anonymous namespace
+
+const Info& Get()
+{
+    static const Info info = DetectInfo();
+    return info;
+}
+
+bool ParsePolicy(const std::string& name, Policy& policy)
+{
+    for (Policy i : { Policy::NONE, Policy::COMPACT, Policy::SCATTER, Policy::PHYSICAL })
+    {
+        if (name == GetPolicyName(i))
+        {
+            policy = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string GetPolicyName(Policy policy)
+{
+    switch (policy)
+    {
+    case Policy::COMPACT:
+        return "compact";
+    case Policy::SCATTER:
+        return "scatter";
+    case Policy::PHYSICAL:
+        return "physical";
+    default:
+        return "none";
+    }
+}
+
+std::vector<unsigned int> Placement(Policy policy)
+{
+    std::vector<Cpu> cpus = Get().cpus;
+    if (policy == Policy::NONE)
+        return std::vector<unsigned int>();
+
+    if (policy == Policy::PHYSICAL)
+        cpus.erase(std::remove_if(cpus.begin(), cpus.end(), [](const Cpu& cpu) { return cpu.thread > 0; }), cpus.end());
+
+    if (policy == Policy::SCATTER)
+    {
+        // rank of the core within its node - the n-th core of every node comes before any (n + 1)-th
+        std::map<unsigned int, std::map<unsigned int, unsigned int>> coreRanks;
+        for (const auto& cpu : cpus)
+            coreRanks[cpu.node].emplace(cpu.core, 0);
+        for (auto& node : coreRanks)
+        {
+            unsigned int rank = 0;
+            for (auto& core : node.second)
+                core.second = rank++;
+        }
+
+        std::stable_sort(cpus.begin(), cpus.end(), [&coreRanks](const Cpu& a, const Cpu& b)
+        {
+            return std::make_tuple(a.thread, coreRanks[a.node][a.core], a.node) < std::make_tuple(b.thread, coreRanks[b.node][b.core], b.node);
+        });
+    }
+    else
+    {
+        std::stable_sort(cpus.begin(), cpus.end(), [](const Cpu& a, const Cpu& b)
+        {
+            return std::make_tuple(a.node, a.package, a.core, a.thread) < std::make_tuple(b.node, b.package, b.core, b.thread);
+        });
+    }
+
+    std::vector<unsigned int> placement;
+    for (const auto& cpu : cpus)
+        placement.push_back(cpu.id);
+    return placement;
+}
+
+void SetPolicy(Policy policy)
+{
+    gPlacement = Placement(policy);
+    gPolicy = policy;
+}
+
+Policy GetPolicy()
+{
+    return gPolicy;
+}
+
+void PinThread(unsigned int slot)
+{
+    if (gPolicy == Policy::NONE || gPlacement.empty())
+        return;
+    SetAffinity({ gPlacement[slot % gPlacement.size()] });
+}
+
+std::vector<unsigned int> NodeCpus(unsigned int node)
+{
+    std::vector<unsigned int> cpus;
+    for (const auto& cpu : Get().cpus)
+    {
+        if (cpu.node == node)
+            cpus.push_back(cpu.id);
+    }
+    return cpus;
+}
+
+unsigned int CurrentNode()
+{
+    const unsigned int id = CurrentCpu();
+    for (const auto& cpu : Get().cpus)
+    {
+        if (cpu.id == id)
+            return cpu.node;
+    }
+    return 0;
+}
+
+ScopedPin::ScopedPin(unsigned int slot)
+    : mPrevious()
+    , mPinned(false)
+{
+    if (gPolicy != Policy::NONE && !gPlacement.empty())
+        mPinned = SetAffinity({ gPlacement[slot % gPlacement.size()] }, &mPrevious);
+}
+
+ScopedPin::ScopedPin(const std::vector<unsigned int>& cpus)
+    : mPrevious()
+    , mPinned(false)
+{
+    if (!cpus.empty())
+        mPinned = SetAffinity(cpus, &mPrevious);
+}
+
+ScopedPin::~ScopedPin()
+{
+    if (mPinned)
+        SetAffinity(mPrevious);
+}
+
+} // namespace Topology
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// CPU topology - logical CPUs with their core, package and NUMA node - and placement of worker
+// threads on them. Workers pin themselves by their slot (0 .. thread count - 1), the policy
+// decides which CPU each slot gets. Until SetPolicy is called pinning does nothing.
+namespace Topology {
+
+enum class Policy
+{
+    NONE = 0, // threads float, scheduled by the OS
+    COMPACT, // fill a core (all SMT siblings) and a node before moving on to the next
+    SCATTER, // spread over nodes and cores first, SMT siblings are used last
+    PHYSICAL, // one thread per physical core, nodes filled in order
+};
+
+struct Cpu
+{
+    unsigned int id; // as the OS numbers logical CPUs
+    unsigned int core; // unique across packages
+    unsigned int package;
+    unsigned int node;
+    unsigned int thread; // index among SMT siblings of its core
+};
+
+struct Info
+{
+    std::vector<Cpu> cpus; // the ones this process may run on, by id
+    unsigned int cores;
+    unsigned int packages;
+    unsigned int nodes;
+};
+
+// detected on first use - sysfs on Linux, GetLogicalProcessorInformation on Windows, a flat
+// layout of hardwareConcurrency() CPUs when neither is available
+const Info& Get();
+
+bool ParsePolicy(const std::string& name, Policy& policy);
+std::string GetPolicyName(Policy policy);
+// ids of CPUs in the order slots get them under policy, empty for NONE
+std::vector<unsigned int> Placement(Policy policy);
+
+// should be called before worker threads start
+void SetPolicy(Policy policy);
+Policy GetPolicy();
+
+// pins the calling thread to the CPU of slot (wrapping around), does nothing for NONE - for
+// threads owned by the caller, tasks of std::async use ScopedPin instead
+void PinThread(unsigned int slot);
+// ids of all CPUs of node
+std::vector<unsigned int> NodeCpus(unsigned int node);
+// node of the CPU the calling thread runs on, 0 when unknown
+unsigned int CurrentNode();
+
+// Pins the calling thread while it exists and restores the affinity the thread had before. Tasks of
+// std::async may run on pooled threads (MSVC takes them from the Concurrency Runtime pool), which
+// would otherwise keep the pinning for whatever they run next.
+class ScopedPin
+{
+public:
+    // to the CPU of slot, like PinThread
+    explicit ScopedPin(unsigned int slot);
+    // to the given CPUs, nothing when empty
+    explicit ScopedPin(const std::vector<unsigned int>& cpus);
+    ~ScopedPin();
+
+    ScopedPin(const ScopedPin&) = delete;
+    ScopedPin& operator=(const ScopedPin&) = delete;
+
+private:
+    std::vector<unsigned int> mPrevious;
+    bool mPinned;
+};
+} // namespace Topology
@@ -5,8 +5,15 @@
 #include <iomanip>
 #include <sstream>
 #include <iostream>
+#include <cstring>
+#include <algorithm>
+#include <cstdio>
 #include "Utils.hpp"
+#ifdef _WIN32
 #include <Windows.h>
+#else
+#include <chrono>
+#endif
 
 unsigned int unixHardwareConcurrency()
 {
@@ -30,34 +37,146 @@ unsigned int hardwareConcurrency()
     return cores;
 }
 
-std::string HashToStr(ucharVector hashValue)
+namespace {
+
+// both hex chars of every byte value, so each byte is a single two-char copy
+struct HexTable
+{
+    char pairs[512];
+
+    HexTable()
+    {
+        const char digits[] = "0123456789abcdef";
+        for (int i = 0; i < 256; ++i)
+        {
+            pairs[2 * i] = digits[i >> 4];
+            pairs[2 * i + 1] = digits[i & 0x0F];
+        }
+    }
+};
+
+const unsigned char INVALID_NIBBLE = 0xFF;
+
+// nibble value of every char, INVALID_NIBBLE for non-hex ones
+struct NibbleTable
 {
-    std::stringstream hash("");
-    hash << std::hex << std::setfill('0');
+    unsigned char values[256];
 
-    for (const auto& i : hashValue)
-        hash << std::setw(2) << static_cast<int>(i);
-    return hash.str();
+    NibbleTable()
+    {
+        std::fill(std::begin(values), std::end(values), INVALID_NIBBLE);
+        for (int i = 0; i < 10; ++i)
+            values['0' + i] = static_cast<unsigned char>(i);
+        for (int i = 0; i < 6; ++i)
+        {
+            values['a' + i] = static_cast<unsigned char>(10 + i);
+            values['A' + i] = static_cast<unsigned char>(10 + i);
+        }
+    }
+};
+
+// CRC-32 (reflected 0xEDB88320) slicing-by-8 tables - entry [k][b] is the CRC of byte b followed by k zero bytes
+struct CrcTable
+{
+    uint32_t values[8][256];
+
+    CrcTable()
+    {
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit)
+                crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+            values[0][i] = crc;
+        }
+        for (uint32_t i = 0; i < 256; ++i)
+            for (int k = 1; k < 8; ++k)
+                values[k][i] = (values[k - 1][i] >> 8) ^ values[0][values[k - 1][i] & 0xFF];
+    }
+};
+
+const HexTable HEX_TABLE;
+const NibbleTable NIBBLE_TABLE;
+const CrcTable CRC_TABLE;
+
+} // anonymous namespace
+
+char* HashToHex(const unsigned char* hashValue, size_t length, char* out)
+{
+    for (size_t i = 0; i < length; ++i, out += 2)
+        std::memcpy(out, &HEX_TABLE.pairs[2 * hashValue[i]], 2);
+    return out;
 }
 
-std::ostream& HashToStream(std::ostream& stream, const ucharVector& hashValue)
+bool HexToHash(const char* hex, size_t length, unsigned char* out)
+{
+    // invalid chars are caught once at the end - the loop stays branch free
+    unsigned char invalid = 0;
+    for (size_t i = 0; i + 1 < length; i += 2)
+    {
+        const unsigned char high = NIBBLE_TABLE.values[static_cast<unsigned char>(hex[i])];
+        const unsigned char low = NIBBLE_TABLE.values[static_cast<unsigned char>(hex[i + 1])];
+        invalid |= (high | low) & 0xF0;
+        *out++ = static_cast<unsigned char>((high << 4) | (low & 0x0F));
+    }
+    return invalid == 0;
+}
+
+uint32_t Crc32(const unsigned char* data, size_t length, uint32_t crc)
+{
+    const auto& table = CRC_TABLE.values;
+    crc = ~crc;
+    for (; length >= 8; length -= 8, data += 8)
+    {
+        const uint32_t low = crc ^ (static_cast<uint32_t>(data[0]) | static_cast<uint32_t>(data[1]) << 8 |
+                                    static_cast<uint32_t>(data[2]) << 16 | static_cast<uint32_t>(data[3]) << 24);
+        crc = table[7][low & 0xFF] ^ table[6][(low >> 8) & 0xFF] ^ table[5][(low >> 16) & 0xFF] ^ table[4][low >> 24] ^
+              table[3][data[4]] ^ table[2][data[5]] ^ table[1][data[6]] ^ table[0][data[7]];
+    }
+    for (; length > 0; --length)
+        crc = (crc >> 8) ^ table[0][(crc ^ *data++) & 0xFF];
+    return ~crc;
+}
+
+std::string HashToStr(const ucharVector& hashValue)
 {
-    stream << std::hex << std::setfill('0');
+    std::string hash(hashValue.size() * 2, '\0');
+    HashToHex(hashValue.data(), hashValue.size(), &hash[0]);
+    return hash;
+}
 
-    for (const auto& i : hashValue)
-        stream << std::setw(2) << static_cast<int>(i);
+std::ostream& HashToStream(std::ostream& stream, const ucharVector& hashValue)
+{
+    char buffer[256];
+    for (size_t i = 0; i < hashValue.size(); i += sizeof(buffer) / 2)
+    {
+        const size_t length = std::min(hashValue.size() - i, sizeof(buffer) / 2);
+        HashToHex(hashValue.data() + i, length, buffer);
+        stream.write(buffer, static_cast<std::streamsize>(length * 2));
+    }
     return stream;
 }
 
-void StrToHash(const std::string& hashString, ucharVector& hashValue)
+bool StrToHash(const std::string& hashString, ucharVector& hashValue)
 {
-    for (size_t i = 0; i < hashString.size(); i += 2)
+    const size_t start = hashValue.size();
+    hashValue.resize(start + hashString.size() / 2);
+    bool valid = HexToHash(hashString.data(), hashString.size(), hashValue.data() + start);
+    if (hashString.size() % 2 != 0)
     {
-        std::istringstream hexStream(hashString.substr(i, 2));
-        int x;
-        hexStream >> std::hex >> x;
-        hashValue.push_back(static_cast<unsigned char>(x));
+        // a trailing single digit is taken as a whole byte
+        const unsigned char nibble = NIBBLE_TABLE.values[static_cast<unsigned char>(hashString.back())];
+        hashValue.push_back(nibble == INVALID_NIBBLE ? 0 : nibble);
+        valid = false;
     }
+    return valid;
+}
+
+#ifdef _WIN32
+
+bool MoveFileReplacing(const std::string& source, const std::string& target)
+{
+    return MoveFileExA(source.c_str(), target.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
 }
 
 uint64_t GetTime()
@@ -74,16 +193,42 @@ uint64_t GetClockFreq()
     return freq.QuadPart;
 }
 
+#else // _WIN32
+
+bool MoveFileReplacing(const std::string& source, const std::string& target)
+{
+    // rename replaces an existing target atomically
+    return std::rename(source.c_str(), target.c_str()) == 0;
+}
+
+uint64_t GetTime()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+uint64_t GetClockFreq()
+{
+    return 1000000000ULL;
+}
+
+#endif // _WIN32
+
 void PrettyLogTime(uint64_t timeSeconds)
+{
+    PrettyLogTime(std::cout, timeSeconds);
+}
+
+void PrettyLogTime(std::ostream& stream, uint64_t timeSeconds)
 {
     uint64_t timeMinutes = timeSeconds / 60;
     timeSeconds %= 60;
     uint64_t timeHours = timeMinutes / 60;
     timeMinutes %= 60;
 
-    std::cout << std::setw(2) << std::setfill('0') << timeHours << ":"
-              << std::setw(2) << std::setfill('0') << timeMinutes << ":"
-              << std::setw(2) << std::setfill('0') << timeSeconds;
+    stream << std::setw(2) << std::setfill('0') << timeHours << ":"
+           << std::setw(2) << std::setfill('0') << timeMinutes << ":"
+           << std::setw(2) << std::setfill('0') << timeSeconds;
 }
 
 unsigned int CantorPairing(const unsigned int x, const unsigned int y)
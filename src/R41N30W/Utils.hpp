@@ -8,12 +8,22 @@ using ucharVector = std::vector<unsigned char>;
 
 unsigned int hardwareConcurrency();
 
-void StrToHash(const std::string& hashString, ucharVector& hashValue);
-std::string HashToStr(ucharVector hashValue);
+// appends decoded bytes to hashValue, returns false on odd length or non-hex chars
+bool StrToHash(const std::string& hashString, ucharVector& hashValue);
+std::string HashToStr(const ucharVector& hashValue);
 std::ostream& HashToStream(std::ostream& stream, const ucharVector& hashValue);
+// writes 2 * length lowercase hex chars to out, returns pointer past the last one
+char* HashToHex(const unsigned char* hashValue, size_t length, char* out);
+// decodes length / 2 bytes of hex (either case) to out, returns false on non-hex chars
+bool HexToHash(const char* hex, size_t length, unsigned char* out);
+// CRC-32 as used by zip/zlib, pass the previous result as crc to continue over more data
+uint32_t Crc32(const unsigned char* data, size_t length, uint32_t crc = 0);
+// renames source to target, replacing target in a single step - target is never missing on failure
+bool MoveFileReplacing(const std::string& source, const std::string& target);
 
 uint64_t GetTime();
 uint64_t GetClockFreq();
 void PrettyLogTime(uint64_t timeSeconds);
+void PrettyLogTime(std::ostream& stream, uint64_t timeSeconds);
 
 unsigned int CantorPairing(const unsigned int x, const unsigned int y);
\ No newline at end of file
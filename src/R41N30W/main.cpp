@@ -1,9 +1,27 @@
 #include <iostream>
 #include <stdlib.h>
 #include <string>
+#include <functional>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <vector>
 #include "RainbowTable.hpp"
+#include "LookupTable.hpp"
+#include "BruteForce.hpp"
 #include "Utils.hpp"
 #include "ArgParser.hpp"
+#include "Planner.hpp"
+#include "HyperLogLog.hpp"
+#include "Profiler.hpp"
+#include "Progress.hpp"
+#include "Shards.hpp"
+#include "Topology.hpp"
+#include "LookupScheduler.hpp"
 
 using namespace std;
 
@@ -38,9 +56,372 @@ After generation, use the created \"rt.bin\" table to crack something:\n\
     $> R41N30W.exe -t rt.bin\n\
 \n\
 Interactive mode will launch - input your hash, press enter and hope for the best.\n\
+\n\
+For short passwords, an exhaustive lookup table answers every query with a single probe:\n\
+    $> R41N30W.exe -g -t lut.bin --table-type lookup --length 4 --hash SHA1\n\
+\n\
+Crack a list of hashes, brute forcing whatever the table misses (all misses are searched at once):\n\
+    $> R41N30W.exe -t rt.bin --hashes hashes.txt --bruteforce fallback\n\
+\n\
+Not sure which sizes to pick? Ask the planner what fits in 2 GiB and one hour of generation:\n\
+    $> R41N30W.exe --plan --length 6 --hash SHA1 --plan-memory 2048 --plan-time 3600\n\
+\n\
+Check how much of the keyspace a generated table really covers, on 10000 of its chains:\n\
+    $> R41N30W.exe -t rt.bin --analyze 10000 --vertical 1000000 --analyze-min 50\n\
 ";
 
 
+// status (if given) reports readiness of the table on 'status'
+void RunInteractive(const std::function<string(const string&)>& findPassword, const std::function<string()>& status)
+{
+    cout << "\n::Give password hash to look for" << (status ? ", 'status' to check the table" : "") << " or 'exit' to terminate" << endl;
+    string inputHash, pass;
+    do
+    {
+        cout << ">> ";
+        if (!(cin >> inputHash) || inputHash == "exit")
+            break;
+        if (status && inputHash == "status")
+        {
+            cout << status() << endl;
+            continue;
+        }
+        cout << "Looking for hash now..." << endl;
+        pass = findPassword(inputHash);
+        if (pass.empty())
+            cout << "PASSWORD NOT FOUND! :(\n";
+        else
+            cout << "PASSWORD FOUND: \"" << pass << "\"\n";
+    } while (true);
+
+    cout << "Terminating" << endl;
+}
+
+// cracks every hash from the list file - table misses are brute forced together, in a single pass
+int RunHashList(const string& filename, const std::function<string(const string&)>& findPassword, BruteForce* bruteForce)
+{
+    ifstream file(filename);
+    if (!file)
+    {
+        cout << "Unable to open file \"" << filename << "\"!\n";
+        return 1;
+    }
+
+    vector<string> hashes;
+    vector<ucharVector> digests;
+    vector<string> passwords;
+    string line;
+    for (size_t lineNumber = 1; getline(file, line); ++lineNumber)
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.empty())
+            continue;
+
+        ucharVector hashValue;
+        if (!StrToHash(line, hashValue))
+        {
+            cout << "Skipping line " << lineNumber << " - \"" << line << "\" is not a hash in hex form" << endl;
+            continue;
+        }
+
+        hashes.push_back(line);
+        digests.push_back(hashValue);
+        passwords.push_back(findPassword ? findPassword(line) : string());
+    }
+
+    if (bruteForce != nullptr)
+    {
+        vector<ucharVector> misses;
+        for (size_t i = 0; i < hashes.size(); ++i)
+        {
+            if (!passwords[i].empty())
+                continue;
+
+            misses.push_back(digests[i]);
+        }
+
+        map<ucharVector, string> found;
+        if (!misses.empty())
+            bruteForce->Run(misses, found);
+
+        for (size_t i = 0; i < hashes.size(); ++i)
+        {
+            if (!passwords[i].empty())
+                continue;
+
+            auto it = found.find(digests[i]);
+            if (it != found.end())
+                passwords[i] = it->second;
+        }
+    }
+
+    size_t cracked = 0;
+    for (size_t i = 0; i < hashes.size(); ++i)
+    {
+        cout << hashes[i] << " " << (passwords[i].empty() ? "<not found>" : passwords[i]) << "\n";
+        cracked += passwords[i].empty() ? 0 : 1;
+    }
+    cout << "Cracked " << cracked << "/" << hashes.size() << " hashes." << endl;
+    return 0;
+}
+
+// uses the table if there is one, falls back to brute force if it is enabled
+int RunQueries(ArgParser& parser, const std::function<string(const string&)>& findPassword, BruteForce* bruteForce,
+               const std::function<string()>& status = nullptr)
+{
+    if (!parser.GetString("hashes").empty())
+        return RunHashList(parser.GetString("hashes"), findPassword, bruteForce);
+
+    RunInteractive([&](const string& hash)
+    {
+        ucharVector hashValue;
+        if (!StrToHash(hash, hashValue))
+        {
+            cout << "\"" << hash << "\" is not a hash in hex form" << endl;
+            return string();
+        }
+
+        string pass = findPassword ? findPassword(hash) : string();
+        if (pass.empty() && bruteForce != nullptr)
+        {
+            map<ucharVector, string> found;
+            if (bruteForce->Run({ hashValue }, found) > 0)
+                pass = found.begin()->second;
+        }
+        return pass;
+    }, status);
+    return 0;
+}
+
+int RunPlanner(ArgParser& parser)
+{
+    OSSLHasher::HashType hashType = OSSLHasher::GetHashTypeFromString(parser.GetString("hash"));
+    if (hashType == OSSLHasher::HashType::UNKNOWN)
+    {
+        cout << "Unrecognized hash function type." << endl;
+        return 1;
+    }
+
+    RainbowTable table(parser.GetValue("vertical"), parser.GetValue("length"), parser.GetValue("horizontal"), hashType);
+    table.SetThreadCount(parser.GetValue("threads"));
+
+    cout << "Calibrating chain kernel (" << OSSLHasher::GetHashFuncName(hashType) << ")..." << endl;
+    double rate = table.MeasureChainRate(1.0);
+    cout << "\tHash+reduce rate:\t" << static_cast<uint64_t>(rate) << " steps/s" << endl << endl;
+
+    Planner::TableParams params;
+    params.keyspace = Planner::Keyspace(table.GetPasswordLength());
+    params.startRows = table.GetVerticalSize();
+    params.chainSteps = table.GetChainSteps();
+    params.passwordLength = table.GetPasswordLength();
+    params.hashLength = table.GetHashLength();
+
+    cout << "Requested table:" << endl;
+    Planner::LogEstimate(params, Planner::Estimate(params, rate));
+
+    Planner::Budget budget;
+    budget.ramBytes = static_cast<double>(parser.GetValue("plan-memory")) * 1024.0 * 1024.0;
+    budget.generationSeconds = static_cast<double>(parser.GetValue("plan-time"));
+    budget.lookupSeconds = static_cast<double>(parser.GetValue("plan-lookup")) / 1000.0;
+    if (budget.ramBytes <= 0.0 && budget.generationSeconds <= 0.0)
+        return 0;
+
+    Planner::TableParams recommended;
+    if (!Planner::Recommend(params, rate, budget, recommended))
+    {
+        cout << endl << "No table fits given budget." << endl;
+        return 1;
+    }
+
+    cout << endl << "Recommended table:" << endl;
+    Planner::LogEstimate(recommended, Planner::Estimate(recommended, rate));
+    cout << endl << "Use: --vertical " << recommended.startRows << " --horizontal " << recommended.chainSteps << endl;
+    return 0;
+}
+
+// regenerates a sample of chains of the loaded table and compares its coverage with the planner's prediction
+int RunAnalyzer(ArgParser& parser, RainbowTable& table)
+{
+    TableAnalysis analysis;
+    if (!table.Analyze(parser.GetValue("analyze"), analysis))
+        return 1;
+
+    Planner::TableParams params;
+    params.keyspace = Planner::Keyspace(table.GetPasswordLength());
+    // start rows of generation are not stored with the table - --vertical, or at least the rows left
+    params.startRows = max<uint64_t>(parser.GetValue("vertical"), analysis.rows);
+    params.chainSteps = table.GetChainSteps();
+    params.passwordLength = table.GetPasswordLength();
+    params.hashLength = table.GetHashLength();
+    const Planner::TableEstimate theory = Planner::Estimate(params, 0.0);
+    const Planner::CoverageEstimate coverage = Planner::EstimateCoverage(params.keyspace, analysis.rows, analysis.chains,
+                                                                         static_cast<double>(analysis.chainDistinct), analysis.distinct,
+                                                                         HyperLogLog::RelativeError());
+
+    const double points = static_cast<double>(analysis.points);
+    const double repeatRate = static_cast<double>(analysis.points - analysis.chainDistinct) / points;
+    const double collisionRate = 1.0 - analysis.distinct / static_cast<double>(analysis.chainDistinct);
+    const double mergeRate = 1.0 - static_cast<double>(analysis.rows) / static_cast<double>(params.startRows);
+    const double theoryMergeRate = 1.0 - min(theory.rows / static_cast<double>(params.startRows), 1.0);
+
+    cout << endl << "Analyzed " << analysis.chains << " of " << analysis.rows << " chains in " << fixed << setprecision(2)
+         << analysis.seconds << " s:" << endl;
+    cout << "\tChain points:\t\t" << analysis.points << endl;
+    cout << "\tRepeats within chains:\t" << analysis.points - analysis.chainDistinct << " in " << analysis.repeatChains << " chains ("
+         << setprecision(4) << repeatRate * 100.0 << "% of points)" << endl;
+    cout << "\tCollisions across chains:\t";
+    if (coverage.effectiveKeyspace > 0.0)
+        cout << collisionRate * 100.0 << "% of points" << endl;
+    else
+        cout << "below counter resolution (" << 3.0 * HyperLogLog::RelativeError() * 100.0 << "%)" << endl;
+    cout << "\tBroken chains:\t\t" << analysis.brokenChains << endl;
+    if (coverage.effectiveKeyspace > 0.0)
+        cout << "\tEffective keyspace:\t" << setprecision(0) << coverage.effectiveKeyspace << " ("
+             << setprecision(2) << 100.0 * coverage.effectiveKeyspace / params.keyspace << "% of the keyspace)" << endl;
+    cout << "\tDistinct passwords:\t" << setprecision(0) << coverage.distinct << " (estimated)" << endl;
+    cout << "\tSuccess probability:\t" << setprecision(4) << coverage.successProbability * 100.0 << "%" << endl;
+
+    cout << endl << "Theory for --vertical " << params.startRows << " --horizontal " << params.chainSteps << ":" << endl;
+    cout << "\tRows after merges:\t" << setprecision(0) << theory.rows << " (table has " << analysis.rows << ")" << endl;
+    cout << "\tMerge rate:\t\t" << setprecision(4) << theoryMergeRate * 100.0 << "% (table " << mergeRate * 100.0 << "%)" << endl;
+    cout << "\tSuccess probability:\t" << theory.successProbability * 100.0 << "% (table reaches "
+         << setprecision(2) << 100.0 * coverage.successProbability / theory.successProbability << "% of it)" << endl;
+    cout << defaultfloat;
+
+    const string reportFile = parser.GetString("analyze-report");
+    if (!reportFile.empty())
+    {
+        ofstream report(reportFile);
+        if (report)
+        {
+            report << setprecision(6) << fixed;
+            report << "{\n";
+            report << "  \"hash\": \"" << OSSLHasher::GetHashFuncName(table.GetHashType()) << "\",\n";
+            report << "  \"rows\": " << analysis.rows << ",\n";
+            report << "  \"chainSteps\": " << params.chainSteps << ",\n";
+            report << "  \"passwordLength\": " << params.passwordLength << ",\n";
+            report << "  \"sampledChains\": " << analysis.chains << ",\n";
+            report << "  \"repeatRate\": " << repeatRate << ",\n";
+            report << "  \"collisionRate\": " << collisionRate << ",\n";
+            report << "  \"brokenChains\": " << analysis.brokenChains << ",\n";
+            report << "  \"effectiveKeyspace\": " << coverage.effectiveKeyspace << ",\n";
+            report << "  \"distinct\": " << coverage.distinct << ",\n";
+            report << "  \"successProbability\": " << coverage.successProbability << ",\n";
+            report << "  \"theory\": { \"startRows\": " << params.startRows << ", \"rows\": " << theory.rows
+                   << ", \"mergeRate\": " << theoryMergeRate << ", \"successProbability\": " << theory.successProbability << " },\n";
+            report << "  \"seconds\": " << analysis.seconds << "\n";
+            report << "}\n";
+            cout << "Report written to \"" << reportFile << "\"" << endl;
+        }
+        else
+        {
+            cout << "Unable to open file \"" << reportFile << "\"!\n";
+        }
+    }
+
+    // damaged or weak tables fail, so a distribution script can stop on them
+    if (analysis.brokenChains > 0)
+    {
+        cout << "Table has chains not leading to their endpoints - it is damaged." << endl;
+        return 1;
+    }
+    const uint32_t minSuccess = parser.GetValue("analyze-min");
+    if (coverage.successProbability * 100.0 < static_cast<double>(minSuccess))
+    {
+        cout << "Success probability is below " << minSuccess << "% - table rejected." << endl;
+        return 1;
+    }
+    return 0;
+}
+
+// merges the comma separated list of binary tables into the --table file
+int RunMerge(ArgParser& parser)
+{
+    vector<string> inputs;
+    stringstream list(parser.GetString("merge"));
+    string input;
+    while (getline(list, input, ','))
+    {
+        if (!input.empty())
+            inputs.push_back(input);
+    }
+
+    // hash parameters are taken from the merged tables
+    RainbowTable table(0, 0, 0, OSSLHasher::HashType::UNKNOWN);
+    table.SetThreadCount(parser.GetValue("threads"));
+    table.SetChecksumMode(parser.GetFlag("checksum"));
+    table.SetBloomMode(parser.GetFlag("bloom"));
+
+    Profiler::BeginPhase("merge");
+    return table.Merge(inputs, parser.GetString('t')) ? 0 : 1;
+}
+
+// adds chains to the --table file - hash parameters are taken from the table
+int RunExtend(ArgParser& parser)
+{
+    RainbowTable table(parser.GetValue("vertical"), parser.GetValue("length"), parser.GetValue("horizontal"),
+                       OSSLHasher::HashType::UNKNOWN);
+    table.SetThreadCount(parser.GetValue("threads"));
+    table.SetChecksumMode(parser.GetFlag("checksum"));
+    table.SetBloomMode(parser.GetFlag("bloom"));
+    if (!parser.GetString('p').empty())
+        table.LoadPasswords(parser.GetString('p'));
+
+    Profiler::BeginPhase("extend");
+    return table.Extend(parser.GetString('t')) ? 0 : 1;
+}
+
+// generates the table in --shards worker processes of this executable, then merges their tables
+int RunCoordinator(ArgParser& parser, int argc, char* argv[])
+{
+    // failed shards are restarted this many times at most
+    const uint32_t SHARD_ATTEMPTS = 3;
+
+    if (parser.GetFlag("text"))
+    {
+        cout << "Sharded tables are binary only." << endl;
+        return 1;
+    }
+
+    // workers get the same arguments - later ones override earlier ones
+    const uint32_t count = parser.GetValue("shards");
+    const uint32_t threads = std::max(1u, parser.GetValue("threads"));
+    const uint32_t parallel = std::min(count, threads);
+    vector<string> args(argv + 1, argv + argc);
+    // workers would all pin their threads to the same CPUs - the OS places worker processes instead
+    args.insert(args.end(), { "--threads", to_string(std::max(1u, threads / parallel)), "--progress", "", "--profile", "", "--affinity", "none" });
+
+    Profiler::BeginPhase("generate");
+    const vector<string> shards = Shards::RunWorkers(argv[0], args, parser.GetString('t'), count, parallel, SHARD_ATTEMPTS);
+    if (shards.empty())
+        return 1;
+
+    RainbowTable table(0, 0, 0, OSSLHasher::HashType::UNKNOWN);
+    table.SetThreadCount(parser.GetValue("threads"));
+    table.SetChecksumMode(parser.GetFlag("checksum"));
+    table.SetBloomMode(parser.GetFlag("bloom"));
+
+    Profiler::BeginPhase("merge");
+    if (!table.Merge(shards, parser.GetString('t')))
+        return 1;
+    for (const auto& shard : shards)
+        remove(shard.c_str());
+    return 0;
+}
+
+// writes the profile when main returns, whichever path it takes
+struct ProfileReport
+{
+    string filename;
+
+    ~ProfileReport()
+    {
+        if (!filename.empty())
+            Profiler::WriteReport(filename);
+    }
+};
+
 int main(int argc, char* argv[])
 {
     ArgParser parser;
@@ -48,13 +429,39 @@ int main(int argc, char* argv[])
           .Add("t,table", "Table file to be used (either to save to, or to load from)", ArgType::STRING, "table.txt")
           .Add("p,passwords", "Path to entry file with password list. Table will be created using them as entry point.", ArgType::STRING)
           .Add("text", "Generates a text version of the Table (for debugging purposes) - requires more space", ArgType::FLAG)
+          .Add("checksum", "Stores per-block checksums in binary tables, verified when the table is loaded", ArgType::FLAG)
+          .Add("bloom", "Stores the endpoint Bloom filter in binary tables, so loading does not have to build it", ArgType::FLAG)
+          .Add("pipeline", "Generation streams sorted runs to a staging file on a writer thread and merges them at the end - bounded memory, binary tables only", ArgType::FLAG)
+          .Add("extend", "Adds --vertical chains (or one per password given with -p) to an existing binary --table, without loading it", ArgType::FLAG)
+          .Add("shard", "Generates only shard k/N (0 <= k < N) of the table - shards of the same --seed are disjoint and can be merged", ArgType::STRING)
+          .Add("shards", "Generates the table in given number of shards, in local worker processes, and merges them", ArgType::VALUE, 0)
+          .Add("merge", "Comma separated binary tables to merge into --table (same hash, chain steps and password length)", ArgType::STRING)
           .Add("threads", "Set thread count to use for calculations (default is all logical cores)", ArgType::VALUE, hardwareConcurrency())
+          .Add("affinity", "Worker thread placement: none, compact (fill cores and NUMA nodes in order), scatter (spread over nodes and cores first) or physical (one thread per physical core)", ArgType::STRING, "none")
           .Add("vertical", "Vertical size of the table (row count)", ArgType::VALUE, 1000)
           .Add("horizontal", "Horizontal size of the table (hash->reduce count)", ArgType::VALUE, 8000)
           .Add("length", "Length of password to be cracked", ArgType::VALUE, 6)
-          .Add("hash", "Hash type (available: SHA1, SHA256, BLAKE512)", ArgType::STRING, "BLAKE512")
+          .Add("hash", "Hash type (available: SHA1, SHA256, BLAKE512, MD5, NTLM)", ArgType::STRING, "BLAKE512")
+          .Add("hash-backend", "Hash implementation: auto (fastest verified one), evp, lowlevel, scalar or simd", ArgType::STRING, "auto")
           .Add("retry", "Number of times that each chain generation will retry, when collision is met.", ArgType::VALUE, 1)
+          .Add("table-type", "Table type to generate: rainbow, or lookup (exhaustive, for short passwords only)", ArgType::STRING, "rainbow")
+          .Add("hashes", "File with hashes to crack, one per line - results are printed instead of interactive mode", ArgType::STRING)
+          .Add("bruteforce", "Brute force mode: fallback (when table misses) or only (no table, uses --length and --hash)", ArgType::STRING)
           .Add("test", "Number of random passwords to generate and try breaking with given table.", ArgType::VALUE, 0)
+          .Add("seed", "Seed for test mode password generation (0 picks a random one), and for start points of sharded generation", ArgType::VALUE, 0)
+          .Add("test-report", "File to write test mode results to, in JSON form", ArgType::STRING)
+          .Add("analyze", "Number of chains to regenerate for a quality analysis of the table (more than the table has analyzes all of them)", ArgType::VALUE, 0)
+          .Add("analyze-report", "File to write analysis results to, in JSON form", ArgType::STRING)
+          .Add("analyze-min", "Analysis fails when estimated success probability is below given percent", ArgType::VALUE, 0)
+          .Add("timeout", "Lookup deadline in milliseconds (0 for none) - lookups that run out of time report how much of the chain they checked", ArgType::VALUE, 0)
+          .Add("async-load", "Loads binary tables in the background - lookups start right away, served from the mapped file until the load ends", ArgType::FLAG)
+          .Add("plan", "Predict coverage, size and cost of a table with given parameters, without generating it", ArgType::FLAG)
+          .Add("plan-memory", "Planner: RAM budget for the table in MiB - recommends parameters when given", ArgType::VALUE, 0)
+          .Add("plan-time", "Planner: generation time budget in seconds - recommends parameters when given", ArgType::VALUE, 0)
+          .Add("plan-lookup", "Planner: lookup time budget in milliseconds used for recommendations", ArgType::VALUE, 1000)
+          .Add("progress", "File to stream progress samples to, one JSON object per line (\"-\" for stderr)", ArgType::STRING)
+          .Add("progress-interval", "Progress reporting interval in milliseconds", ArgType::VALUE, 500)
+          .Add("profile", "File to write per-phase timers and counters (hashes, reductions, probes...) to, in JSON form", ArgType::STRING)
           .Add("h,help", "Display this message", ArgType::FLAG);
 
     if (!parser.Parse(argc, argv))
@@ -71,60 +478,222 @@ int main(int argc, char* argv[])
         return 0;
     }
 
+    if (!OSSLHasher::SetBackend(parser.GetString("hash-backend")))
+        return 1;
+
+    Progress::SetInterval(parser.GetValue("progress-interval"));
+    if (!Progress::SetMachineOutput(parser.GetString("progress")))
+        return 1;
+
+    ProfileReport profile;
+    profile.filename = parser.GetString("profile");
+    Profiler::Enable(!profile.filename.empty());
+
+    Topology::Policy affinity = Topology::Policy::NONE;
+    if (!Topology::ParsePolicy(parser.GetString("affinity"), affinity))
+    {
+        cout << "Unrecognized affinity \"" << parser.GetString("affinity") << "\" - use none, compact, scatter or physical." << endl;
+        return 1;
+    }
+    if (affinity != Topology::Policy::NONE)
+    {
+        const Topology::Info& topology = Topology::Get();
+        cout << "Affinity: " << Topology::GetPolicyName(affinity) << " over " << topology.nodes << " NUMA node(s), " << topology.packages
+             << " package(s), " << topology.cores << " core(s), " << topology.cpus.size() << " logical CPU(s)" << endl;
+    }
+    Topology::SetPolicy(affinity);
+
+    if (parser.GetFlag("plan"))
+        return RunPlanner(parser);
+
     if (parser.GetString('t').empty())
     {
         cout << "Provide table name to be loaded, or generate one using --generate option!" << std::endl;
         return 1;
     }
 
+    if (!parser.GetString("merge").empty())
+        return RunMerge(parser);
+    if (parser.GetFlag("extend"))
+        return RunExtend(parser);
+
     OSSLHasher::HashType hashType = OSSLHasher::GetHashTypeFromString(parser.GetString("hash"));
-    if (parser.GetFlag('g'))
+    const string bruteForceMode = parser.GetString("bruteforce");
+    if (!bruteForceMode.empty() && bruteForceMode != "fallback" && bruteForceMode != "only")
+    {
+        cout << "Unrecognized brute force mode \"" << bruteForceMode << "\" - use fallback or only." << endl;
+        return 1;
+    }
+
+    if (bruteForceMode == "only")
+    {
+        if (hashType == OSSLHasher::HashType::UNKNOWN)
+        {
+            cout << "Unrecognized hash function type." << endl;
+            return 1;
+        }
+
+        BruteForce bruteForce(parser.GetValue("length"), hashType);
+        bruteForce.SetThreadCount(parser.GetValue("threads"));
+        return RunQueries(parser, nullptr, &bruteForce);
+    }
+
+    uint32_t shardIndex = 0, shardCount = 0;
+    if (!parser.GetString("shard").empty() && !Shards::ParseShard(parser.GetString("shard"), shardIndex, shardCount))
+        return 1;
+    if (parser.GetFlag('g') && shardCount == 0 && parser.GetValue("shards") > 0)
+        return RunCoordinator(parser, argc, argv);
+
+    if (parser.GetFlag('g') && parser.GetString("table-type") == "lookup")
+    {
+        LookupTable table(parser.GetValue("length"), hashType);
+        table.SetThreadCount(parser.GetValue("threads"));
+
+        cout << "Will output table to: " << parser.GetString('t') << std::endl;
+        Profiler::BeginPhase("generate");
+        if (!table.CreateTable())
+            return 1;
+        Profiler::BeginPhase("save");
+        if (!table.Save(parser.GetString('t')))
+            return 1;
+
+        return 0;
+    }
+    else if (parser.GetFlag('g'))
     {
         RainbowTable table(parser.GetValue("vertical"), parser.GetValue("length"), parser.GetValue("horizontal"), hashType);
         table.SetThreadCount(parser.GetValue("threads"));
         table.SetTextMode(parser.GetFlag("text"));
+        table.SetChecksumMode(parser.GetFlag("checksum"));
+        table.SetBloomMode(parser.GetFlag("bloom"));
+        if (shardCount > 0)
+        {
+            if (parser.GetFlag("text"))
+            {
+                cout << "Sharded tables are binary only." << endl;
+                return 1;
+            }
+            table.SetShard(shardIndex, shardCount, parser.GetValue("seed"));
+        }
+
+        // shards are always pipelined - they are merged anyway
+        const bool pipeline = (parser.GetFlag("pipeline") || shardCount > 0) && !parser.GetFlag("text");
+        if (pipeline)
+            table.SetStagingFile(parser.GetString('t') + ".runs");
+        else if (parser.GetFlag("pipeline"))
+            cout << "Text tables are built in memory, --pipeline is ignored." << endl;
 
         if (!parser.GetString('p').empty())
             table.LoadPasswords(parser.GetString('p'));
 
         cout << "Will output table to: " << parser.GetString('t') << std::endl;
-        table.CreateTable();
+        Profiler::BeginPhase("generate");
+        if (!table.CreateTable())
+            return 1;
         cout << endl;
-        cout << "Table created, size: " << table.GetSize() << endl;
-        table.Save(parser.GetString('t'));
+        if (!pipeline)
+            cout << "Table created, size: " << table.GetSize() << endl;
+        Profiler::BeginPhase("save");
+        return table.Save(parser.GetString('t')) ? 0 : 1;
+    }
 
-        return 0;
+    if (LookupTable::IsLookupTableFile(parser.GetString('t')))
+    {
+        // hash parameters are taken from the table header
+        LookupTable table(0, OSSLHasher::HashType::UNKNOWN);
+        Profiler::BeginPhase("load");
+        if (!table.Load(parser.GetString('t')))
+            return 1;
+
+        if (parser.GetValue("test") > 0)
+        {
+            cout << "Lookup tables cover the whole keyspace - test mode is meant for Rainbow Tables." << endl;
+            return 0;
+        }
+
+        Profiler::BeginPhase("lookup");
+        return RunQueries(parser, [&table](const string& hash) { return table.FindPassword(hash); }, nullptr);
     }
 
-    RainbowTable table(0, 0, 0, hashType);
+    RainbowTable table(0, 0, 0, OSSLHasher::HashType::UNKNOWN);
     table.SetThreadCount(parser.GetValue("threads"));
     table.SetRetryCount(parser.GetValue("retry"));
     table.SetTextMode(parser.GetFlag("text"));
-    if (!table.Load(parser.GetString('t')))
+    // test mode and analysis work on the loaded table, so they always wait for the load
+    uint32_t testNo = parser.GetValue("test");
+    const bool asyncLoad = parser.GetFlag("async-load") && testNo == 0 && parser.GetValue("analyze") == 0;
+    Profiler::BeginPhase("load");
+    if (!(asyncLoad ? table.LoadAsync(parser.GetString('t')) : table.Load(parser.GetString('t'))))
         return 1;
 
-    uint32_t testNo = parser.GetValue("test");
+    Profiler::BeginPhase("lookup");
     if (testNo > 0)
     {
-        table.RunTest(testNo);
+        table.RunTest(testNo, parser.GetValue("seed"), parser.GetString("test-report"));
         return 0;
     }
+    if (parser.GetValue("analyze") > 0)
+    {
+        Profiler::BeginPhase("analyze");
+        return RunAnalyzer(parser, table);
+    }
 
-    cout << "\n::Give password hash to look for or 'exit' to terminate" << endl;
-    string inputHash, pass;
-    do
+    // brute force covers the keyspace of the loaded table
+    unique_ptr<BruteForce> bruteForce;
+    if (bruteForceMode == "fallback")
     {
-        cout << ">> ";
-        cin >> inputHash;
-        if (inputHash == "exit")
-            break;
-        cout << "Looking for hash now..." << endl;
-        pass = table.FindPassword(inputHash);
-        if (pass.empty())
-            cout << "PASSWORD NOT FOUND! :(\n";
-        else
-            cout << "PASSWORD FOUND: \"" << pass << "\"\n";
-    } while (true);
+        bruteForce.reset(new BruteForce(table.GetPasswordLength(), table.GetHashType()));
+        bruteForce->SetThreadCount(parser.GetValue("threads"));
+    }
 
-    cout << "Terminating" << endl;
+    // the loader does not write to the console, what it reported is shown here once it is done
+    auto status = [&table]()
+    {
+        string report = table.GetLoadReport();
+        report.erase(0, report.find_first_not_of('\n'));
+        while (!report.empty() && report.back() == '\n')
+            report.pop_back();
+        if (!report.empty())
+            report.insert(0, "\n");
+
+        switch (table.GetLoadState())
+        {
+        case RainbowTable::LoadState::LOADING:
+        {
+            ostringstream loading;
+            loading << "Table loading - " << fixed << setprecision(1) << 100.0 * table.GetLoadProgress()
+                    << "% of rows loaded, lookups are served from the mapped file meanwhile";
+            return loading.str();
+        }
+        case RainbowTable::LoadState::READY:
+            return "Table ready" + report;
+        default:
+            return "Table failed to load - lookups find nothing" + report;
+        }
+    };
+
+    // with a timeout lookups go through the scheduler - interactive ones ahead of hash lists
+    unique_ptr<LookupScheduler> scheduler;
+    const double timeout = static_cast<double>(parser.GetValue("timeout")) / 1000.0;
+    if (timeout > 0.0)
+        scheduler.reset(new LookupScheduler(table, parser.GetValue("threads")));
+    const LookupScheduler::Priority priority = parser.GetString("hashes").empty() ? LookupScheduler::Priority::HIGH : LookupScheduler::Priority::BATCH;
+
+    auto findPassword = [&](const string& hash)
+    {
+        if (!scheduler)
+            return table.FindPassword(hash);
+
+        ucharVector hashValue;
+        if (!table.ParseHash(hash, hashValue))
+            return string();
+        const LookupScheduler::Result result = scheduler->Submit(hashValue, timeout, priority).get();
+        if (result.status == LookupScheduler::Result::Status::TIMED_OUT)
+            cout << "Lookup of " << hash << " timed out after checking " << fixed << setprecision(1) << 100.0 * result.coverage
+                 << "% of chain positions" << defaultfloat << endl;
+        else if (result.status == LookupScheduler::Result::Status::INVALID)
+            cout << "Lookup of " << hash << " failed: " << result.error << endl;
+        return result.password;
+    };
+    return RunQueries(parser, findPassword, bruteForce.get(), asyncLoad ? std::function<string()>(status) : nullptr);
 }